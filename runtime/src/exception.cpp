@@ -0,0 +1,238 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// exceptions go through the itanium abi unwinder (libgcc_s or libunwind),
+// windows would need seh and the compiler refuses try and throw there
+#ifndef _WIN32
+
+#include <unwind.h>
+
+// a string slice, returned by value it comes back in two registers just like the compiler expects
+struct seam_string
+{
+	const char* data;
+	std::size_t size;
+};
+
+namespace
+{
+	// "SEAM\0\0\0\0", tells our exceptions apart from foreign ones
+	constexpr std::uint64_t seam_exception_class = 0x5345414d00000000;
+
+	struct seam_exception
+	{
+		_Unwind_Exception header; // first, the unwinder only ever sees a pointer to it
+		seam_string value;
+	};
+
+	void delete_exception(_Unwind_Reason_Code, _Unwind_Exception* exception)
+	{
+		delete reinterpret_cast<seam_exception*>(exception);
+	}
+
+	// pointer encodings used in the lsda
+	enum : std::uint8_t
+	{
+		dw_eh_pe_absptr = 0x00,
+		dw_eh_pe_uleb128 = 0x01,
+		dw_eh_pe_udata2 = 0x02,
+		dw_eh_pe_udata4 = 0x03,
+		dw_eh_pe_udata8 = 0x04,
+		dw_eh_pe_sleb128 = 0x09,
+		dw_eh_pe_sdata2 = 0x0a,
+		dw_eh_pe_sdata4 = 0x0b,
+		dw_eh_pe_sdata8 = 0x0c,
+		dw_eh_pe_pcrel = 0x10,
+		dw_eh_pe_indirect = 0x80,
+		dw_eh_pe_omit = 0xff,
+	};
+
+	template <typename T>
+	T read(const std::uint8_t*& p)
+	{
+		T result;
+		std::memcpy(&result, p, sizeof(T));
+		p += sizeof(T);
+		return result;
+	}
+
+	std::uintptr_t read_uleb128(const std::uint8_t*& p)
+	{
+		std::uintptr_t result = 0;
+		unsigned shift = 0;
+		std::uint8_t byte;
+		do
+		{
+			byte = *p++;
+			result |= static_cast<std::uintptr_t>(byte & 0x7f) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+		return result;
+	}
+
+	std::intptr_t read_sleb128(const std::uint8_t*& p)
+	{
+		std::uintptr_t result = 0;
+		unsigned shift = 0;
+		std::uint8_t byte;
+		do
+		{
+			byte = *p++;
+			result |= static_cast<std::uintptr_t>(byte & 0x7f) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		if ((byte & 0x40) && shift < sizeof(result) * 8)
+		{
+			result |= ~static_cast<std::uintptr_t>(0) << shift;
+		}
+		return static_cast<std::intptr_t>(result);
+	}
+
+	std::uintptr_t read_encoded(const std::uint8_t*& p, std::uint8_t encoding)
+	{
+		if (encoding == dw_eh_pe_omit)
+		{
+			return 0;
+		}
+
+		const auto start = p;
+		std::uintptr_t result;
+		switch (encoding & 0x0f)
+		{
+			case dw_eh_pe_absptr: result = read<std::uintptr_t>(p); break;
+			case dw_eh_pe_uleb128: result = read_uleb128(p); break;
+			case dw_eh_pe_udata2: result = read<std::uint16_t>(p); break;
+			case dw_eh_pe_udata4: result = read<std::uint32_t>(p); break;
+			case dw_eh_pe_udata8: result = static_cast<std::uintptr_t>(read<std::uint64_t>(p)); break;
+			case dw_eh_pe_sleb128: result = static_cast<std::uintptr_t>(read_sleb128(p)); break;
+			case dw_eh_pe_sdata2: result = static_cast<std::uintptr_t>(read<std::int16_t>(p)); break;
+			case dw_eh_pe_sdata4: result = static_cast<std::uintptr_t>(read<std::int32_t>(p)); break;
+			case dw_eh_pe_sdata8: result = static_cast<std::uintptr_t>(read<std::int64_t>(p)); break;
+			default: std::abort();
+		}
+
+		// the compiler only emits absolute and pc relative pointers in the lsda
+		if (result != 0)
+		{
+			if ((encoding & 0x70) == dw_eh_pe_pcrel)
+			{
+				result += reinterpret_cast<std::uintptr_t>(start);
+			}
+			else if ((encoding & 0x70) != dw_eh_pe_absptr)
+			{
+				std::abort();
+			}
+
+			if (encoding & dw_eh_pe_indirect)
+			{
+				result = *reinterpret_cast<const std::uintptr_t*>(result);
+			}
+		}
+		return result;
+	}
+}
+
+extern "C" [[noreturn]] __attribute__((visibility("default"))) void seam_throw(const char* data, std::size_t size)
+{
+	auto exception = new seam_exception{};
+	exception->header.exception_class = seam_exception_class;
+	exception->header.exception_cleanup = delete_exception;
+	exception->value = { data, size };
+
+	_Unwind_RaiseException(&exception->header);
+
+	// only returns when no frame catches it
+	fputs("uncaught exception: ", stderr);
+	fwrite(data, sizeof(char), size, stderr);
+	fputc('\n', stderr);
+	std::abort();
+}
+
+// called by the landing pad of a catch, the exception is done with once the value is out
+extern "C" __attribute__((visibility("default"))) seam_string seam_catch(_Unwind_Exception* exception)
+{
+	auto value = reinterpret_cast<seam_exception*>(exception)->value;
+	_Unwind_DeleteException(exception);
+	return value;
+}
+
+// every landing pad the compiler emits catches everything, so the type table is never needed.
+// finding the call site the frame is stopped at in the lsda is all there is to it
+extern "C" __attribute__((visibility("default"))) _Unwind_Reason_Code seam_personality(int version, _Unwind_Action actions,
+	std::uint64_t exception_class, _Unwind_Exception* exception, _Unwind_Context* context)
+{
+	if (version != 1)
+	{
+		return _URC_FATAL_PHASE1_ERROR;
+	}
+
+	auto lsda = static_cast<const std::uint8_t*>(_Unwind_GetLanguageSpecificData(context));
+	if (!lsda || exception_class != seam_exception_class)
+	{
+		return _URC_CONTINUE_UNWIND;
+	}
+
+	// the ip is right after the call unless the frame was interrupted by a signal
+	int before_ip = 0;
+	auto ip = _Unwind_GetIPInfo(context, &before_ip);
+	if (!before_ip)
+	{
+		--ip;
+	}
+	const auto func_start = _Unwind_GetRegionStart(context);
+
+	auto p = lsda;
+	const auto landing_pad_start_encoding = *p++;
+	const auto landing_pad_start = landing_pad_start_encoding == dw_eh_pe_omit ? func_start : read_encoded(p, landing_pad_start_encoding);
+
+	if (*p++ != dw_eh_pe_omit)
+	{
+		read_uleb128(p); // type table offset
+	}
+
+	const auto call_site_encoding = *p++;
+	const auto call_site_table_length = read_uleb128(p);
+	const auto call_site_table_end = p + call_site_table_length;
+
+	// sorted by start address
+	while (p < call_site_table_end)
+	{
+		const auto start = read_encoded(p, call_site_encoding);
+		const auto length = read_encoded(p, call_site_encoding);
+		const auto landing_pad = read_encoded(p, call_site_encoding);
+		const auto action = read_uleb128(p);
+
+		if (ip < func_start + start)
+		{
+			break;
+		}
+
+		if (ip >= func_start + start + length)
+		{
+			continue;
+		}
+
+		if (landing_pad == 0)
+		{
+			return _URC_CONTINUE_UNWIND;
+		}
+
+		if (actions & _UA_SEARCH_PHASE)
+		{
+			// a landing pad without an action only cleans up, the search goes on
+			return action != 0 ? _URC_HANDLER_FOUND : _URC_CONTINUE_UNWIND;
+		}
+
+		_Unwind_SetGR(context, __builtin_eh_return_data_regno(0), reinterpret_cast<std::uintptr_t>(exception));
+		_Unwind_SetGR(context, __builtin_eh_return_data_regno(1), action != 0 ? 1 : 0);
+		_Unwind_SetIP(context, landing_pad_start + landing_pad);
+		return _URC_INSTALL_CONTEXT;
+	}
+
+	return _URC_CONTINUE_UNWIND;
+}
+
+#endif
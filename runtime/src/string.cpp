@@ -1,14 +1,16 @@
 #include <cstdio>
 #include <cstdint>
 
+// a string is a slice, { data, size }, it doesn't own its bytes.
+// extern functions follow the c abi, so it's taken by value like any other struct.
+// the data of an empty one may be null on this side, seam code never sees that
 struct seam_string
 {
+	const char* data;
 	std::size_t size;
-	char data[];
 };
 
-extern "C" __declspec(dllexport) void println(seam_string* string)
+extern "C" __declspec(dllexport) void println(seam_string s)
 {
-	fwrite(string->data, sizeof(char), string->size, stdout);
+	fwrite(s.data, sizeof(char), s.size, stdout);
 }
-
@@ -0,0 +1,637 @@
+#include "abi_lowering.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+using namespace seam::compiler;
+
+namespace
+{
+	template <typename T>
+	void add_abi_attributes(T* value, const code_gen::abi_lowering::signature& sig, llvm::LLVMContext& context)
+	{
+		using kind = code_gen::abi_lowering::argument::kind;
+
+		if (sig.ret.type == kind::extend)
+		{
+			value->addRetAttr(sig.ret.is_signed ? llvm::Attribute::SExt : llvm::Attribute::ZExt);
+		}
+		else if (sig.ret.type == kind::indirect)
+		{
+			value->addParamAttr(0, llvm::Attribute::getWithStructRetType(context, sig.ret.value_type));
+			value->addParamAttr(0, llvm::Attribute::getWithAlignment(context, sig.ret.alignment));
+			value->addParamAttr(0, llvm::Attribute::NoAlias);
+		}
+
+		for (const auto& arg : sig.params)
+		{
+			if (arg.type == kind::extend)
+			{
+				value->addParamAttr(arg.first, arg.is_signed ? llvm::Attribute::SExt : llvm::Attribute::ZExt);
+			}
+			else if (arg.type == kind::indirect && arg.byval)
+			{
+				value->addParamAttr(arg.first, llvm::Attribute::getWithByValType(context, arg.value_type));
+				value->addParamAttr(arg.first, llvm::Attribute::getWithAlignment(context, arg.alignment));
+			}
+		}
+	}
+}
+
+code_gen::abi_lowering::abi_lowering(llvm::Module& mod, const llvm::DataLayout& data_layout) :
+	mod(mod), data_layout(data_layout), triple(mod.getTargetTriple())
+{
+	// { i32, i64 } has the i64 in its second eightbyte on x86-64 sysv, so it takes two integer registers.
+	// with i64 aligned to 4 bytes it would be a 12 byte struct coerced to { i64, i32 }
+	if (triple.getArch() == llvm::Triple::x86_64 && !triple.isOSWindows())
+	{
+		auto& context = mod.getContext();
+		auto i64 = llvm::Type::getInt64Ty(context);
+		auto sig = classify(llvm::Type::getVoidTy(context), false, { { llvm::StructType::get(llvm::Type::getInt32Ty(context), i64), false } });
+		if (sig.params.front().coerced != llvm::StructType::get(i64, i64))
+		{
+			throw std::runtime_error("the data layout of module '" + mod.getName().str() + "' is not the one of " + triple.str());
+		}
+	}
+}
+
+bool code_gen::abi_lowering::signature::is_trivial() const
+{
+	auto trivial = [](const argument& arg) { return arg.type == argument::kind::direct || arg.type == argument::kind::extend; };
+	return (trivial(ret) || ret.value_type->isVoidTy()) && std::all_of(params.cbegin(), params.cend(), trivial);
+}
+
+void code_gen::abi_lowering::add_explicit_layout(llvm::StructType* type, llvm::Align alignment, llvm::SmallBitVector padding)
+{
+	explicit_layouts[type] = { alignment, std::move(padding) };
+}
+
+llvm::Align code_gen::abi_lowering::get_alignment(llvm::Type* type) const
+{
+	if (auto struct_type = llvm::dyn_cast<llvm::StructType>(type))
+	{
+		if (auto it = explicit_layouts.find(struct_type); it != explicit_layouts.end())
+		{
+			return it->second.alignment;
+		}
+
+		if (struct_type->isPacked())
+		{
+			return llvm::Align{ 1 };
+		}
+
+		llvm::Align alignment{ 1 };
+		for (auto element : struct_type->elements())
+		{
+			alignment = std::max(alignment, get_alignment(element));
+		}
+		return alignment;
+	}
+
+	if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type))
+	{
+		return get_alignment(array_type->getElementType());
+	}
+
+	return data_layout.getABITypeAlign(type);
+}
+
+template <typename F>
+bool code_gen::abi_lowering::for_each_leaf(llvm::Type* type, std::uint64_t offset, F&& leaf) const
+{
+	if (auto struct_type = llvm::dyn_cast<llvm::StructType>(type))
+	{
+		auto it = explicit_layouts.find(struct_type);
+		auto struct_layout = data_layout.getStructLayout(struct_type);
+		for (unsigned i = 0; i < struct_type->getNumElements(); ++i)
+		{
+			if (it != explicit_layouts.end() && it->second.padding.test(i))
+			{
+				continue;
+			}
+
+			// c leaves a field that isn't naturally aligned in memory
+			auto element = struct_type->getElementType(i);
+			auto element_offset = offset + struct_layout->getElementOffset(i);
+			if (!llvm::isAligned(get_alignment(element), element_offset) || !for_each_leaf(element, element_offset, leaf))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type))
+	{
+		auto element = array_type->getElementType();
+		auto stride = data_layout.getTypeAllocSize(element);
+		for (std::uint64_t i = 0; i < array_type->getNumElements(); ++i)
+		{
+			if (!for_each_leaf(element, offset + i * stride, leaf))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	leaf(type, offset);
+	return true;
+}
+
+void code_gen::abi_lowering::classify_sysv(argument& arg, bool is_return, unsigned& integer_registers, unsigned& sse_registers) const
+{
+	auto& context = mod.getContext();
+	auto type = arg.value_type;
+
+	if (!type->isAggregateType())
+	{
+		auto& registers = type->isFPOrFPVectorTy() || type->isVectorTy() ? sse_registers : integer_registers;
+		registers -= registers != 0;
+		return;
+	}
+
+	// an sret pointer is counted by classify, arguments are copied onto the stack
+	auto pass_in_memory = [&]
+	{
+		arg.type = argument::kind::indirect;
+		arg.byval = !is_return;
+		arg.alignment = std::max(get_alignment(type), llvm::Align{ 8 });
+	};
+
+	const auto size = data_layout.getTypeAllocSize(type).getFixedSize();
+	if (size > 16)
+	{
+		pass_in_memory();
+		return;
+	}
+
+	std::array<reg_class, 2> classes{ reg_class::none, reg_class::none };
+	std::array<std::vector<llvm::Type*>, 2> leaves; // of each eightbyte, to pick its sse type
+
+	// a lone 16 byte vector is a single sse register like in c, one that is part of something bigger isn't worth the trouble
+	llvm::Type* wide_vector = nullptr;
+	auto aligned = for_each_leaf(type, 0, [&](llvm::Type* leaf, std::uint64_t offset)
+	{
+		const auto leaf_size = data_layout.getTypeAllocSize(leaf).getFixedSize();
+		if (leaf->isVectorTy() && leaf_size > 8)
+		{
+			wide_vector = offset == 0 && leaf_size == size ? leaf : nullptr;
+			classes[0] = reg_class::memory;
+			return;
+		}
+
+		const auto leaf_class = leaf->isFPOrFPVectorTy() ? reg_class::sse : reg_class::integer;
+		for (auto eightbyte = offset / 8; eightbyte <= (offset + leaf_size - 1) / 8; ++eightbyte)
+		{
+			auto& current = classes[eightbyte];
+			current = current == reg_class::none || current == leaf_class ? leaf_class
+				: current == reg_class::memory ? reg_class::memory : reg_class::integer;
+			leaves[eightbyte].push_back(leaf);
+		}
+	});
+
+	if (wide_vector)
+	{
+		arg.type = argument::kind::coerce;
+		arg.coerced = wide_vector;
+		sse_registers -= sse_registers != 0;
+		return;
+	}
+
+	if (size == 0)
+	{
+		arg.type = argument::kind::ignore;
+		return;
+	}
+
+	const std::size_t eightbytes = (size + 7) / 8;
+	unsigned needed_integer = 0, needed_sse = 0;
+	for (std::size_t i = 0; i < eightbytes; ++i)
+	{
+		// nothing but padding, as long as something comes after it it still takes a register
+		if (classes[i] == reg_class::none)
+		{
+			classes[i] = reg_class::integer;
+		}
+		needed_integer += classes[i] == reg_class::integer;
+		needed_sse += classes[i] == reg_class::sse;
+	}
+
+	// an aggregate is never split between registers and the stack
+	if (!aligned || classes[0] == reg_class::memory || classes[1] == reg_class::memory
+		|| needed_integer > integer_registers || needed_sse > sse_registers)
+	{
+		pass_in_memory();
+		return;
+	}
+
+	integer_registers -= needed_integer;
+	sse_registers -= needed_sse;
+
+	std::vector<llvm::Type*> pieces;
+	for (std::size_t i = 0; i < eightbytes; ++i)
+	{
+		// a pointer, a double, a float on its own or a vector of 8 bytes keeps its type
+		const auto bytes = std::min<std::uint64_t>(8, size - i * 8);
+		if (leaves[i].size() == 1 && data_layout.getTypeAllocSize(leaves[i].front()) == bytes)
+		{
+			pieces.push_back(leaves[i].front());
+		}
+		else if (classes[i] == reg_class::integer)
+		{
+			pieces.push_back(llvm::IntegerType::get(context, static_cast<unsigned>(bytes * 8)));
+		}
+		else
+		{
+			pieces.push_back(bytes <= 4 ? llvm::Type::getFloatTy(context) : llvm::FixedVectorType::get(llvm::Type::getFloatTy(context), 2));
+		}
+	}
+
+	arg.type = argument::kind::coerce;
+	arg.coerced = pieces.size() == 1 ? pieces.front() : llvm::StructType::get(context, pieces);
+}
+
+void code_gen::abi_lowering::classify_aarch64(argument& arg, bool is_return) const
+{
+	auto& context = mod.getContext();
+	auto type = arg.value_type;
+	if (!type->isAggregateType())
+	{
+		return;
+	}
+
+	const auto size = data_layout.getTypeAllocSize(type).getFixedSize();
+	if (size == 0)
+	{
+		arg.type = argument::kind::ignore;
+		return;
+	}
+
+	// a homogeneous aggregate of up to four floats or vectors of the same type goes into consecutive fp registers
+	llvm::Type* base = nullptr;
+	std::size_t members = 0;
+	bool homogeneous = for_each_leaf(type, 0, [&](llvm::Type* leaf, std::uint64_t)
+	{
+		base = !base || base == leaf ? leaf : llvm::Type::getVoidTy(context);
+		++members;
+	});
+	homogeneous = homogeneous && base && (base->isFloatingPointTy() || (base->isVectorTy() && (data_layout.getTypeAllocSize(base) == 8 || data_layout.getTypeAllocSize(base) == 16)))
+		&& members <= 4 && members * data_layout.getTypeAllocSize(base) == size;
+	if (homogeneous)
+	{
+		arg.type = argument::kind::coerce;
+		arg.coerced = llvm::ArrayType::get(base, members);
+		return;
+	}
+
+	// anything bigger is copied by the caller and passed as a pointer, a return value goes through x8
+	if (size > 16)
+	{
+		arg.type = argument::kind::indirect;
+		arg.alignment = std::max(get_alignment(type), llvm::Align{ 8 });
+		return;
+	}
+
+	const auto bits = llvm::alignTo(size, 8) * 8;
+	const bool quad_aligned = get_alignment(type) >= llvm::Align{ 16 };
+
+	arg.type = argument::kind::coerce;
+	if (is_return && size <= 8)
+	{
+		arg.coerced = llvm::IntegerType::get(context, static_cast<unsigned>(size * 8));
+	}
+	else if (quad_aligned)
+	{
+		arg.coerced = llvm::IntegerType::get(context, 128);
+	}
+	else
+	{
+		arg.coerced = llvm::ArrayType::get(llvm::Type::getInt64Ty(context), bits / 64);
+	}
+}
+
+void code_gen::abi_lowering::classify_win64(argument& arg, bool is_return) const
+{
+	auto type = arg.value_type;
+
+	// a vector is returned in xmm0 but passed like any other 16 byte value
+	if (!type->isAggregateType() && (is_return || !type->isVectorTy()))
+	{
+		return;
+	}
+
+	const auto size = data_layout.getTypeAllocSize(type).getFixedSize();
+	if (size == 0)
+	{
+		arg.type = argument::kind::ignore;
+	}
+	else if (size == 1 || size == 2 || size == 4 || size == 8)
+	{
+		arg.type = argument::kind::coerce;
+		arg.coerced = llvm::IntegerType::get(mod.getContext(), static_cast<unsigned>(size * 8));
+	}
+	else
+	{
+		arg.type = argument::kind::indirect;
+	}
+}
+
+code_gen::abi_lowering::signature code_gen::abi_lowering::classify(llvm::Type* ret, bool ret_signed, const std::vector<std::pair<llvm::Type*, bool>>& params)
+{
+	auto classify_value = [&](argument& arg, llvm::Type* type, bool is_signed, bool is_return, unsigned& integer_registers, unsigned& sse_registers)
+	{
+		arg.value_type = type;
+		arg.is_signed = is_signed;
+
+		if (type->isVoidTy())
+		{
+			arg.type = argument::kind::ignore;
+			return;
+		}
+		arg.alignment = get_alignment(type);
+
+		// c promotes them to int, the callee may rely on the caller having done it
+		if (type->isIntegerTy() && type->getIntegerBitWidth() < 32)
+		{
+			arg.type = argument::kind::extend;
+			integer_registers -= integer_registers != 0;
+			return;
+		}
+
+		if (triple.getArch() == llvm::Triple::x86_64 && triple.isOSWindows())
+		{
+			classify_win64(arg, is_return);
+		}
+		else if (triple.getArch() == llvm::Triple::x86_64)
+		{
+			classify_sysv(arg, is_return, integer_registers, sse_registers);
+		}
+		else if (triple.isAArch64())
+		{
+			classify_aarch64(arg, is_return);
+		}
+	};
+
+	signature sig;
+	unsigned integer_registers = sysv_integer_registers, sse_registers = sysv_sse_registers;
+
+	// the return value has registers of its own, but an sret pointer takes an argument register
+	unsigned return_integer_registers = 2, return_sse_registers = 2;
+	classify_value(sig.ret, ret, ret_signed, true, return_integer_registers, return_sse_registers);
+	std::vector<llvm::Type*> parameter_types;
+	if (sig.ret.type == argument::kind::indirect)
+	{
+		parameter_types.push_back(ret->getPointerTo());
+		--integer_registers;
+	}
+
+	sig.params.resize(params.size());
+	for (std::size_t i = 0; i < params.size(); ++i)
+	{
+		auto& arg = sig.params[i];
+		classify_value(arg, params[i].first, params[i].second, false, integer_registers, sse_registers);
+
+		arg.first = static_cast<unsigned>(parameter_types.size());
+		switch (arg.type)
+		{
+			case argument::kind::direct:
+			case argument::kind::extend:
+			{
+				parameter_types.push_back(arg.value_type);
+				break;
+			}
+			case argument::kind::coerce:
+			{
+				if (auto pieces = llvm::dyn_cast<llvm::StructType>(arg.coerced))
+				{
+					parameter_types.insert(parameter_types.end(), pieces->element_begin(), pieces->element_end());
+				}
+				else
+				{
+					parameter_types.push_back(arg.coerced);
+				}
+				break;
+			}
+			case argument::kind::indirect:
+			{
+				parameter_types.push_back(arg.value_type->getPointerTo());
+				break;
+			}
+			case argument::kind::ignore:
+			{
+				break;
+			}
+		}
+		arg.count = static_cast<unsigned>(parameter_types.size()) - arg.first;
+	}
+
+	llvm::Type* return_type = llvm::Type::getVoidTy(mod.getContext());
+	if (sig.ret.type == argument::kind::direct || sig.ret.type == argument::kind::extend)
+	{
+		return_type = ret;
+	}
+	else if (sig.ret.type == argument::kind::coerce)
+	{
+		return_type = sig.ret.coerced;
+	}
+
+	sig.type = llvm::FunctionType::get(return_type, parameter_types, false);
+	return sig;
+}
+
+void code_gen::abi_lowering::add_attributes(llvm::Function* function, const signature& sig) const
+{
+	add_abi_attributes(function, sig, mod.getContext());
+}
+
+void code_gen::abi_lowering::add_attributes(llvm::CallBase* call, const signature& sig) const
+{
+	add_abi_attributes(call, sig, mod.getContext());
+}
+
+llvm::AllocaInst* code_gen::abi_lowering::create_temporary(llvm::IRBuilder<>& builder, const argument& arg) const
+{
+	// big enough and aligned for both sides of a coercion, in the entry block so it becomes registers again
+	auto size = data_layout.getTypeAllocSize(arg.value_type).getFixedSize();
+	auto alignment = arg.alignment;
+	if (arg.coerced)
+	{
+		size = std::max<std::uint64_t>(size, data_layout.getTypeAllocSize(arg.coerced).getFixedSize());
+		alignment = std::max(alignment, data_layout.getABITypeAlign(arg.coerced));
+	}
+
+	auto& entry = builder.GetInsertBlock()->getParent()->getEntryBlock();
+	llvm::IRBuilder<> entry_builder{ &entry, entry.getFirstInsertionPt() };
+	auto temporary = entry_builder.CreateAlloca(llvm::ArrayType::get(entry_builder.getInt8Ty(), size));
+	temporary->setAlignment(alignment);
+	return temporary;
+}
+
+std::vector<llvm::Value*> code_gen::abi_lowering::lower_arguments(llvm::IRBuilder<>& builder, const signature& sig, const std::vector<llvm::Value*>& arguments, llvm::Value*& sret) const
+{
+	std::vector<llvm::Value*> result;
+	result.reserve(sig.type->getNumParams());
+
+	sret = nullptr;
+	if (sig.ret.type == argument::kind::indirect)
+	{
+		sret = builder.CreateBitCast(create_temporary(builder, sig.ret), sig.ret.value_type->getPointerTo());
+		result.push_back(sret);
+	}
+
+	for (std::size_t i = 0; i < sig.params.size(); ++i)
+	{
+		const auto& arg = sig.params[i];
+		auto value = arguments[i];
+		switch (arg.type)
+		{
+			case argument::kind::direct:
+			case argument::kind::extend:
+			{
+				result.push_back(value);
+				break;
+			}
+			case argument::kind::indirect:
+			{
+				auto copy = builder.CreateBitCast(create_temporary(builder, arg), arg.value_type->getPointerTo());
+				builder.CreateAlignedStore(value, copy, arg.alignment);
+				result.push_back(copy);
+				break;
+			}
+			case argument::kind::coerce:
+			{
+				auto temporary = create_temporary(builder, arg);
+				builder.CreateAlignedStore(value, builder.CreateBitCast(temporary, arg.value_type->getPointerTo()), arg.alignment);
+
+				auto coerced = builder.CreateBitCast(temporary, arg.coerced->getPointerTo());
+				if (auto pieces = llvm::dyn_cast<llvm::StructType>(arg.coerced))
+				{
+					for (unsigned j = 0; j < pieces->getNumElements(); ++j)
+					{
+						result.push_back(builder.CreateLoad(pieces->getElementType(j), builder.CreateStructGEP(pieces, coerced, j)));
+					}
+				}
+				else
+				{
+					result.push_back(builder.CreateLoad(arg.coerced, coerced));
+				}
+				break;
+			}
+			case argument::kind::ignore:
+			{
+				break;
+			}
+		}
+	}
+
+	return result;
+}
+
+llvm::Value* code_gen::abi_lowering::lower_result(llvm::IRBuilder<>& builder, const signature& sig, llvm::CallBase* call, llvm::Value* sret) const
+{
+	const auto& ret = sig.ret;
+	switch (ret.type)
+	{
+		case argument::kind::indirect:
+		{
+			return builder.CreateAlignedLoad(ret.value_type, sret, ret.alignment);
+		}
+		case argument::kind::coerce:
+		{
+			auto temporary = create_temporary(builder, ret);
+			builder.CreateStore(call, builder.CreateBitCast(temporary, ret.coerced->getPointerTo()));
+			return builder.CreateAlignedLoad(ret.value_type, builder.CreateBitCast(temporary, ret.value_type->getPointerTo()), ret.alignment);
+		}
+		case argument::kind::ignore:
+		{
+			return ret.value_type->isVoidTy() ? static_cast<llvm::Value*>(call) : llvm::UndefValue::get(ret.value_type);
+		}
+		default:
+		{
+			return call;
+		}
+	}
+}
+
+std::vector<llvm::Value*> code_gen::abi_lowering::raise_arguments(llvm::IRBuilder<>& builder, const signature& sig, llvm::Function* function) const
+{
+	std::vector<llvm::Value*> result;
+	result.reserve(sig.params.size());
+
+	for (const auto& arg : sig.params)
+	{
+		switch (arg.type)
+		{
+			case argument::kind::direct:
+			case argument::kind::extend:
+			{
+				result.push_back(function->getArg(arg.first));
+				break;
+			}
+			case argument::kind::indirect:
+			{
+				result.push_back(builder.CreateAlignedLoad(arg.value_type, function->getArg(arg.first), arg.alignment));
+				break;
+			}
+			case argument::kind::coerce:
+			{
+				auto temporary = create_temporary(builder, arg);
+				auto coerced = builder.CreateBitCast(temporary, arg.coerced->getPointerTo());
+				if (auto pieces = llvm::dyn_cast<llvm::StructType>(arg.coerced))
+				{
+					for (unsigned j = 0; j < pieces->getNumElements(); ++j)
+					{
+						builder.CreateStore(function->getArg(arg.first + j), builder.CreateStructGEP(pieces, coerced, j));
+					}
+				}
+				else
+				{
+					builder.CreateStore(function->getArg(arg.first), coerced);
+				}
+				result.push_back(builder.CreateAlignedLoad(arg.value_type, builder.CreateBitCast(temporary, arg.value_type->getPointerTo()), arg.alignment));
+				break;
+			}
+			case argument::kind::ignore:
+			{
+				result.push_back(llvm::UndefValue::get(arg.value_type));
+				break;
+			}
+		}
+	}
+
+	return result;
+}
+
+void code_gen::abi_lowering::create_return(llvm::IRBuilder<>& builder, const signature& sig, llvm::Function* function, llvm::Value* value) const
+{
+	const auto& ret = sig.ret;
+	switch (ret.type)
+	{
+		case argument::kind::direct:
+		case argument::kind::extend:
+		{
+			builder.CreateRet(value);
+			break;
+		}
+		case argument::kind::indirect:
+		{
+			builder.CreateAlignedStore(value, function->getArg(0), ret.alignment);
+			builder.CreateRetVoid();
+			break;
+		}
+		case argument::kind::coerce:
+		{
+			auto temporary = create_temporary(builder, ret);
+			builder.CreateAlignedStore(value, builder.CreateBitCast(temporary, ret.value_type->getPointerTo()), ret.alignment);
+			builder.CreateRet(builder.CreateLoad(ret.coerced, builder.CreateBitCast(temporary, ret.coerced->getPointerTo())));
+			break;
+		}
+		case argument::kind::ignore:
+		{
+			builder.CreateRetVoid();
+			break;
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallBitVector.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+
+#include <vector>
+
+namespace seam::compiler::code_gen
+{
+	// the c calling convention for extern and @export functions. llvm passes a first-class struct one element per register,
+	// which is only what c does by accident, so every argument is classified the way the target's c compiler would:
+	// x86-64 sysv splits aggregates of up to 16 bytes into integer and sse eightbytes and passes bigger ones byval,
+	// aarch64 passes homogeneous float aggregates in fp registers, other small ones in x registers and big ones by reference,
+	// windows x64 passes aggregates of 1, 2, 4 or 8 bytes as an integer and every other one by reference.
+	// big return values go through an sret pointer. other targets get the plain llvm types
+	class abi_lowering
+	{
+	public:
+		struct argument
+		{
+			enum class kind
+			{
+				direct, // as it is
+				extend, // an integer narrower than 32 bits the caller widens, signext or zeroext
+				coerce, // reinterpreted as `coerced`, a struct stands for one llvm argument per element
+				indirect, // in memory, byval or a pointer to a copy for arguments and sret for the return value
+				ignore, // void
+			};
+
+			kind type = kind::direct;
+			llvm::Type* value_type = nullptr; // the seam side
+			llvm::Type* coerced = nullptr;
+			bool is_signed = false;
+			bool byval = false; // the callee gets its own copy on the stack, otherwise the caller makes one
+			llvm::Align alignment;
+
+			unsigned first = 0; // of the llvm arguments it became
+			unsigned count = 0;
+		};
+
+		struct signature
+		{
+			llvm::FunctionType* type = nullptr;
+			argument ret;
+			std::vector<argument> params;
+
+			// every value crosses as it is, the function can be used without going through the lowering
+			bool is_trivial() const;
+		};
+	private:
+		enum class reg_class
+		{
+			none,
+			integer,
+			sse,
+			memory,
+		};
+
+		// classes with layout attributes are packed structs with the padding spelled out, llvm doesn't know their alignment
+		struct explicit_layout
+		{
+			llvm::Align alignment;
+			llvm::SmallBitVector padding; // by element
+		};
+
+		// registers c has for arguments on x86-64 sysv
+		constexpr static unsigned sysv_integer_registers = 6;
+		constexpr static unsigned sysv_sse_registers = 8;
+
+		llvm::Module& mod;
+		const llvm::DataLayout& data_layout;
+		llvm::Triple triple;
+
+		llvm::DenseMap<llvm::StructType*, explicit_layout> explicit_layouts;
+
+		llvm::Align get_alignment(llvm::Type* type) const;
+		// calls `leaf` with the offset of every scalar or vector in the type, false if one isn't naturally aligned
+		template <typename F>
+		bool for_each_leaf(llvm::Type* type, std::uint64_t offset, F&& leaf) const;
+
+		void classify_sysv(argument& arg, bool is_return, unsigned& integer_registers, unsigned& sse_registers) const;
+		void classify_aarch64(argument& arg, bool is_return) const;
+		void classify_win64(argument& arg, bool is_return) const;
+
+		llvm::AllocaInst* create_temporary(llvm::IRBuilder<>& builder, const argument& arg) const;
+	public:
+		// checks the layout is the target's, classifying against any other one silently breaks every call across the boundary
+		abi_lowering(llvm::Module& mod, const llvm::DataLayout& data_layout);
+
+		void add_explicit_layout(llvm::StructType* type, llvm::Align alignment, llvm::SmallBitVector padding);
+
+		// the signature a c compiler would give a function taking and returning these, is_signed says how to extend small integers
+		signature classify(llvm::Type* ret, bool ret_signed, const std::vector<std::pair<llvm::Type*, bool>>& params);
+
+		// sret, byval, signext and zeroext, on a declaration and on every call of it
+		void add_attributes(llvm::Function* function, const signature& sig) const;
+		void add_attributes(llvm::CallBase* call, const signature& sig) const;
+
+		// caller side, the seam arguments become the llvm ones. the result of the call goes through lower_result,
+		// which needs the same `sret` slot if there is one
+		std::vector<llvm::Value*> lower_arguments(llvm::IRBuilder<>& builder, const signature& sig, const std::vector<llvm::Value*>& arguments, llvm::Value*& sret) const;
+		llvm::Value* lower_result(llvm::IRBuilder<>& builder, const signature& sig, llvm::CallBase* call, llvm::Value* sret) const;
+
+		// callee side, for a function with the c signature that passes everything on to the seam one
+		std::vector<llvm::Value*> raise_arguments(llvm::IRBuilder<>& builder, const signature& sig, llvm::Function* function) const;
+		void create_return(llvm::IRBuilder<>& builder, const signature& sig, llvm::Function* function, llvm::Value* value) const;
+	};
+}
@@ -2,16 +2,35 @@
 
 #include "../utils/exception.h"
 
+#include <llvm/ADT/Triple.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/ModuleUtils.h>
 
+#include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <optional>
+#include <variant>
 #include <array>
 #include <iostream>
 
 
 #include "../parser/passes/symbol_collector.h"
 #include "../parser/passes/variable_resolver.h"
+#include "../parser/passes/call_graph.h"
+#include "../parser/passes/attribute_checker.h"
+#include "../parser/passes/literal_typer.h"
+#include "../parser/passes/constant_folder.h"
+#include "../ir/cfg/cfg_builder.h"
+#include "switch_lowering.h"
+#include "target_clones.h"
 
 static_assert(sizeof(float) == 4, "float size non standard");
 static_assert(sizeof(double) == 8, "double size non standard");
@@ -28,6 +47,7 @@ namespace seam::compiler::code_gen
 		code_gen& gen;
 
 		llvm::Value* val = nullptr;
+		llvm::BasicBlock* unwind_dest = nullptr; // landing pad of the try the current block is in
 
 		bool visit(ir::ast::node* node) override
 		{
@@ -51,29 +71,7 @@ namespace seam::compiler::code_gen
 
 		bool visit(ir::ast::expression::literal<std::string>* node) override
 		{
-			// TODO: test
-			// TODO: check if getIntNTy takes bits or bytes
-			auto size_type = llvm::Type::getIntNTy(gen.llvm_mod->getContext(), gen.data_layout->getMaxPointerSizeInBits());
-			auto char_array_type = llvm::ArrayType::get(llvm::Type::getInt8Ty(gen.llvm_mod->getContext()), node->val.size());
-
-			std::array<llvm::Type*, 2> struct_fields{ size_type, char_array_type };
-			auto struct_type = llvm::StructType::get(gen.llvm_mod->getContext(), llvm::makeArrayRef(struct_fields), false);
-			auto str_const = llvm::ConstantDataArray::getString(gen.llvm_mod->getContext(), node->val, false);
-
-			auto size_const  = llvm::ConstantInt::get(gen.llvm_mod->getContext(),
-				llvm::APInt(gen.data_layout->getMaxPointerSizeInBits(), node->val.size(), false));
-			auto struct_const = llvm::ConstantStruct::get(struct_type, size_const, str_const);
-			auto global_var = new llvm::GlobalVariable{ *gen.llvm_mod, struct_const->getType(),
-				true, llvm::GlobalValue::PrivateLinkage, struct_const };
-			global_var->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
-			global_var->setAlignment(llvm::Align(1));
-			val = global_var;
-			auto zero = llvm::ConstantInt::get(gen.llvm_mod->getContext(), llvm::APInt(32, 0, true));
-			std::array<llvm::Constant*, 2> indicies = {zero, zero};
-			val = llvm::ConstantExpr::getInBoundsGetElementPtr(global_var->getValueType(), global_var, llvm::makeArrayRef(indicies)); // size_type*
-			/*
-			val->getType()->print(llvm::outs());
-			llvm::outs() << '\n';*/
+			val = gen.get_string_literal(node->val);
 			return false;
 		}
 
@@ -148,9 +146,45 @@ namespace seam::compiler::code_gen
 			return false;
 		}
 	
+		void visit_constant(const comptime::value& constant, ir::ast::position_range range)
+		{
+			val = nullptr;
+			if (auto literal = comptime::make_literal(constant, range))
+			{
+				literal->visit(this);
+			}
+		}
+
 		// TODO: **disallow** calling of constructors
 		bool visit(ir::ast::expression::call* node) override
 		{
+			if (auto table = get_constant_array(node))
+			{
+				val = load(*table);
+				return false;
+			}
+
+			// calls with constant arguments to functions that never leave the module are replaced by their result
+			if (auto result = gen.interpreter.evaluate(node); result && !std::holds_alternative<std::monostate>(*result)
+				&& !std::holds_alternative<comptime::array_value>(*result))
+			{
+				visit_constant(*result, node->range);
+				return false;
+			}
+
+			auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get());
+			if (auto builtin = callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr)
+			{
+				val = create_builtin(node, builtin);
+				return false;
+			}
+
+			auto callee = callee_var ? dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()) : nullptr;
+			if (callee && callee->def_stat->attributes.find("comptime") != callee->def_stat->attributes.cend())
+			{
+				throw exception(node->range.start, "call to @comptime function '" + callee->def_stat->name + "' could not be evaluated at compile time");
+			}
+
 			node->func->visit(this);
 			if (!llvm::isa<llvm::Function>(val))
 			{
@@ -160,254 +194,2539 @@ namespace seam::compiler::code_gen
 			auto func_val = reinterpret_cast<llvm::Function*>(val);
 			
 			std::vector<llvm::Value*> arguments;
+			for (std::size_t i = 0; i < node->arguments.size(); ++i)
+			{
+				auto& arg = node->arguments[i];
+				if (callee && func_val->getCallingConv() == llvm::CallingConv::Fast && i < callee->def_stat->arguments.size()
+					&& gen.passes_by_pointer(std::get<ir::types::type_reference>(callee->def_stat->arguments[i].type_)))
+				{
+					arguments.push_back(create_array_argument(arg.get(), callee->def_stat, i));
+					continue;
+				}
+
+				arg->visit(this);
+				gen.push_argument(arguments, func_val, val);
+			}
+
+			// externs and exports that take everything as it is follow the c abi, the rest is called like any seam function
+			const abi_lowering::signature* c_signature = nullptr;
+			llvm::Value* sret = nullptr;
+			if (callee && func_val->getCallingConv() != llvm::CallingConv::Fast)
+			{
+				c_signature = &gen.get_c_signature(callee->def_stat);
+				arguments = gen.c_abi->lower_arguments(gen.builder, *c_signature, arguments, sret);
+			}
+
+			llvm::CallBase* call;
+
+			// inside a try a call that can throw has to be an invoke, which ends the block
+			if (unwind_dest && (!callee || gen.function_effects[callee->def_stat].unwinds))
+			{
+				auto current_block = gen.builder.GetInsertBlock();
+				auto normal_dest = llvm::BasicBlock::Create(gen.llvm_mod->getContext(), "", current_block->getParent(), current_block->getNextNode());
+
+				call = gen.builder.CreateInvoke(func_val, normal_dest, unwind_dest, llvm::makeArrayRef(arguments));
+				gen.ssa.seal_block(normal_dest);
+				gen.builder.SetInsertPoint(normal_dest);
+			}
+			else
+			{
+				call = gen.builder.CreateCall(func_val, llvm::makeArrayRef(arguments));
+			}
+			call->setCallingConv(func_val->getCallingConv());
+
+			val = call;
+			if (c_signature)
+			{
+				gen.c_abi->add_attributes(call, *c_signature);
+				val = gen.c_abi->lower_result(gen.builder, *c_signature, call, sret);
+				if (dynamic_cast<ir::ast::statement::extern_definition*>(callee->def_stat))
+				{
+					val = gen.normalize_from_c(val, std::get<ir::types::type_reference>(callee->def_stat->return_type));
+				}
+			}
+			return false;
+		}
+
+		// branches off to a throw of `message` when `failed` holds, the code after the check goes into a new block.
+		// windows has no unwinder the runtime supports, there a failed check traps
+		void create_check(llvm::Value* failed, const std::string& message)
+		{
+			auto& context = gen.llvm_mod->getContext();
+			auto current_block = gen.builder.GetInsertBlock();
+			auto passed_block = llvm::BasicBlock::Create(context, "", current_block->getParent(), current_block->getNextNode());
+			auto failed_block = llvm::BasicBlock::Create(context, "check_failed", current_block->getParent());
+
+			// the weights __builtin_expect gives, the failing side ends up out of the way
+			gen.builder.CreateCondBr(failed, failed_block, passed_block, llvm::MDBuilder{ context }.createBranchWeights(1, (1u << 20) - 1));
+			gen.ssa.seal_block(failed_block);
+			gen.ssa.seal_block(passed_block);
+
+			gen.builder.SetInsertPoint(failed_block);
+			if (llvm::Triple{ gen.llvm_mod->getTargetTriple() }.isOSWindows())
+			{
+				gen.builder.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+			}
+			else if (unwind_dest)
+			{
+				auto unreachable_block = llvm::BasicBlock::Create(context, "", current_block->getParent());
+				gen.builder.CreateInvoke(gen.get_throw_function(), unreachable_block, unwind_dest, gen.get_throw_arguments(gen.get_string_literal(message)));
+				gen.ssa.seal_block(unreachable_block);
+				gen.builder.SetInsertPoint(unreachable_block);
+			}
+			else
+			{
+				gen.builder.CreateCall(gen.get_throw_function(), gen.get_throw_arguments(gen.get_string_literal(message)));
+			}
+			gen.builder.CreateUnreachable();
+
+			gen.builder.SetInsertPoint(passed_block);
+		}
+
+		// integer builtins and hints, straight to the llvm intrinsic. nullptr for the vector ones
+		llvm::Value* create_integer_builtin(ir::ast::expression::builtin_function* builtin, const std::vector<llvm::Value*>& arguments)
+		{
+			const auto is_signed = ir::types::is_signed_integer(ir::types::scalar_type(builtin->operand_type.get()));
+			auto type = arguments.front()->getType();
+
+			auto create_checked = [&](llvm::Intrinsic::ID id, llvm::Instruction::BinaryOps op)
+			{
+				// range_analysis proved it fits, which the optimizer can make use of too
+				if (!builtin->checked)
+				{
+					auto result = gen.builder.CreateBinOp(op, arguments[0], arguments[1]);
+					if (auto instruction = llvm::dyn_cast<llvm::BinaryOperator>(result))
+					{
+						instruction->setHasNoSignedWrap(is_signed);
+						instruction->setHasNoUnsignedWrap(!is_signed);
+					}
+					return result;
+				}
+
+				auto result = gen.builder.CreateBinaryIntrinsic(id, arguments[0], arguments[1]);
+				create_check(gen.builder.CreateExtractValue(result, 1), "integer overflow");
+				return gen.builder.CreateExtractValue(result, 0);
+			};
+
+			switch (builtin->kind)
+			{
+				case ir::ast::builtin::popcount:
+				{
+					return gen.builder.CreateUnaryIntrinsic(llvm::Intrinsic::ctpop, arguments[0]);
+				}
+				case ir::ast::builtin::ctz:
+				{
+					// defined for 0, x86 without bmi needs a branch or cmov for that, tzcnt and rbit + clz don't
+					return gen.builder.CreateIntrinsic(llvm::Intrinsic::cttz, { type }, { arguments[0], gen.builder.getFalse() });
+				}
+				case ir::ast::builtin::clz:
+				{
+					return gen.builder.CreateIntrinsic(llvm::Intrinsic::ctlz, { type }, { arguments[0], gen.builder.getFalse() });
+				}
+				case ir::ast::builtin::bswap:
+				{
+					// llvm.bswap needs whole pairs of bytes, a single byte is already swapped
+					return type->getScalarSizeInBits() == 8 ? arguments[0] : gen.builder.CreateUnaryIntrinsic(llvm::Intrinsic::bswap, arguments[0]);
+				}
+				case ir::ast::builtin::fshl:
+				{
+					return gen.builder.CreateIntrinsic(llvm::Intrinsic::fshl, { type }, arguments);
+				}
+				case ir::ast::builtin::fshr:
+				{
+					return gen.builder.CreateIntrinsic(llvm::Intrinsic::fshr, { type }, arguments);
+				}
+				case ir::ast::builtin::checked_add:
+				{
+					return create_checked(is_signed ? llvm::Intrinsic::sadd_with_overflow : llvm::Intrinsic::uadd_with_overflow, llvm::Instruction::Add);
+				}
+				case ir::ast::builtin::checked_sub:
+				{
+					return create_checked(is_signed ? llvm::Intrinsic::ssub_with_overflow : llvm::Intrinsic::usub_with_overflow, llvm::Instruction::Sub);
+				}
+				case ir::ast::builtin::checked_mul:
+				{
+					return create_checked(is_signed ? llvm::Intrinsic::smul_with_overflow : llvm::Intrinsic::umul_with_overflow, llvm::Instruction::Mul);
+				}
+				case ir::ast::builtin::expect:
+				{
+					return gen.builder.CreateIntrinsic(llvm::Intrinsic::expect, { type }, arguments);
+				}
+				case ir::ast::builtin::assume:
+				{
+					return gen.builder.CreateAssumption(to_condition(arguments[0]));
+				}
+				case ir::ast::builtin::prefetch:
+				{
+					// rw, locality and data (1) rather than instruction cache
+					auto constant = [&](std::size_t i, std::uint32_t default_value)
+					{
+						return i < arguments.size() ? gen.builder.CreateIntCast(arguments[i], gen.builder.getInt32Ty(), false) : gen.builder.getInt32(default_value);
+					};
+
+					auto data = string_parts(arguments[0]).first;
+					return gen.builder.CreateIntrinsic(llvm::Intrinsic::prefetch, { data->getType() }, { data, constant(1, 0), constant(2, 3), gen.builder.getInt32(1) });
+				}
+				default:
+				{
+					return nullptr;
+				}
+			}
+		}
+
+		// the length of an array is part of its type, the array itself is only evaluated for what that does
+		llvm::Value* create_len(ir::ast::expression::expression* operand, ir::types::type_descriptor* type)
+		{
+			if (auto array = ir::types::as_array(type))
+			{
+				if (!dynamic_cast<ir::ast::expression::variable*>(operand))
+				{
+					operand->visit(this);
+				}
+				return gen.builder.getInt64(array->length);
+			}
+
+			operand->visit(this);
+			return gen.builder.CreateZExt(string_parts(val).second, gen.builder.getInt64Ty());
+		}
+
+		// builtins, they all map to a single instruction or intrinsic
+		llvm::Value* create_builtin(ir::ast::expression::call* node, ir::ast::expression::builtin_function* builtin)
+		{
+			if (builtin->kind == ir::ast::builtin::len)
+			{
+				return create_len(node->arguments.front().get(), builtin->operand_type.get());
+			}
+
+			if (builtin->kind == ir::ast::builtin::load || builtin->kind == ir::ast::builtin::store)
+			{
+				return create_vector_access(node, builtin);
+			}
 
+			std::vector<llvm::Value*> arguments;
+			arguments.reserve(node->arguments.size());
 			for (auto& arg : node->arguments)
 			{
 				arg->visit(this);
 				arguments.push_back(val);
 			}
 
-			val = gen.builder.CreateCall(func_val, llvm::makeArrayRef(arguments));
-			return false;
+			if (auto result = create_integer_builtin(builtin, arguments))
+			{
+				return result;
+			}
+
+			const auto vector = ir::types::as_vector(builtin->operand_type.get());
+			const auto is_float = ir::types::is_floating_point(vector->element.get());
+			const auto is_signed = ir::types::is_signed_integer(vector->element.get());
+
+			// the lane count is a power of two, a lane only known at runtime wraps around instead of producing poison
+			auto lane_index = [&](llvm::Value* index)
+			{
+				return gen.builder.CreateAnd(index, llvm::ConstantInt::get(index->getType(), vector->lanes - 1));
+			};
+
+			switch (builtin->kind)
+			{
+				case ir::ast::builtin::make_vector:
+				{
+					if (arguments.size() == 1)
+					{
+						return gen.builder.CreateVectorSplat(vector->lanes, arguments.front());
+					}
+
+					llvm::Value* result = llvm::PoisonValue::get(gen.get_llvm_type(vector));
+					for (unsigned i = 0; i < vector->lanes; ++i)
+					{
+						result = gen.builder.CreateInsertElement(result, arguments[i], gen.builder.getInt32(i));
+					}
+					return result;
+				}
+				case ir::ast::builtin::lane:
+				{
+					return gen.builder.CreateExtractElement(arguments[0], lane_index(arguments[1]));
+				}
+				case ir::ast::builtin::with_lane:
+				{
+					return gen.builder.CreateInsertElement(arguments[0], arguments[2], lane_index(arguments[1]));
+				}
+				case ir::ast::builtin::shuffle:
+				{
+					std::vector<int> mask;
+					for (auto it = arguments.cbegin() + 2; it != arguments.cend(); ++it)
+					{
+						mask.push_back(static_cast<int>(llvm::cast<llvm::ConstantInt>(*it)->getZExtValue()));
+					}
+					return gen.builder.CreateShuffleVector(arguments[0], arguments[1], mask);
+				}
+				case ir::ast::builtin::reduce_add:
+				{
+					// without reassociation a float sum is added up in lane order, -0.0 leaves the first lane as is
+					return is_float ? gen.builder.CreateFAddReduce(llvm::ConstantFP::getNegativeZero(arguments[0]->getType()->getScalarType()), arguments[0])
+						: gen.builder.CreateAddReduce(arguments[0]);
+				}
+				case ir::ast::builtin::reduce_mul:
+				{
+					return is_float ? gen.builder.CreateFMulReduce(llvm::ConstantFP::get(arguments[0]->getType()->getScalarType(), 1.0), arguments[0])
+						: gen.builder.CreateMulReduce(arguments[0]);
+				}
+				case ir::ast::builtin::reduce_min:
+				{
+					return is_float ? gen.builder.CreateFPMinReduce(arguments[0]) : gen.builder.CreateIntMinReduce(arguments[0], is_signed);
+				}
+				case ir::ast::builtin::reduce_max:
+				{
+					return is_float ? gen.builder.CreateFPMaxReduce(arguments[0]) : gen.builder.CreateIntMaxReduce(arguments[0], is_signed);
+				}
+				default:
+				{
+					return nullptr;
+				}
+			}
 		}
 
-		bool visit(ir::ast::expression::variable* node) override
+		// load(a, i) and store(a, i, v), a single vector load or store aligned like the elements rather than like the vector
+		llvm::Value* create_vector_access(ir::ast::expression::call* node, ir::ast::expression::builtin_function* builtin)
 		{
-			return true;
+			auto object = node->arguments[0].get();
+			auto element = ir::types::element_type(builtin->operand_type.get())->get();
+			auto element_type = gen.get_llvm_type(element);
+			auto alignment = gen.get_alignment(element);
+
+			llvm::Value* data;
+			llvm::Value* length;
+			if (auto array = ir::types::as_array(builtin->operand_type.get()))
+			{
+				auto source = get_place(object);
+				if (!source)
+				{
+					object->visit(this);
+					source = spill(val, array);
+				}
+
+				data = gen.builder.CreateInBoundsGEP(source->type, source->pointer, { gen.builder.getInt64(0), gen.builder.getInt64(0) });
+				length = gen.builder.getInt64(array->length);
+				alignment = std::min(alignment, source->alignment);
+			}
+			else
+			{
+				object->visit(this);
+				std::tie(data, length) = string_parts(val);
+				length = gen.builder.CreateZExt(length, gen.builder.getInt64Ty());
+			}
+
+			node->arguments[1]->visit(this);
+			auto index = extend_index(val, builtin->index_type.get());
+
+			llvm::Value* stored = nullptr;
+			if (builtin->kind == ir::ast::builtin::store)
+			{
+				node->arguments[2]->visit(this);
+				stored = val;
+			}
+
+			create_bounds_check(builtin->checked, builtin->hoisted, index, length, builtin->lanes);
+
+			auto vector_type = llvm::FixedVectorType::get(element_type, builtin->lanes);
+			auto pointer = gen.builder.CreateBitCast(gen.builder.CreateInBoundsGEP(element_type, data, index), vector_type->getPointerTo());
+			if (!stored)
+			{
+				return gen.builder.CreateAlignedLoad(vector_type, pointer, alignment);
+			}
+			return gen.builder.CreateAlignedStore(stored, pointer, alignment);
 		}
 
-		bool visit(ir::ast::expression::unresolved_variable* node) override
+		// somewhere in memory a value is loaded from and stored to, a local array or an element or a field of one
+		struct place
 		{
-			throw exception(node->range.start, "unresolved variable encountered during code generation");
-			return true;
+			llvm::Value* pointer;
+			llvm::Type* type;
+			llvm::Align alignment;
+			ir::types::type_descriptor* desc;
+			// an element of an array of a @soa class is spread over the arrays of its fields, `pointer` points to all of them
+			llvm::Type* soa_type = nullptr;
+			llvm::Value* soa_index = nullptr;
+		};
+
+		// what an assignment stores. an array is copied from where it is, a literal is filled in element by element
+		struct stored_value
+		{
+			llvm::Value* value = nullptr;
+			std::optional<place> from;
+			std::vector<llvm::Value*> elements; // a single one fills the whole array
+		};
+
+		// non-optional arrays, locals and parameters of them live in a slot instead of an ssa value.
+		// a parameter passed by pointer uses the caller's memory as its slot
+		std::unordered_map<const ir::ast::var*, place> array_slots;
+		// whether the checks hoisted out of a loop held on the way into it
+		llvm::DenseMap<const ir::ast::hoisted_check*, llvm::Value*> hoisted_guards;
+
+		static bool is_array(const ir::ast::var* var)
+		{
+			const auto& type_ref = std::get<ir::types::type_reference>(var->type_);
+			return !type_ref.is_optional && ir::types::as_array(type_ref.type.get());
 		}
 
-		bool visit(ir::ast::expression::function_variable* node) override
+		// allocated up front in the entry block, where sroa and mem2reg look for them
+		llvm::AllocaInst* create_slot(ir::types::type_descriptor* type)
 		{
-			val = gen.get_or_declare_function(node->symbol, node->def_stat);
-			return false;
+			auto& entry = gen.builder.GetInsertBlock()->getParent()->getEntryBlock();
+			llvm::IRBuilder<> entry_builder{ &entry, entry.begin() };
+
+			auto slot = entry_builder.CreateAlloca(gen.get_llvm_type(type));
+			slot->setAlignment(gen.get_alignment(type));
+			return slot;
 		}
 
-		bool visit(ir::ast::statement::expression_statement* node) override
+		place slot_place(llvm::AllocaInst* slot, ir::types::type_descriptor* type)
 		{
-			return true;
+			return { slot, slot->getAllocatedType(), slot->getAlign(), type };
 		}
 
-		bool visit(ir::ast::statement::type_definition* node) override
+		// values that aren't anywhere in memory yet, like the result of a call, get a slot to be indexed in
+		place spill(llvm::Value* value, ir::types::type_descriptor* type)
 		{
-			return true;
+			auto slot = slot_place(create_slot(type), type);
+			store(slot, value);
+			return slot;
 		}
 
-		bool visit(ir::ast::statement::extern_definition* node) override
+		bool is_whole_array(const place& target)
 		{
-			return true;
+			return ir::types::as_array(target.desc) && target.type == gen.get_llvm_type(target.desc);
 		}
 
-		bool visit(ir::ast::statement::function_definition* node) override
+		llvm::Value* load(const place& source)
 		{
-			return true;
+			if (!source.soa_type)
+			{
+				return gen.builder.CreateAlignedLoad(source.type, source.pointer, source.alignment);
+			}
+
+			// gathered from the array of every field
+			auto class_type = static_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(source.desc));
+			const auto& layout = gen.get_class_layout(class_type);
+			llvm::Value* value = llvm::UndefValue::get(layout.type);
+			for (unsigned i = 0; i < class_type->fields.size(); ++i)
+			{
+				auto field = get_field(source, class_type, i);
+				value = gen.builder.CreateInsertValue(value, load(field), layout.field_indices[i]);
+			}
+			return value;
 		}
 
-		bool visit(ir::ast::statement::alias_type_definition* node) override
+		void store(const place& target, llvm::Value* value)
 		{
-			return true;
+			if (!target.soa_type)
+			{
+				gen.builder.CreateAlignedStore(value, target.pointer, target.alignment);
+				return;
+			}
+
+			auto class_type = static_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(target.desc));
+			const auto& layout = gen.get_class_layout(class_type);
+			for (unsigned i = 0; i < class_type->fields.size(); ++i)
+			{
+				store(get_field(target, class_type, i), gen.builder.CreateExtractValue(value, layout.field_indices[i]));
+			}
 		}
 
-		bool visit(ir::ast::statement::class_type_definition* node) override
+		place get_field(const place& object, ir::types::class_type_descriptor* class_type, unsigned field_index)
 		{
-			return true;
+			auto& field = class_type->fields[field_index];
+			auto type = gen.get_llvm_type(field.type);
+
+			// the arrays of a @soa class are in declaration order
+			if (object.soa_type)
+			{
+				auto pointer = gen.builder.CreateInBoundsGEP(object.soa_type, object.pointer, { gen.builder.getInt64(0), gen.builder.getInt32(field_index), object.soa_index });
+				return { pointer, type, std::min(object.alignment, gen.get_alignment(field.type)), field.type.type.get() };
+			}
+
+			const auto& layout = gen.get_class_layout(class_type);
+			const auto element = layout.field_indices[field_index];
+			const auto offset = gen.data_layout->getStructLayout(layout.type)->getElementOffset(element);
+			auto pointer = gen.builder.CreateStructGEP(layout.type, object.pointer, element);
+			return { pointer, type, llvm::commonAlignment(object.alignment, offset), field.type.type.get() };
 		}
 
-		bool visit(ir::ast::statement::block* node) override
+		place get_element(const place& array, llvm::Value* index)
 		{
-			return true;
+			auto element = ir::types::as_array(array.desc)->element.get();
+			auto type = gen.get_llvm_type(element);
+			const auto alignment = std::min(array.alignment, gen.get_alignment(element));
+
+			auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(element));
+			if (class_type && class_type->soa)
+			{
+				return { array.pointer, type, alignment, element, array.type, index };
+			}
+
+			auto pointer = gen.builder.CreateInBoundsGEP(array.type, array.pointer, { gen.builder.getInt64(0), index });
+			return { pointer, type, alignment, element };
 		}
 
-		bool visit(ir::ast::statement::restricted_block* node) override
+		// indices and bounds are compared as 64 bit, a negative one wraps around to something no length can reach
+		llvm::Value* extend_index(llvm::Value* index, ir::types::type_descriptor* type)
 		{
-			return true;
+			return ir::types::is_signed_integer(type) ? gen.builder.CreateSExt(index, gen.builder.getInt64Ty()) : gen.builder.CreateZExt(index, gen.builder.getInt64Ty());
+		}
+
+		// `lanes` elements from the index on have to be in bounds, more than one for a load or store
+		void create_bounds_check(bool checked, const ir::ast::hoisted_check* hoisted, llvm::Value* index, llvm::Value* length, std::uint64_t lanes)
+		{
+			if (!checked)
+			{
+				return;
+			}
+
+			// index + lanes could wrap around, length - index can't once the index is below the length
+			auto out_of_bounds = [&]
+			{
+				auto failed = gen.builder.CreateICmpUGE(index, length);
+				if (lanes > 1)
+				{
+					failed = gen.builder.CreateOr(failed, gen.builder.CreateICmpULT(gen.builder.CreateSub(length, index), gen.builder.getInt64(lanes)));
+				}
+				return failed;
+			};
+
+			auto guard = hoisted ? hoisted_guards.lookup(hoisted) : nullptr;
+			if (!guard)
+			{
+				create_check(out_of_bounds(), "index out of bounds");
+				return;
+			}
+
+			// the check in front of the loop only failing means some index might still be in bounds, those are checked one by one.
+			// the guard doesn't change in the loop, so it can be unswitched into a copy without any checks
+			auto& context = gen.llvm_mod->getContext();
+			auto current_block = gen.builder.GetInsertBlock();
+			auto check_block = llvm::BasicBlock::Create(context, "", current_block->getParent(), current_block->getNextNode());
+			auto passed_block = llvm::BasicBlock::Create(context, "", current_block->getParent(), check_block->getNextNode());
+			gen.builder.CreateCondBr(guard, passed_block, check_block);
+			gen.ssa.seal_block(check_block);
+
+			gen.builder.SetInsertPoint(check_block);
+			create_check(out_of_bounds(), "index out of bounds");
+			gen.builder.CreateBr(passed_block);
+			gen.ssa.seal_block(passed_block);
+			gen.builder.SetInsertPoint(passed_block);
+		}
+
+		// one comparison on the way into a loop for every check range_analysis hoisted out of it
+		void create_hoisted_guards(ir::ast::statement::while_statement* loop)
+		{
+			auto block = gen.builder.GetInsertBlock();
+			for (const auto& hoisted : loop->hoisted_checks)
+			{
+				llvm::Value* limit = gen.builder.getInt64(hoisted->constant_limit);
+				if (hoisted->limit)
+				{
+					limit = extend_index(gen.ssa.read_variable(hoisted->limit, block), std::get<ir::types::type_reference>(hoisted->limit->type_).type.get());
+				}
+
+				llvm::Value* length = gen.builder.getInt64(hoisted->array_length);
+				if (hoisted->sequence)
+				{
+					length = gen.builder.CreateZExt(string_parts(gen.ssa.read_variable(hoisted->sequence, block)).second, gen.builder.getInt64Ty());
+				}
+				hoisted_guards[hoisted.get()] = gen.builder.CreateICmpULE(limit, length);
+			}
+		}
+
+		// a call to a function returning an array that folds, like a table worked out by a @comptime function.
+		// the result goes into read-only data
+		std::optional<place> get_constant_array(ir::ast::expression::call* node)
+		{
+			auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get());
+			auto callee = callee_var ? dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()) : nullptr;
+			auto type_ref = callee ? std::get_if<ir::types::type_reference>(&callee->def_stat->return_type) : nullptr;
+			if (!type_ref || type_ref->is_optional || !ir::types::as_array(type_ref->type.get()))
+			{
+				return std::nullopt;
+			}
+
+			auto result = gen.interpreter.evaluate(node);
+			auto type = gen.get_llvm_type(*type_ref);
+			auto constant = result ? gen.get_constant(*result, type) : nullptr;
+			if (!constant)
+			{
+				return std::nullopt;
+			}
+
+			auto global = new llvm::GlobalVariable{ *gen.llvm_mod, type, true, llvm::GlobalValue::PrivateLinkage, constant };
+			global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+			global->setAlignment(gen.get_alignment(*type_ref));
+			return place{ global, type, gen.get_alignment(*type_ref), type_ref->type.get() };
+		}
+
+		// a place for local arrays, folded ones, their elements and the fields of those, std::nullopt for values without one.
+		// nothing has been evaluated when there's no place
+		std::optional<place> get_place(ir::ast::expression::expression* expr)
+		{
+			if (auto call = dynamic_cast<ir::ast::expression::call*>(expr))
+			{
+				return get_constant_array(call);
+			}
+
+			if (auto variable = dynamic_cast<ir::ast::expression::variable*>(expr))
+			{
+				auto local = dynamic_cast<ir::ast::expression::local_variable*>(variable->var.get());
+				auto slot = local ? array_slots.find(local->def) : array_slots.end();
+				if (slot == array_slots.end())
+				{
+					return std::nullopt;
+				}
+				return slot->second;
+			}
+
+			if (auto member = dynamic_cast<ir::ast::expression::member_access*>(expr))
+			{
+				auto object = get_place(member->object.get());
+				if (!object)
+				{
+					return std::nullopt;
+				}
+				return get_field(*object, member->object_type, static_cast<unsigned>(member->field_index));
+			}
+
+			auto access = dynamic_cast<ir::ast::expression::index_access*>(expr);
+			if (!access)
+			{
+				return std::nullopt;
+			}
+
+			auto index_type = access->index_type.get();
+			if (auto array = ir::types::as_array(access->object_type.get()))
+			{
+				auto object = get_place(access->object.get());
+				if (!object)
+				{
+					access->object->visit(this);
+					object = spill(val, access->object_type.get());
+				}
+
+				access->index->visit(this);
+				auto index = extend_index(val, index_type);
+				create_bounds_check(access->checked, access->hoisted, index, gen.builder.getInt64(array->length), 1);
+				return get_element(*object, index);
+			}
+
+			// a slice is laid out like a string
+			access->object->visit(this);
+			auto [data, length] = string_parts(val);
+			access->index->visit(this);
+			auto index = extend_index(val, index_type);
+			create_bounds_check(access->checked, access->hoisted, index, gen.builder.CreateZExt(length, gen.builder.getInt64Ty()), 1);
+
+			auto element = ir::types::as_slice(access->object_type.get())->element.get();
+			auto type = gen.get_llvm_type(element);
+			return place{ gen.builder.CreateInBoundsGEP(type, data, index), type, gen.get_alignment(element), element };
+		}
+
+		stored_value evaluate_stored(ir::ast::expression::expression* expr)
+		{
+			stored_value result;
+			if (auto array = dynamic_cast<ir::ast::expression::array_literal*>(expr))
+			{
+				for (auto& element : array->elements)
+				{
+					element->visit(this);
+					result.elements.push_back(val);
+				}
+			}
+			else if (auto source = get_place(expr); source && is_whole_array(*source))
+			{
+				result.from = source;
+			}
+			else if (source)
+			{
+				result.value = load(*source);
+			}
+			else
+			{
+				expr->visit(this);
+				result.value = val;
+			}
+			return result;
+		}
+
+		void store(const place& target, const stored_value& value)
+		{
+			if (value.from)
+			{
+				// the same array on both sides or one inside the other, only memmove copes with that
+				const auto size = gen.data_layout->getTypeAllocSize(target.type).getFixedSize();
+				gen.builder.CreateMemMove(target.pointer, target.alignment, value.from->pointer, value.from->alignment, size);
+			}
+			else if (value.value)
+			{
+				store(target, value.value);
+			}
+			else
+			{
+				fill(target, value.elements);
+			}
+		}
+
+		// a big array is passed as a pointer to a copy. one the callee neither changes nor can write behind its back
+		// through a slice needs no copy, it's used right where it is
+		llvm::Value* create_array_argument(ir::ast::expression::expression* arg, ir::ast::statement::function_declaration* callee, std::size_t index)
+		{
+			auto type = std::get<ir::types::type_reference>(callee->arguments[index].type_).type.get();
+			auto value = evaluate_stored(arg);
+
+			auto it = gen.function_effects.find(callee);
+			if (value.from && it != gen.function_effects.cend() && !it->second.writes_slices && index < it->second.modified.size() && !it->second.modified[index]
+				&& value.from->type == gen.get_llvm_type(type) && value.from->alignment >= gen.get_alignment(type))
+			{
+				return value.from->pointer;
+			}
+
+			auto copy = slot_place(create_slot(type), type);
+			store(copy, value);
+			return copy.pointer;
+		}
+
+		void fill(const place& target, const std::vector<llvm::Value*>& elements)
+		{
+			constexpr std::uint64_t max_unrolled = 16;
+
+			const auto length = ir::types::as_array(target.desc)->length;
+			if (elements.size() != 1 || length == 1)
+			{
+				for (std::size_t i = 0; i < elements.size(); ++i)
+				{
+					store(get_element(target, gen.builder.getInt64(i)), elements[i]);
+				}
+				return;
+			}
+
+			auto value = elements.front();
+			if (auto constant = llvm::dyn_cast<llvm::Constant>(value); constant && constant->isNullValue())
+			{
+				gen.builder.CreateMemSet(target.pointer, gen.builder.getInt8(0), gen.data_layout->getTypeAllocSize(target.type).getFixedSize(), target.alignment);
+				return;
+			}
+
+			if (length <= max_unrolled)
+			{
+				for (std::uint64_t i = 0; i < length; ++i)
+				{
+					store(get_element(target, gen.builder.getInt64(i)), value);
+				}
+				return;
+			}
+
+			// a loop of its own, which the vectorizer turns into wide stores
+			auto& context = gen.llvm_mod->getContext();
+			auto before_block = gen.builder.GetInsertBlock();
+			auto loop_block = llvm::BasicBlock::Create(context, "", before_block->getParent(), before_block->getNextNode());
+			auto done_block = llvm::BasicBlock::Create(context, "", before_block->getParent(), loop_block->getNextNode());
+			gen.builder.CreateBr(loop_block);
+			gen.ssa.seal_block(loop_block);
+
+			gen.builder.SetInsertPoint(loop_block);
+			auto index = gen.builder.CreatePHI(gen.builder.getInt64Ty(), 2);
+			index->addIncoming(gen.builder.getInt64(0), before_block);
+			store(get_element(target, index), value);
+
+			auto next = gen.builder.CreateAdd(index, gen.builder.getInt64(1), "", true, true);
+			index->addIncoming(next, loop_block);
+			gen.builder.CreateCondBr(gen.builder.CreateICmpEQ(next, gen.builder.getInt64(length)), done_block, loop_block);
+			gen.ssa.seal_block(done_block);
+			gen.builder.SetInsertPoint(done_block);
+		}
+
+		bool visit(ir::ast::expression::index_access* node) override
+		{
+			val = load(*get_place(node));
+			return false;
+		}
+
+		bool visit(ir::ast::expression::slice_access* node) override
+		{
+			llvm::Value* data;
+			llvm::Value* length;
+			if (auto array = ir::types::as_array(node->object_type.get()))
+			{
+				auto object = get_place(node->object.get());
+				if (!object)
+				{
+					node->object->visit(this);
+					object = spill(val, node->object_type.get());
+				}
+
+				data = gen.builder.CreateInBoundsGEP(object->type, object->pointer, { gen.builder.getInt64(0), gen.builder.getInt64(0) });
+				length = gen.builder.getInt64(array->length);
+			}
+			else
+			{
+				node->object->visit(this);
+				std::tie(data, length) = string_parts(val);
+				length = gen.builder.CreateZExt(length, gen.builder.getInt64Ty());
+			}
+
+			llvm::Value* from = gen.builder.getInt64(0);
+			llvm::Value* to = length;
+			if (node->from)
+			{
+				node->from->visit(this);
+				from = extend_index(val, node->from_type.get());
+			}
+			if (node->to)
+			{
+				node->to->visit(this);
+				to = extend_index(val, node->to_type.get());
+			}
+
+			if (node->checked && (node->from || node->to))
+			{
+				create_check(gen.builder.CreateOr(gen.builder.CreateICmpUGT(from, to), gen.builder.CreateICmpUGT(to, length)), "slice out of bounds");
+			}
+
+			auto type = llvm::cast<llvm::StructType>(gen.get_llvm_type(node->type.get()));
+			auto element_type = gen.get_llvm_type(ir::types::as_slice(node->type.get())->element.get());
+			val = llvm::UndefValue::get(type);
+			val = gen.builder.CreateInsertValue(val, gen.builder.CreateInBoundsGEP(element_type, data, from), 0);
+			val = gen.builder.CreateInsertValue(val, gen.builder.CreateTrunc(gen.builder.CreateSub(to, from), type->getElementType(1)), 1);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::array_literal* node) override
+		{
+			auto slot = slot_place(create_slot(node->type.get()), node->type.get());
+			store(slot, evaluate_stored(node));
+			val = load(slot);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::member_access* node) override
+		{
+			if (auto field = get_place(node))
+			{
+				val = load(*field);
+				return false;
+			}
+
+			node->object->visit(this);
+
+			const auto& layout = gen.get_class_layout(node->object_type);
+			val = gen.builder.CreateExtractValue(val, layout.field_indices[node->field_index]);
+			return false;
+		}
+
+		// `checked` is the division check range_analysis left
+		llvm::Value* create_binary(ir::ast::binary_operator op, ir::types::type_descriptor* type, llvm::Value* left, llvm::Value* right, bool checked)
+		{
+			// vectors work lane by lane, the same instructions apply
+			type = ir::types::scalar_type(type);
+
+			const auto is_float = ir::types::is_floating_point(type);
+			switch (op)
+			{
+				case ir::ast::binary_operator::add:
+				{
+					return is_float ? gen.builder.CreateFAdd(left, right) : gen.builder.CreateAdd(left, right);
+				}
+				case ir::ast::binary_operator::subtract:
+				{
+					return is_float ? gen.builder.CreateFSub(left, right) : gen.builder.CreateSub(left, right);
+				}
+				case ir::ast::binary_operator::multiply:
+				{
+					return is_float ? gen.builder.CreateFMul(left, right) : gen.builder.CreateMul(left, right);
+				}
+				case ir::ast::binary_operator::divide:
+				{
+					if (is_float)
+					{
+						return gen.builder.CreateFDiv(left, right);
+					}
+
+					// both are undefined in llvm, a vector fails when any lane does
+					if (checked)
+					{
+						auto any_lane = [&](llvm::Value* failed) { return failed->getType()->isVectorTy() ? gen.builder.CreateOrReduce(failed) : failed; };
+
+						create_check(any_lane(gen.builder.CreateICmpEQ(right, llvm::Constant::getNullValue(right->getType()))), "division by zero");
+						if (ir::types::is_signed_integer(type))
+						{
+							const auto width = left->getType()->getScalarSizeInBits();
+							auto smallest = llvm::ConstantInt::get(left->getType(), llvm::APInt::getSignedMinValue(width));
+							auto overflows = gen.builder.CreateAnd(gen.builder.CreateICmpEQ(left, smallest), gen.builder.CreateICmpEQ(right, llvm::Constant::getAllOnesValue(right->getType())));
+							create_check(any_lane(overflows), "integer overflow");
+						}
+					}
+
+					if (ir::types::is_signed_integer(type))
+					{
+						return gen.builder.CreateSDiv(left, right);
+					}
+					return gen.builder.CreateUDiv(left, right);
+				}
+				default:
+				{
+					break;
+				}
+			}
+
+			// bools are stored as i8
+			if (auto result = create_comparison(op, type, left, right))
+			{
+				return gen.builder.CreateZExt(result, llvm::Type::getInt8Ty(gen.llvm_mod->getContext()));
+			}
+			return nullptr;
+		}
+
+		// the i1 of a comparison, nullptr for any other operator
+		llvm::Value* create_comparison(ir::ast::binary_operator op, ir::types::type_descriptor* type, llvm::Value* left, llvm::Value* right)
+		{
+			type = ir::types::scalar_type(type);
+
+			const auto is_float = ir::types::is_floating_point(type);
+			const auto is_signed = ir::types::is_signed_integer(type);
+			llvm::Value* result = nullptr;
+			switch (op)
+			{
+				case ir::ast::binary_operator::equal:
+				{
+					result = is_float ? gen.builder.CreateFCmpOEQ(left, right) : gen.builder.CreateICmpEQ(left, right);
+					break;
+				}
+				case ir::ast::binary_operator::not_equal:
+				{
+					result = is_float ? gen.builder.CreateFCmpUNE(left, right) : gen.builder.CreateICmpNE(left, right);
+					break;
+				}
+				case ir::ast::binary_operator::less:
+				{
+					result = is_float ? gen.builder.CreateFCmpOLT(left, right) : is_signed ? gen.builder.CreateICmpSLT(left, right) : gen.builder.CreateICmpULT(left, right);
+					break;
+				}
+				case ir::ast::binary_operator::less_equal:
+				{
+					result = is_float ? gen.builder.CreateFCmpOLE(left, right) : is_signed ? gen.builder.CreateICmpSLE(left, right) : gen.builder.CreateICmpULE(left, right);
+					break;
+				}
+				case ir::ast::binary_operator::greater:
+				{
+					result = is_float ? gen.builder.CreateFCmpOGT(left, right) : is_signed ? gen.builder.CreateICmpSGT(left, right) : gen.builder.CreateICmpUGT(left, right);
+					break;
+				}
+				case ir::ast::binary_operator::greater_equal:
+				{
+					result = is_float ? gen.builder.CreateFCmpOGE(left, right) : is_signed ? gen.builder.CreateICmpSGE(left, right) : gen.builder.CreateICmpUGE(left, right);
+					break;
+				}
+				default:
+				{
+					return nullptr;
+				}
+			}
+			return result;
+		}
+
+		// data pointer and length of a string slice
+		std::pair<llvm::Value*, llvm::Value*> string_parts(llvm::Value* str)
+		{
+			return { gen.builder.CreateExtractValue(str, 0), gen.builder.CreateExtractValue(str, 1) };
+		}
+
+		// bool (i8) to the i1 a branch needs, looks through the extension of a comparison instead of comparing again.
+		// the extension itself might still be the value of a local, so it's left for llvm to clean up
+		llvm::Value* to_condition(llvm::Value* value)
+		{
+			if (auto zext = llvm::dyn_cast<llvm::ZExtInst>(value); zext && zext->getSrcTy()->isIntegerTy(1))
+			{
+				return zext->getOperand(0);
+			}
+
+			return gen.builder.CreateICmpNE(value, llvm::ConstantInt::get(value->getType(), 0));
+		}
+
+		// the i1 a branch on `node` needs. a comparison that only decides the branch is never widened to a bool
+		llvm::Value* create_condition(ir::ast::expression::expression* node)
+		{
+			auto binary = dynamic_cast<ir::ast::expression::binary*>(node);
+			if (binary && ir::ast::is_comparison(binary->op))
+			{
+				binary->left->visit(this);
+				auto left = val;
+				binary->right->visit(this);
+				return create_comparison(binary->op, binary->type.get(), left, val);
+			}
+
+			node->visit(this);
+			return to_condition(val);
+		}
+
+		bool visit(ir::ast::expression::binary* node) override
+		{
+			node->left->visit(this);
+			auto left = val;
+			node->right->visit(this);
+			auto right = val;
+
+			val = create_binary(node->op, node->type.get(), left, right, node->checked);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::unary* node) override
+		{
+			node->operand->visit(this);
+
+			switch (node->op)
+			{
+				case ir::ast::unary_operator::negate:
+				{
+					val = ir::types::is_floating_point(ir::types::scalar_type(node->type.get())) ? gen.builder.CreateFNeg(val) : gen.builder.CreateNeg(val);
+					break;
+				}
+			}
+			return false;
+		}
+
+		bool visit(ir::ast::expression::variable* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::expression::unresolved_variable* node) override
+		{
+			throw exception(node->range.start, "unresolved variable encountered during code generation");
+			return true;
+		}
+
+		bool visit(ir::ast::expression::local_variable* node) override
+		{
+			if (auto slot = array_slots.find(node->def); slot != array_slots.end())
+			{
+				val = load(slot->second);
+				return false;
+			}
+
+			val = gen.ssa.read_variable(node->def, gen.builder.GetInsertBlock());
+			return false;
+		}
+
+		bool visit(ir::ast::expression::function_variable* node) override
+		{
+			val = gen.get_or_declare_function(node->symbol, node->def_stat);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::builtin_function* node) override
+		{
+			throw exception(node->range.start, "builtin '" + node->name + "' can only be called");
+		}
+
+		bool visit(ir::ast::statement::expression_statement* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::variable_declaration* node) override
+		{
+			if (is_array(&node->variable))
+			{
+				auto value = evaluate_stored(node->value.get());
+				auto type = std::get<ir::types::type_reference>(node->variable.type_).type.get();
+				auto slot = slot_place(create_slot(type), type);
+				array_slots[&node->variable] = slot;
+				store(slot, value);
+				return false;
+			}
+
+			node->value->visit(this);
+			gen.ssa.write_variable(&node->variable, gen.builder.GetInsertBlock(), val);
+			return false;
+		}
+
+		// nullptr for elements and local arrays, which are stored to memory
+		ir::ast::expression::local_variable* get_target(ir::ast::expression::expression* target)
+		{
+			auto target_var = dynamic_cast<ir::ast::expression::variable*>(target);
+			auto local = target_var ? dynamic_cast<ir::ast::expression::local_variable*>(target_var->var.get()) : nullptr;
+			return local && !array_slots.count(local->def) ? local : nullptr;
+		}
+
+		bool visit(ir::ast::statement::variable_assignment* node) override
+		{
+			auto target = get_target(node->target.get());
+			if (!target)
+			{
+				// the value goes first, like range_analysis saw it
+				auto value = evaluate_stored(node->value.get());
+				store(*get_place(node->target.get()), value);
+				return false;
+			}
+
+			node->value->visit(this);
+			gen.ssa.write_variable(target->def, gen.builder.GetInsertBlock(), val);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::compound_assignment* node) override
+		{
+			auto target = get_target(node->target.get());
+			if (!target)
+			{
+				auto element = *get_place(node->target.get());
+				auto current = load(element);
+				node->value->visit(this);
+				store(element, create_binary(node->op, element.desc, current, val, node->checked));
+				return false;
+			}
+
+			auto current = gen.ssa.read_variable(target->def, gen.builder.GetInsertBlock());
+			node->value->visit(this);
+
+			auto type = std::get<ir::types::type_reference>(target->def->type_).type.get();
+			val = create_binary(node->op, type, current, val, node->checked);
+			gen.ssa.write_variable(target->def, gen.builder.GetInsertBlock(), val);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::type_definition* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::extern_definition* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::function_definition* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::alias_type_definition* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::class_type_definition* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::block* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::restricted_block* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::ret* node) override
+		{
+			if (node->value)
+			{
+				node->value->visit(this);
+				gen.builder.CreateRet(val);
+			}
+			else
+			{
+				gen.builder.CreateRetVoid();
+			}
+
+			return false;
+		}
+	};
+}
+
+// string (immutable)
+// { data, 3 } -> "abc"
+// a slice passed around in two registers, the length is known without touching memory
+// and a substring is just another pointer and length into the same bytes
+llvm::Type* code_gen::code_gen::get_string_type()
+{
+	auto& context = llvm_mod->getContext();
+	std::array<llvm::Type*, 2> struct_fields{ llvm::Type::getInt8PtrTy(context), llvm::Type::getIntNTy(context, data_layout->getMaxPointerSizeInBits()) };
+	return llvm::StructType::get(context, llvm::makeArrayRef(struct_fields));
+}
+
+llvm::Type* code_gen::code_gen::get_llvm_type(ir::types::type_descriptor* type_desc)
+{
+	auto it = type_map.find(type_desc);
+	if (it != type_map.cend())
+	{
+		return it->second;
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<void>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getVoidTy(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::string>*>(type_desc))
+	{
+		return get_string_type();
+	}
+
+	if (auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(type_desc))
+	{
+		return get_class_layout(class_type).type;
+	}
+
+	if (auto vector_type = dynamic_cast<ir::types::vector_type_descriptor*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::FixedVectorType::get(get_llvm_type(vector_type->element.get()), vector_type->lanes);
+	}
+
+	// literal_typer makes array and slice types of its own, they aren't kept in type_map. llvm hands out the same type every time anyway
+	if (auto array_type = ir::types::as_array(type_desc))
+	{
+		auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(array_type->element.get()));
+		if (class_type && class_type->soa)
+		{
+			return get_soa_type(class_type, array_type->length);
+		}
+		return llvm::ArrayType::get(get_llvm_type(array_type->element.get()), array_type->length);
+	}
+
+	// { T*, len }, the same as a string for u8[]
+	if (auto slice_type = ir::types::as_slice(type_desc))
+	{
+		auto& context = llvm_mod->getContext();
+		std::array<llvm::Type*, 2> struct_fields{ get_llvm_type(slice_type->element.get())->getPointerTo(), llvm::Type::getIntNTy(context, data_layout->getMaxPointerSizeInBits()) };
+		return llvm::StructType::get(context, llvm::makeArrayRef(struct_fields));
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<bool>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt8Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int8_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt8Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int16_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt16Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int32_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt32Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int64_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt64Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint8_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt8Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint16_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt16Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint32_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt32Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint64_t>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getInt64Ty(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<float>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getFloatTy(llvm_mod->getContext());
+	}
+
+	if (dynamic_cast<ir::types::built_in_type_descriptor<double>*>(type_desc))
+	{
+		return type_map[type_desc] = llvm::Type::getDoubleTy(llvm_mod->getContext());
+	}
+	
+	throw std::runtime_error("not implemented");
+
+	return nullptr;
+}
+
+llvm::Type* code_gen::code_gen::get_llvm_type(ir::types::type_reference& type_ref)
+{
+	if (type_ref.is_optional)
+	{
+		return get_optional_layout(type_ref.type.get()).type;
+	}
+
+	return get_llvm_type(type_ref.type.get());
+}
+
+const code_gen::class_layout& code_gen::code_gen::get_class_layout(ir::types::class_type_descriptor* class_type)
+{
+	if (auto it = class_layouts.find(class_type); it != class_layouts.cend())
+	{
+		return it->second;
+	}
+
+	constexpr std::uint64_t cache_line_size = 64;
+
+	auto& context = llvm_mod->getContext();
+
+	const auto& class_attributes = class_type->layout;
+	auto explicit_layout = class_attributes.any();
+
+	std::vector<llvm::Type*> field_types;
+	std::vector<llvm::Align> field_alignments;
+	field_types.reserve(class_type->fields.size());
+	field_alignments.reserve(class_type->fields.size());
+	for (auto& field : class_type->fields)
+	{
+		field_types.push_back(get_llvm_type(field.type));
+
+		// a field of a class with layout attributes has a stricter alignment than its llvm type
+		auto alignment = get_alignment(field.type);
+		explicit_layout |= field.layout.any() || alignment != data_layout->getABITypeAlign(field_types.back());
+
+		if (field.layout.packed || (class_attributes.packed && field.layout.align == 0))
+		{
+			alignment = llvm::Align{ 1 };
+		}
+		else if (field.layout.align != 0)
+		{
+			alignment = std::max(alignment, llvm::Align{ field.layout.align });
+		}
+		field_alignments.push_back(alignment);
+	}
+
+	// sorted by decreasing alignment every field starts right where the previous one ended,
+	// only the tail is padded. @repr(C) keeps the declaration order for code outside of seam
+	std::vector<std::size_t> order(field_types.size());
+	std::iota(order.begin(), order.end(), 0);
+	if (!class_type->repr_c && !class_attributes.packed)
+	{
+		std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+		{
+			return field_alignments[a] > field_alignments[b];
+		});
+	}
+
+	class_layout layout;
+	layout.field_indices.resize(field_types.size());
+
+	std::vector<llvm::Type*> elements;
+	elements.reserve(field_types.size());
+
+	if (!explicit_layout)
+	{
+		for (auto field : order)
+		{
+			layout.field_indices[field] = static_cast<unsigned>(elements.size());
+			elements.push_back(field_types[field]);
+		}
+
+		layout.type = llvm::StructType::create(context, elements, class_type->name);
+		layout.alignment = data_layout->getABITypeAlign(layout.type);
+	}
+	else
+	{
+		// llvm only knows natural alignment, so the offsets are worked out here and the padding is spelled out
+		// in a packed struct. the tail padding is part of the struct as well, its size is the array stride
+		std::uint64_t offset = 0;
+		auto pad_to = [&](std::uint64_t target)
+		{
+			if (target > offset)
+			{
+				elements.push_back(llvm::ArrayType::get(llvm::Type::getInt8Ty(context), target - offset));
+				offset = target;
+			}
+		};
+
+		auto class_alignment = llvm::Align{ std::max<std::uint64_t>(class_attributes.align, 1) };
+		for (auto field : order)
+		{
+			pad_to(llvm::alignTo(offset, field_alignments[field]));
+
+			layout.field_indices[field] = static_cast<unsigned>(elements.size());
+			elements.push_back(field_types[field]);
+			offset += data_layout->getTypeAllocSize(field_types[field]);
+
+			// whatever comes next starts on a fresh cache line, so it can't be falsely shared with this field
+			if (class_type->fields[field].layout.cacheline)
+			{
+				pad_to(llvm::alignTo(offset, cache_line_size));
+			}
+			class_alignment = std::max(class_alignment, field_alignments[field]);
+		}
+		pad_to(llvm::alignTo(offset, class_alignment));
+
+		layout.type = llvm::StructType::create(context, elements, class_type->name, true);
+		layout.alignment = class_alignment;
+
+		llvm::SmallBitVector padding(elements.size(), true);
+		for (auto index : layout.field_indices)
+		{
+			padding.reset(index);
+		}
+		c_abi->add_explicit_layout(layout.type, layout.alignment, std::move(padding));
+	}
+
+	type_map[class_type] = layout.type;
+
+	return class_layouts.emplace(class_type, std::move(layout)).first->second;
+}
+
+llvm::StructType* code_gen::code_gen::get_soa_type(ir::types::class_type_descriptor* class_type, std::uint64_t length)
+{
+	// a loop over one field only streams through that field's array, and consecutive elements of it vectorize.
+	// the arrays are in declaration order, not in the order of get_class_layout, an access uses the field's index in the class
+	std::vector<llvm::Type*> arrays;
+	arrays.reserve(class_type->fields.size());
+	for (auto& field : class_type->fields)
+	{
+		arrays.push_back(llvm::ArrayType::get(get_llvm_type(field.type), length));
+	}
+
+	return llvm::StructType::get(llvm_mod->getContext(), arrays);
+}
+
+llvm::Align code_gen::code_gen::get_alignment(ir::types::type_reference& type_ref)
+{
+	// a tagged optional adds a byte after the value, it never needs more alignment than the value
+	if (type_ref.is_optional && !dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(type_ref.type.get())))
+	{
+		return data_layout->getABITypeAlign(get_llvm_type(type_ref));
+	}
+	return get_alignment(type_ref.type.get());
+}
+
+llvm::Align code_gen::code_gen::get_alignment(ir::types::type_descriptor* type_desc)
+{
+	type_desc = ir::types::unwrap_alias(type_desc);
+	if (auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(type_desc))
+	{
+		return get_class_layout(class_type).alignment;
+	}
+
+	// an array is aligned like its elements, one of a @soa class like its most aligned field
+	if (auto array_type = ir::types::as_array(type_desc))
+	{
+		auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(array_type->element.get()));
+		if (!class_type || !class_type->soa)
+		{
+			return get_alignment(array_type->element.get());
+		}
+
+		llvm::Align alignment;
+		for (auto& field : class_type->fields)
+		{
+			alignment = std::max(alignment, get_alignment(field.type));
+		}
+		return alignment;
+	}
+	return data_layout->getABITypeAlign(get_llvm_type(type_desc));
+}
+
+void code_gen::code_gen::print_range_remarks(llvm::raw_ostream& os)
+{
+	for (const auto& remark : range_remarks)
+	{
+		os << mod.relative_path << ':' << remark.pos.line << ':' << remark.pos.col << ": remark: " << remark.message << '\n';
+	}
+}
+
+void code_gen::code_gen::print_layouts(llvm::raw_ostream& os)
+{
+	class class_finder : public ir::ast::visitor
+	{
+	public:
+		std::vector<ir::types::class_type_descriptor*> classes;
+
+		bool visit(ir::ast::node* node) override
+		{
+			return false;
+		}
+
+		bool visit(ir::ast::statement::restricted_block* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::class_type_definition* node) override
+		{
+			classes.push_back(node->descriptor.get());
+			return true;
+		}
+	};
+
+	class_finder finder;
+	mod.body->visit(&finder);
+
+	for (auto class_type : finder.classes)
+	{
+		// an array of a @soa class is laid out like get_soa_type, one array per field in declaration order.
+		// the offset of each array depends on the length, so only the size per element is known here
+		if (class_type->soa)
+		{
+			std::uint64_t element_size = 0;
+			llvm::Align alignment;
+			for (auto& field : class_type->fields)
+			{
+				element_size += data_layout->getTypeAllocSize(get_llvm_type(field.type)).getFixedSize();
+				alignment = std::max(alignment, get_alignment(field.type));
+			}
+
+			os << "class " << class_type->name << " @soa: one array per field, " << element_size << " bytes per element, align " << alignment.value() << '\n';
+			for (auto& field : class_type->fields)
+			{
+				const auto size = data_layout->getTypeAllocSize(get_llvm_type(field.type)).getFixedSize();
+				os << '\t' << field.name << ": " << field.type.type->name << (field.type.is_optional ? "?" : "") << "[], " << size << " bytes per element\n";
+			}
+			continue;
+		}
+
+		const auto& layout = get_class_layout(class_type);
+		const auto struct_layout = data_layout->getStructLayout(layout.type);
+
+		os << "class " << class_type->name << ": " << struct_layout->getSizeInBytes() << " bytes, align " << layout.alignment.value() << '\n';
+
+		std::vector<const ir::types::field_descriptor*> element_fields(layout.type->getNumElements(), nullptr);
+		for (std::size_t i = 0; i < class_type->fields.size(); ++i)
+		{
+			element_fields[layout.field_indices[i]] = &class_type->fields[i];
+		}
+
+		std::uint64_t end = 0;
+		auto print_padding = [&](std::uint64_t offset)
+		{
+			if (offset > end)
+			{
+				os << '\t' << end << "\tpadding, " << offset - end << " bytes\n";
+			}
+		};
+
+		for (unsigned i = 0; i < layout.type->getNumElements(); ++i)
+		{
+			auto field = element_fields[i];
+			if (!field)
+			{
+				continue; // spelled out padding
+			}
+
+			const auto offset = struct_layout->getElementOffset(i);
+			print_padding(offset);
+
+			const auto size = data_layout->getTypeAllocSize(layout.type->getElementType(i)).getFixedSize();
+			os << '\t' << offset << '\t' << field->name << ": " << field->type.type->name << (field->type.is_optional ? "?" : "") << ", " << size << " bytes\n";
+			end = offset + size;
+		}
+		print_padding(struct_layout->getSizeInBytes());
+	}
+}
+
+code_gen::optional_layout code_gen::code_gen::get_optional_layout(ir::types::type_descriptor* type_desc)
+{
+	auto& context = llvm_mod->getContext();
+	auto base_type = get_llvm_type(type_desc);
+
+	// references are never null
+	if (base_type->isPointerTy())
+	{
+		return { optional_layout::kind::niche, base_type, llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(base_type)) };
+	}
+
+	// neither is the data of a string, not even an empty one. c may use null for that, normalize_from_c takes care of it
+	if (ir::types::is_built_in<std::string>(type_desc))
+	{
+		return { optional_layout::kind::niche, base_type, llvm::Constant::getNullValue(base_type) };
+	}
+
+	// a bool only ever is 0 or 1
+	if (ir::types::is_built_in<bool>(type_desc))
+	{
+		return { optional_layout::kind::niche, base_type, llvm::ConstantInt::get(base_type, 2) };
+	}
+
+	// the tag goes last, so the value keeps offset 0 and needs no padding in front of it
+	std::array<llvm::Type*, 2> struct_fields{ base_type, llvm::Type::getInt8Ty(context) };
+	auto struct_type = llvm::StructType::get(context, llvm::makeArrayRef(struct_fields));
+	return { optional_layout::kind::tagged, struct_type, llvm::Constant::getNullValue(struct_type) };
+}
+
+std::vector<llvm::SmallVector<unsigned, 2>> code_gen::code_gen::get_scalar_paths(llvm::Type* type)
+{
+	std::vector<llvm::SmallVector<unsigned, 2>> paths;
+	if (!llvm::isa<llvm::StructType>(type))
+	{
+		return paths;
+	}
+
+	// arrays are either the padding of a class with an explicit layout, which is meant for memory, or too big
+	llvm::SmallVector<unsigned, 2> path;
+	bool scalarizable = true;
+	auto collect = [&](auto& self, llvm::Type* element) -> void
+	{
+		if (auto struct_type = llvm::dyn_cast<llvm::StructType>(element))
+		{
+			for (unsigned i = 0; i < struct_type->getNumElements(); ++i)
+			{
+				path.push_back(i);
+				self(self, struct_type->getElementType(i));
+				path.pop_back();
+			}
+		}
+		else if (element->isArrayTy())
+		{
+			scalarizable = false;
+		}
+		else
+		{
+			paths.push_back(path);
+		}
+	};
+	collect(collect, type);
+
+	if (!scalarizable || paths.size() > max_scalars)
+	{
+		paths.clear();
+	}
+	return paths;
+}
+
+bool code_gen::code_gen::passes_by_pointer(ir::types::type_reference& type_ref)
+{
+	if (type_ref.is_optional || !ir::types::as_array(type_ref.type.get()))
+	{
+		return false;
+	}
+
+	std::uint64_t scalars = 0;
+	auto count = [&](auto& self, llvm::Type* type, std::uint64_t copies) -> void
+	{
+		if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type))
+		{
+			self(self, array_type->getElementType(), copies * array_type->getNumElements());
+		}
+		else if (auto struct_type = llvm::dyn_cast<llvm::StructType>(type))
+		{
+			for (auto element : struct_type->elements())
+			{
+				self(self, element, copies);
+			}
+		}
+		else
+		{
+			scalars += copies;
+		}
+	};
+	count(count, get_llvm_type(type_ref), 1);
+	return scalars > max_scalars;
+}
+
+void code_gen::code_gen::push_argument(std::vector<llvm::Value*>& arguments, llvm::Function* callee, llvm::Value* value)
+{
+	// an array taken by pointer that only exists as a value, like in a c wrapper, gets a slot of its own
+	auto param_type = arguments.size() < callee->arg_size() ? callee->getFunctionType()->getParamType(static_cast<unsigned>(arguments.size())) : nullptr;
+	if (callee->getCallingConv() == llvm::CallingConv::Fast && param_type == value->getType()->getPointerTo())
+	{
+		auto& entry = builder.GetInsertBlock()->getParent()->getEntryBlock();
+		llvm::IRBuilder<> entry_builder{ &entry, entry.begin() };
+
+		auto alignment = callee->getParamAlign(static_cast<unsigned>(arguments.size())).valueOrOne();
+		auto slot = entry_builder.CreateAlloca(value->getType());
+		slot->setAlignment(alignment);
+		builder.CreateAlignedStore(value, slot, alignment);
+		arguments.push_back(slot);
+		return;
+	}
+
+	std::vector<llvm::SmallVector<unsigned, 2>> paths;
+	if (callee->getCallingConv() == llvm::CallingConv::Fast)
+	{
+		paths = get_scalar_paths(value->getType());
+	}
+
+	if (paths.empty())
+	{
+		arguments.push_back(value);
+	}
+
+	for (const auto& path : paths)
+	{
+		arguments.push_back(builder.CreateExtractValue(value, path));
+	}
+}
+
+const code_gen::abi_lowering::signature& code_gen::code_gen::get_c_signature(ir::ast::statement::function_declaration* func_def)
+{
+	auto it = c_signatures.find(func_def);
+	if (it != c_signatures.cend())
+	{
+		return it->second;
+	}
+
+	auto is_signed = [](ir::types::type_reference& type_ref) { return !type_ref.is_optional && ir::types::is_signed_integer(type_ref.type.get()); };
+
+	auto plain_type = get_llvm_function_type(func_def, false);
+	std::vector<std::pair<llvm::Type*, bool>> params;
+	params.reserve(func_def->arguments.size());
+	for (std::size_t i = 0; i < func_def->arguments.size(); ++i)
+	{
+		params.emplace_back(plain_type->getParamType(static_cast<unsigned>(i)), is_signed(std::get<ir::types::type_reference>(func_def->arguments[i].type_)));
+	}
+
+	auto sig = c_abi->classify(plain_type->getReturnType(), is_signed(std::get<ir::types::type_reference>(func_def->return_type)), params);
+	return c_signatures.emplace(func_def, std::move(sig)).first->second;
+}
+
+void code_gen::code_gen::emit_c_wrapper(llvm::Function* implementation, ir::ast::statement::function_declaration* func_def, const std::string& name)
+{
+	const auto& sig = get_c_signature(func_def);
+
+	auto wrapper = llvm::Function::Create(sig.type, llvm::GlobalValue::ExternalLinkage, name, *llvm_mod);
+	c_abi->add_attributes(wrapper, sig);
+	if (implementation->doesNotThrow())
+	{
+		wrapper->addFnAttr(llvm::Attribute::NoUnwind);
+	}
+
+	builder.SetInsertPoint(llvm::BasicBlock::Create(llvm_mod->getContext(), "entry", wrapper));
+
+	std::vector<llvm::Value*> arguments;
+	const auto values = c_abi->raise_arguments(builder, sig, wrapper);
+	for (std::size_t i = 0; i < values.size(); ++i)
+	{
+		push_argument(arguments, implementation, normalize_from_c(values[i], std::get<ir::types::type_reference>(func_def->arguments[i].type_)));
+	}
+
+	auto call = builder.CreateCall(implementation, arguments);
+	call->setCallingConv(implementation->getCallingConv());
+	c_abi->create_return(builder, sig, wrapper, call);
+}
+
+llvm::Value* code_gen::code_gen::normalize_from_c(llvm::Value* value, ir::types::type_reference& type_ref)
+{
+	// none of a string? is the null pointer, which stays what it is
+	if (type_ref.is_optional)
+	{
+		return value;
+	}
+
+	auto contains_data = [](auto& self, ir::types::type_descriptor* type) -> bool
+	{
+		if (ir::types::is_built_in<std::string>(type) || ir::types::as_slice(type))
+		{
+			return true;
+		}
+
+		auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(type));
+		return class_type && std::any_of(class_type->fields.begin(), class_type->fields.end(),
+			[&](ir::types::field_descriptor& field) { return !field.type.is_optional && self(self, field.type.type.get()); });
+	};
+
+	auto type = type_ref.type.get();
+	if (!contains_data(contains_data, type))
+	{
+		return value;
+	}
+
+	if (auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(type)))
+	{
+		const auto& layout = get_class_layout(class_type);
+		for (std::size_t i = 0; i < class_type->fields.size(); ++i)
+		{
+			auto& field_type = class_type->fields[i].type;
+			if (!field_type.is_optional && contains_data(contains_data, field_type.type.get()))
+			{
+				auto field = builder.CreateExtractValue(value, layout.field_indices[i]);
+				value = builder.CreateInsertValue(value, normalize_from_c(field, field_type), layout.field_indices[i]);
+			}
+		}
+		return value;
+	}
+
+	// a slice never reads through the data pointer of an empty one, any that isn't null does
+	auto data = builder.CreateExtractValue(value, 0);
+	auto data_type = llvm::cast<llvm::PointerType>(data->getType());
+	auto empty = llvm::ConstantExpr::getPointerCast(get_string_literal("")->getAggregateElement(0u), data_type);
+	auto non_null = builder.CreateSelect(builder.CreateICmpEQ(data, llvm::ConstantPointerNull::get(data_type)), empty, data);
+	return builder.CreateInsertValue(value, non_null, 0);
+}
+
+llvm::FunctionType* code_gen::code_gen::get_llvm_function_type(ir::ast::statement::function_declaration* func_def, bool internal_abi)
+{
+	auto ret_type = get_llvm_type(std::get<ir::types::type_reference>(func_def->return_type));
+	if (!llvm::FunctionType::isValidReturnType(ret_type))
+	{
+		throw exception(func_def->range.start, "invalid return type");
+	}
+
+	std::vector<llvm::Type*> parameter_types;
+	parameter_types.reserve(func_def->arguments.size());
+	for (auto& param : func_def->arguments)
+	{
+		auto param_type = get_llvm_type(std::get<ir::types::type_reference>(param.type_));
+		if (!llvm::FunctionType::isValidArgumentType(param_type))
+		{
+			throw exception(func_def->range.start, "invalid argument type");
+		}
+
+		// aggregates are returned in registers anyway, but as arguments they'd follow the c rules.
+		// a big array as a first-class value would be copied element by element
+		if (internal_abi && passes_by_pointer(std::get<ir::types::type_reference>(param.type_)))
+		{
+			parameter_types.push_back(param_type->getPointerTo());
+			continue;
+		}
+
+		std::vector<llvm::SmallVector<unsigned, 2>> paths;
+		if (internal_abi)
+		{
+			paths = get_scalar_paths(param_type);
+		}
+		if (paths.empty())
+		{
+			parameter_types.push_back(param_type);
+		}
+
+		for (const auto& path : paths)
+		{
+			parameter_types.push_back(llvm::ExtractValueInst::getIndexedType(param_type, path));
+		}
+	}
+
+	return llvm::FunctionType::get(ret_type, llvm::makeArrayRef(parameter_types), false);
+}
+
+void code_gen::code_gen::add_inferred_attributes(llvm::Function* function, ir::ast::statement::function_declaration* func_def)
+{
+	auto it = function_effects.find(func_def);
+	if (it == function_effects.cend())
+	{
+		return;
+	}
+	const auto& effects = it->second;
+
+	if (!effects.unwinds)
+	{
+		function->addFnAttr(llvm::Attribute::NoUnwind);
+	}
+
+	// arrays passed by pointer are read from the caller's memory and a changed one is written there
+	bool reads_arrays = false;
+	bool writes_arrays = false;
+	for (std::size_t i = 0; i < func_def->arguments.size(); ++i)
+	{
+		if (function->getCallingConv() == llvm::CallingConv::Fast && passes_by_pointer(std::get<ir::types::type_reference>(func_def->arguments[i].type_)))
+		{
+			reads_arrays = true;
+			writes_arrays |= i < effects.modified.size() && effects.modified[i];
+		}
+	}
+
+	// a result returned through memory is written by the function, even when its own code doesn't
+	if (!effects.writes_memory && !writes_arrays && !function->hasStructRetAttr())
+	{
+		function->addFnAttr(effects.reads_memory || reads_arrays ? llvm::Attribute::ReadOnly : llvm::Attribute::ReadNone);
+	}
+
+	if (!effects.reads_memory && !effects.writes_memory && reads_arrays)
+	{
+		function->addFnAttr(llvm::Attribute::ArgMemOnly);
+	}
+
+	if (!effects.may_not_return)
+	{
+		function->addFnAttr(llvm::Attribute::WillReturn);
+	}
+}
+
+void code_gen::code_gen::add_pointer_attributes(llvm::Function* function, ir::ast::statement::function_declaration* func_def)
+{
+	auto it = function_effects.find(func_def);
+	const auto captured = it != function_effects.cend() ? &it->second.captured : nullptr;
+	const auto modified = it != function_effects.cend() ? &it->second.modified : nullptr;
+
+	unsigned index = 0;
+	for (std::size_t i = 0; i < func_def->arguments.size(); ++i)
+	{
+		auto& type_ref = std::get<ir::types::type_reference>(func_def->arguments[i].type_);
+		if (passes_by_pointer(type_ref) && function->getArg(index)->getType()->isPointerTy())
+		{
+			// the caller's copy or an array nothing writes while the call runs, which stays where it is
+			auto& context = llvm_mod->getContext();
+			const auto size = data_layout->getTypeAllocSize(get_llvm_type(type_ref)).getFixedSize();
+			function->addParamAttr(index, llvm::Attribute::NoAlias);
+			function->addParamAttr(index, llvm::Attribute::NonNull);
+			function->addParamAttr(index, llvm::Attribute::getWithAlignment(context, get_alignment(type_ref)));
+			function->addParamAttr(index, llvm::Attribute::getWithDereferenceableBytes(context, size));
+
+			// a slice of it could be kept
+			if (modified && i < modified->size() && !(*modified)[i])
+			{
+				function->addParamAttr(index, llvm::Attribute::ReadOnly);
+				function->addParamAttr(index, llvm::Attribute::NoCapture);
+			}
+			++index;
+			continue;
+		}
+
+		const auto paths = get_scalar_paths(get_llvm_type(type_ref));
+		const auto is_string = ir::types::is_built_in<std::string>(type_ref.type.get());
+		if (!paths.empty() && (is_string || ir::types::as_slice(type_ref.type.get())) && function->getArg(index)->getType()->isPointerTy())
+		{
+			// the bytes of a string never change, so nothing writes them behind its back.
+			// a slice can be written through and two of them can overlap, it gets neither
+			if (is_string)
+			{
+				function->addParamAttr(index, llvm::Attribute::ReadOnly);
+				function->addParamAttr(index, llvm::Attribute::NoAlias);
+			}
+
+			// none is the null pointer, an empty one from c was given other data at the boundary
+			if (!type_ref.is_optional)
+			{
+				function->addParamAttr(index, llvm::Attribute::NonNull);
+			}
+
+			if (captured && i < captured->size() && !(*captured)[i])
+			{
+				function->addParamAttr(index, llvm::Attribute::NoCapture);
+			}
+		}
+		index += paths.empty() ? 1 : static_cast<unsigned>(paths.size());
+	}
+}
+
+void code_gen::code_gen::add_function_attributes(llvm::Function* function, ir::ast::statement::function_declaration* func_def)
+{
+	auto has_attribute = [&](const char* name) { return func_def->attributes.find(name) != func_def->attributes.cend(); };
+
+	if (has_attribute("inline"))
+	{
+		function->addFnAttr(llvm::Attribute::AlwaysInline);
+	}
+
+	if (has_attribute("noinline"))
+	{
+		function->addFnAttr(llvm::Attribute::NoInline);
+	}
+
+	if (has_attribute("noreturn"))
+	{
+		function->addFnAttr(llvm::Attribute::NoReturn);
+	}
+
+	// seam code only writes to memory of its own or through a slice, the attribute checker made sure a @pure function
+	// doesn't do the latter, only calls other @pure ones and doesn't throw. it can still be inferred to not even read
+	if (has_attribute("pure") && !function->doesNotAccessMemory() && !function->hasStructRetAttr())
+	{
+		function->addFnAttr(llvm::Attribute::ReadOnly);
+	}
+
+	// hot code is kept together in .text.hot and cold code out of the way in .text.unlikely, which also keeps it small
+	if (has_attribute("hot"))
+	{
+		function->addFnAttr(llvm::Attribute::Hot);
+		function->setSectionPrefix("hot");
+	}
+	else if (has_attribute("cold"))
+	{
+		function->addFnAttr(llvm::Attribute::Cold);
+		function->addFnAttr(llvm::Attribute::OptimizeForSize);
+		function->setSectionPrefix("unlikely");
+	}
+
+	// the instructions of the body carry the flags, these tell the backend what the function as a whole allows
+	const auto fast_math_flags = get_fast_math_flags(func_def);
+	if (fast_math_flags.isFast())
+	{
+		function->addFnAttr("unsafe-fp-math", "true");
+	}
+
+	if (fast_math_flags.noNaNs())
+	{
+		function->addFnAttr("no-nans-fp-math", "true");
+	}
+
+	if (fast_math_flags.noInfs())
+	{
+		function->addFnAttr("no-infs-fp-math", "true");
+	}
+
+	if (fast_math_flags.noSignedZeros())
+	{
+		function->addFnAttr("no-signed-zeros-fp-math", "true");
+	}
+
+	if (fast_math_flags.approxFunc())
+	{
+		function->addFnAttr("approx-func-fp-math", "true");
+	}
+}
+
+llvm::FastMathFlags code_gen::code_gen::get_fast_math_flags(ir::ast::statement::function_declaration* func_def)
+{
+	llvm::FastMathFlags flags;
+	if (!dynamic_cast<ir::ast::statement::function_definition*>(func_def))
+	{
+		return flags;
+	}
+
+	if (fast_math || func_def->attributes.find("fast_math") != func_def->attributes.cend())
+	{
+		flags.setFast();
+		return flags;
+	}
+
+	// the attribute checker only lets known options through
+	if (auto fp = func_def->attributes.find("fp"); fp != func_def->attributes.cend())
+	{
+		for (const auto& option : fp->second)
+		{
+			if (option == "reassoc") flags.setAllowReassoc();
+			else if (option == "contract") flags.setAllowContract();
+			else if (option == "nnan") flags.setNoNaNs();
+			else if (option == "ninf") flags.setNoInfs();
+			else if (option == "nsz") flags.setNoSignedZeros();
+			else if (option == "arcp") flags.setAllowReciprocal();
+			else if (option == "afn") flags.setApproxFunc();
+		}
+	}
+	return flags;
+}
+
+void code_gen::code_gen::flatten(llvm::Function* function, const std::vector<std::pair<llvm::Function*, ir::ast::statement::function_declaration*>>& multiversioned)
+{
+	// inlined callees along with the one they were inlined through, -1 for the function itself
+	std::vector<std::pair<llvm::Function*, int>> history;
+	auto is_recursive = [&](llvm::Function* callee, int index)
+	{
+		for (; index != -1; index = history[index].second)
+		{
+			if (history[index].first == callee)
+			{
+				return true;
+			}
+		}
+		return callee == function;
+	};
+
+	std::vector<std::pair<llvm::CallBase*, int>> calls;
+	for (auto& instr : llvm::instructions(function))
+	{
+		if (auto call = llvm::dyn_cast<llvm::CallBase>(&instr))
+		{
+			calls.emplace_back(call, -1);
+		}
+	}
+
+	// the calls that come with an inlined body are inlined as well, recursion stays a call.
+	// a multiversioned callee would lose its dispatch and a @noinline one asked not to be
+	while (!calls.empty())
+	{
+		auto [call, history_index] = calls.back();
+		calls.pop_back();
+
+		auto callee = call->getCalledFunction();
+		if (!callee || callee->isDeclaration() || callee->hasFnAttribute(llvm::Attribute::NoInline) || is_recursive(callee, history_index)
+			|| llvm::any_of(multiversioned, [&](const auto& entry) { return entry.first == callee; }))
+		{
+			continue;
+		}
+
+		llvm::InlineFunctionInfo info;
+		if (!llvm::InlineFunction(*call, info).isSuccess())
+		{
+			continue;
+		}
+
+		history.emplace_back(callee, history_index);
+		for (auto inlined_call : info.InlinedCallSites)
+		{
+			calls.emplace_back(inlined_call, static_cast<int>(history.size() - 1));
+		}
+	}
+}
+
+llvm::Function* code_gen::code_gen::get_or_declare_function(const std::string& symbol, ir::ast::statement::function_declaration* def_stat)
+{
+	std::string name;
+	llvm::GlobalValue::LinkageTypes linkage;
+
+	// TODO: maybe add destructors?
+	// TODO: only one constructor per module? done i think
+	bool is_constructor = def_stat->attributes.find("constructor") != def_stat->attributes.cend();
+	bool is_extern = dynamic_cast<ir::ast::statement::extern_definition*>(def_stat) != nullptr;
+
+	// TODO: test extern with @export or @constructor :KEKW:
+	// TODO: add type name to function name
+	if ((is_constructor && mod.is_root)
+		|| def_stat->attributes.find("export") != def_stat->attributes.cend())
+	{
+		if (is_extern)
+		{
+			throw exception(def_stat->range.start, "exporting extern function is not allowed");
+		}
+
+		linkage = llvm::GlobalValue::ExternalLinkage;
+		name = mod.relative_path + '@' + symbol;
+	}
+	else
+	{
+		linkage = is_extern ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::InternalLinkage;
+		name = symbol;
+	}
+
+	// an export that doesn't take and return everything as it is has its body in an internal function,
+	// called by a wrapper with the c signature once all bodies are done
+	std::string export_name;
+	if (linkage == llvm::GlobalValue::ExternalLinkage && !is_extern && !get_c_signature(def_stat).is_trivial())
+	{
+		export_name = std::move(name);
+		name = symbol;
+		linkage = llvm::GlobalValue::InternalLinkage;
+	}
+
+	auto function = llvm_mod->getFunction(name);
+	if (!function)
+	{
+		// nothing outside of the module calls an internal function, so it doesn't need to follow the c abi
+		if (linkage == llvm::GlobalValue::InternalLinkage)
+		{
+			function = llvm::Function::Create(get_llvm_function_type(def_stat, true), linkage, name, *llvm_mod);
+			function->setCallingConv(llvm::CallingConv::Fast);
+			add_pointer_attributes(function, def_stat);
+		}
+		else
+		{
+			const auto& sig = get_c_signature(def_stat);
+			function = llvm::Function::Create(sig.type, linkage, name, *llvm_mod);
+			c_abi->add_attributes(function, sig);
 		}
+		add_inferred_attributes(function, def_stat);
 
-		bool visit(ir::ast::statement::ret* node) override
+		if (!export_name.empty())
 		{
-			if (node->value)
-			{
-				node->value->visit(this);
-				gen.builder.CreateRet(val);
-			}
-			else
-			{
-				gen.builder.CreateRetVoid();
-			}
-
-			return false;
+			c_exports.push_back({ function, def_stat, std::move(export_name) });
 		}
-	};
+	}
+
+	return function;
 }
 
-llvm::Type* code_gen::code_gen::get_llvm_type(ir::types::type_descriptor* type_desc)
+llvm::Constant* code_gen::code_gen::get_string_literal(llvm::StringRef value)
 {
-	auto it = type_map.find(type_desc);
-	if (it != type_map.cend())
-	{
-		return it->second;
-	}
+	auto& context = llvm_mod->getContext();
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<void>*>(type_desc))
+	auto& global_var = string_pool[value];
+	if (!global_var)
 	{
-		return type_map[type_desc] = llvm::Type::getVoidTy(llvm_mod->getContext());
+		// only the bytes go into the global, the length is part of the value.
+		// the terminator isn't part of the string, but it makes the global a c string which llvm puts into a mergeable section,
+		// so the linker can share literals across modules. even the empty string gets one, null is the empty state of string?
+		auto str_const = llvm::ConstantDataArray::getString(context, value, true);
+		global_var = new llvm::GlobalVariable{ *llvm_mod, str_const->getType(),
+			true, llvm::GlobalValue::PrivateLinkage, str_const };
+		global_var->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+		global_var->setAlignment(llvm::Align(1));
 	}
 
-	// string (immutable)
-	// 3, "abc"
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::string>*>(type_desc))
-	{
-		// TODO: check if getIntNTy takes bits or bytes
-		return llvm::PointerType::get(llvm::Type::getIntNTy(llvm_mod->getContext(), data_layout->getMaxPointerSizeInBits()), 0);
-	}
+	auto zero = llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), 0);
+	std::array<llvm::Constant*, 2> indicies = { zero, zero };
+	auto data = llvm::ConstantExpr::getInBoundsGetElementPtr(global_var->getValueType(), global_var, llvm::makeArrayRef(indicies));
+	auto size = llvm::ConstantInt::get(context, llvm::APInt(data_layout->getMaxPointerSizeInBits(), value.size(), false));
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<bool>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getInt8Ty(llvm_mod->getContext());
-	}
+	return llvm::ConstantStruct::get(llvm::cast<llvm::StructType>(get_string_type()), data, size);
+}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int8_t>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getInt8Ty(llvm_mod->getContext());
-	}
+llvm::Constant* code_gen::code_gen::get_constant(const comptime::value& value, llvm::Type* type)
+{
+	return std::visit([&](const auto& constant) -> llvm::Constant*
+		{
+			using T = std::decay_t<decltype(constant)>;
+			if constexpr (std::is_same_v<T, comptime::array_value>)
+			{
+				auto array_type = llvm::dyn_cast<llvm::ArrayType>(type);
+				if (!array_type || array_type->getNumElements() != constant.elements.size())
+				{
+					return nullptr;
+				}
+
+				std::vector<llvm::Constant*> elements;
+				elements.reserve(constant.elements.size());
+				for (const auto& element : constant.elements)
+				{
+					elements.push_back(get_constant(element, array_type->getElementType()));
+					if (!elements.back())
+					{
+						return nullptr;
+					}
+				}
+				return llvm::ConstantArray::get(array_type, elements);
+			}
+			else if constexpr (std::is_same_v<T, std::string>)
+			{
+				return type == get_string_type() ? get_string_literal(constant) : nullptr;
+			}
+			else if constexpr (std::is_same_v<T, bool>)
+			{
+				// bools are stored as i8
+				return type->isIntegerTy(8) ? llvm::ConstantInt::get(type, constant) : nullptr;
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				return (std::is_same_v<T, float> ? type->isFloatTy() : type->isDoubleTy()) ? llvm::ConstantFP::get(type, constant) : nullptr;
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				return type->isIntegerTy(sizeof(T) * 8) ? llvm::ConstantInt::get(type, static_cast<std::uint64_t>(constant), std::is_signed_v<T>) : nullptr;
+			}
+			else
+			{
+				return nullptr;
+			}
+		}, value);
+}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int16_t>*>(type_desc))
+void code_gen::code_gen::merge_string_suffixes()
+{
+	// sorted by their reversed text, largest first, a literal comes right after the longest literal it ends
+	std::vector<std::pair<std::string, llvm::GlobalVariable*>> literals;
+	literals.reserve(string_pool.size());
+	for (auto& entry : string_pool)
 	{
-		return type_map[type_desc] = llvm::Type::getInt16Ty(llvm_mod->getContext());
+		auto reversed = entry.getKey().str();
+		std::reverse(reversed.begin(), reversed.end());
+		literals.emplace_back(std::move(reversed), entry.getValue());
 	}
+	std::sort(literals.begin(), literals.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int32_t>*>(type_desc))
+	auto index_type = llvm::Type::getInt64Ty(llvm_mod->getContext());
+	const std::pair<std::string, llvm::GlobalVariable*>* owner = nullptr;
+	for (const auto& literal : literals)
 	{
-		return type_map[type_desc] = llvm::Type::getInt32Ty(llvm_mod->getContext());
-	}
+		if (!owner || !llvm::StringRef{ owner->first }.startswith(literal.first))
+		{
+			owner = &literal;
+			continue;
+		}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::int64_t>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getInt64Ty(llvm_mod->getContext());
-	}
+		// both end in the terminator, so the shorter one starts that many bytes into the longer one.
+		// the whole global is replaced, a use may have folded the pointer to the first byte into a cast of it
+		std::array<llvm::Constant*, 2> new_indicies = { llvm::ConstantInt::get(index_type, 0), llvm::ConstantInt::get(index_type, owner->first.size() - literal.first.size()) };
+		auto new_data = llvm::ConstantExpr::getInBoundsGetElementPtr(owner->second->getValueType(), owner->second, llvm::makeArrayRef(new_indicies));
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint8_t>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getInt8Ty(llvm_mod->getContext());
+		literal.second->replaceAllUsesWith(llvm::ConstantExpr::getBitCast(new_data, literal.second->getType()));
+		literal.second->eraseFromParent();
 	}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint16_t>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getInt16Ty(llvm_mod->getContext());
-	}
+	string_pool.clear();
+}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint32_t>*>(type_desc))
+llvm::Function* code_gen::code_gen::get_runtime_function(const std::string& name, llvm::FunctionType* type)
+{
+	auto function = llvm_mod->getFunction(name);
+	if (!function)
 	{
-		return type_map[type_desc] = llvm::Type::getInt32Ty(llvm_mod->getContext());
+		function = llvm::Function::Create(type, llvm::GlobalValue::ExternalLinkage, name, *llvm_mod);
 	}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<std::uint64_t>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getInt64Ty(llvm_mod->getContext());
-	}
+	return function;
+}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<float>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getFloatTy(llvm_mod->getContext());
-	}
+llvm::Function* code_gen::code_gen::get_throw_function()
+{
+	auto& context = llvm_mod->getContext();
+	auto throw_func = get_runtime_function("seam_throw", llvm::FunctionType::get(llvm::Type::getVoidTy(context),
+		{ llvm::Type::getInt8PtrTy(context), data_layout->getIntPtrType(context) }, false));
+	throw_func->addFnAttr(llvm::Attribute::NoReturn);
+	return throw_func;
+}
 
-	if (dynamic_cast<ir::types::built_in_type_descriptor<double>*>(type_desc))
-	{
-		return type_map[type_desc] = llvm::Type::getDoubleTy(llvm_mod->getContext());
-	}
-	
-	throw std::runtime_error("not implemented");
+std::vector<llvm::Value*> code_gen::code_gen::get_throw_arguments(llvm::Value* message)
+{
+	// the size is a size_t on the runtime's side
+	auto size = builder.CreateZExtOrTrunc(builder.CreateExtractValue(message, 1), data_layout->getIntPtrType(llvm_mod->getContext()));
+	return { builder.CreateExtractValue(message, 0), size };
+}
 
-	return nullptr;
+llvm::Value* code_gen::code_gen::create_catch(llvm::Value* exception)
+{
+	// returned in registers or through memory depending on the target, like from any extern
+	auto sig = c_abi->classify(get_string_type(), false, { { exception->getType(), false } });
+	auto catch_func = get_runtime_function("seam_catch", sig.type);
+	c_abi->add_attributes(catch_func, sig);
+	catch_func->addFnAttr(llvm::Attribute::NoUnwind);
+
+	llvm::Value* sret = nullptr;
+	auto call = builder.CreateCall(catch_func, c_abi->lower_arguments(builder, sig, { exception }, sret));
+	c_abi->add_attributes(call, sig);
+	return c_abi->lower_result(builder, sig, call, sret);
 }
 
-llvm::Type* code_gen::code_gen::get_llvm_type(ir::types::type_reference& type_ref)
+void code_gen::code_gen::check_exception_support(position pos)
 {
-	auto base_type = get_llvm_type(type_ref.type.get());
-	if (type_ref.is_optional)
+	// the runtime only has a personality for the itanium unwinder, windows would need seh
+	if (llvm::Triple{ llvm_mod->getTargetTriple() }.isOSWindows())
 	{
-		std::array<llvm::Type*, 2> struct_fields { llvm::Type::getInt8Ty(llvm_mod->getContext()), base_type };
-		return llvm::StructType::get(llvm_mod->getContext(), llvm::makeArrayRef(struct_fields));
+		throw exception(pos, "exceptions are not supported on windows targets");
 	}
-
-	return base_type;
 }
 
-llvm::FunctionType* code_gen::code_gen::get_llvm_function_type(ir::ast::statement::function_declaration* func_def)
+void code_gen::code_gen::lower_function(llvm::Function* function, ir::cfg::function_graph& graph, code_gen_visitor& gen)
 {
-	auto ret_type = get_llvm_type(std::get<ir::types::type_reference>(func_def->return_type));
-	if (!llvm::FunctionType::isValidReturnType(ret_type))
+	// every floating point instruction the builder creates for the body gets the flags of the function
+	builder.setFastMathFlags(get_fast_math_flags(graph.function));
+
+	// laid out in reverse postorder, every block but loop headers is lowered after all of its predecessors
+	ir::cfg::rpo_traversal rpo{ &graph };
+
+	llvm::DenseMap<ir::cfg::block*, llvm::BasicBlock*> basic_blocks;
+	for (auto block : rpo)
 	{
-		throw exception(func_def->range.start, "invalid return type");
+		basic_blocks[block] = llvm::BasicBlock::Create(llvm_mod->getContext(), block == graph.entry ? "entry" : "", function);
 	}
 
-	std::vector<llvm::Type*> parameter_types;
-	parameter_types.reserve(func_def->arguments.size());
+	// parameters are just the first definition of a local, only arrays have to be spilled to be indexed, big ones already are.
+	// one that came in as scalars is put back together, which folds away wherever only a part is used
+	ssa.reset();
+	gen.array_slots.clear();
+	gen.hoisted_guards.clear();
+	builder.SetInsertPoint(basic_blocks[graph.entry]);
+	auto func_def = graph.function;
+	auto arg = function->arg_begin();
 	for (auto& param : func_def->arguments)
 	{
-		auto param_type = get_llvm_type(std::get<ir::types::type_reference>(param.type_));
-		if (!llvm::FunctionType::isValidArgumentType(param_type))
+		auto& type_ref = std::get<ir::types::type_reference>(param.type_);
+		auto param_type = get_llvm_type(type_ref);
+		if (function->getCallingConv() == llvm::CallingConv::Fast && passes_by_pointer(type_ref))
 		{
-			throw exception(func_def->range.start, "invalid argument type");
+			arg->setName(param.name);
+			gen.array_slots[&param] = { arg, param_type, get_alignment(type_ref), type_ref.type.get() };
+			++arg;
+			continue;
 		}
-		parameter_types.push_back(param_type);
-	}
-
-	return llvm::FunctionType::get(ret_type, llvm::makeArrayRef(parameter_types), false);
-}
 
-llvm::Function* code_gen::code_gen::get_or_declare_function(const std::string& symbol, ir::ast::statement::function_declaration* def_stat)
-{
-	std::string name;
-	llvm::GlobalValue::LinkageTypes linkage;
+		std::vector<llvm::SmallVector<unsigned, 2>> paths;
+		if (function->getCallingConv() == llvm::CallingConv::Fast)
+		{
+			paths = get_scalar_paths(param_type);
+		}
 
-	// TODO: maybe add destructors?
-	// TODO: only one constructor per module? done i think
-	bool is_constructor = def_stat->attributes.find("constructor") != def_stat->attributes.cend();
-	bool is_extern = dynamic_cast<ir::ast::statement::extern_definition*>(def_stat) != nullptr;
+		llvm::Value* value = arg;
+		if (paths.empty())
+		{
+			arg->setName(param.name);
+			++arg;
+		}
+		else
+		{
+			value = llvm::UndefValue::get(param_type);
+			for (std::size_t i = 0; i < paths.size(); ++i, ++arg)
+			{
+				arg->setName(param.name + "." + std::to_string(i));
+				value = builder.CreateInsertValue(value, arg, paths[i]);
+			}
+		}
 
-	// TODO: test extern with @export or @constructor :KEKW:
-	// TODO: add type name to function name
-	if ((is_constructor && mod.is_root)
-		|| def_stat->attributes.find("export") != def_stat->attributes.cend())
-	{
-		if (is_extern)
+		// an export that takes everything as it is is called from c directly
+		if (function->getCallingConv() != llvm::CallingConv::Fast)
 		{
-			throw exception(def_stat->range.start, "exporting extern function is not allowed");
+			value = normalize_from_c(value, type_ref);
 		}
 
-		linkage = llvm::GlobalValue::ExternalLinkage;
-		name = mod.relative_path + '@' + symbol;
+		if (code_gen_visitor::is_array(&param))
+		{
+			auto type = type_ref.type.get();
+			auto slot = gen.slot_place(gen.create_slot(type), type);
+			builder.CreateAlignedStore(value, slot.pointer, slot.alignment);
+			gen.array_slots[&param] = slot;
+			continue;
+		}
+		ssa.write_variable(&param, basic_blocks[graph.entry], value);
 	}
-	else
+
+	// a block is sealed once all predecessors have their terminator, for loop headers that's after the back edge
+	llvm::DenseMap<ir::cfg::block*, std::size_t> filled_predecessors;
+	ssa.seal_block(basic_blocks[graph.entry]);
+
+	auto& context = llvm_mod->getContext();
+	for (auto block : rpo)
 	{
-		linkage = is_extern ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::InternalLinkage;
-		name = symbol;
+		builder.SetInsertPoint(basic_blocks[block]);
+		gen.unwind_dest = block->unwind_target ? basic_blocks[block->unwind_target] : nullptr;
+
+		if (auto try_stat = block->landing_pad_for)
+		{
+			check_exception_support(try_stat->range.start);
+
+			// every catch takes everything, the runtime hands back the thrown string and frees the exception
+			auto landing_pad = builder.CreateLandingPad(llvm::StructType::get(llvm::Type::getInt8PtrTy(context), llvm::Type::getInt32Ty(context)), 1);
+			landing_pad->addClause(llvm::ConstantPointerNull::get(llvm::Type::getInt8PtrTy(context)));
+
+			auto value = create_catch(builder.CreateExtractValue(landing_pad, 0));
+
+			if (try_stat->catch_variable)
+			{
+				ssa.write_variable(&*try_stat->catch_variable, builder.GetInsertBlock(), value);
+			}
+		}
+
+		for (auto stat : block->body)
+		{
+			stat->visit(&gen);
+		}
+
+		auto cf_instr = block->cf_instr.get();
+		if (auto jump = dynamic_cast<ir::cfg::jump_instruction*>(cf_instr))
+		{
+			// the way into a loop rather than around it, the header isn't lowered yet
+			if (jump->target->loop_for && basic_blocks[jump->target]->empty())
+			{
+				gen.create_hoisted_guards(jump->target->loop_for);
+			}
+			builder.CreateBr(basic_blocks[jump->target]);
+		}
+		else if (auto branch = dynamic_cast<ir::cfg::if_instruction*>(cf_instr))
+		{
+			builder.CreateCondBr(gen.create_condition(branch->condition), basic_blocks[branch->true_target], basic_blocks[branch->false_target]);
+		}
+		else if (auto switch_instr = dynamic_cast<ir::cfg::switch_instruction*>(cf_instr))
+		{
+			switch_instr->stat->value->visit(&gen);
+			auto value = gen.val;
+
+			auto type = switch_instr->stat->type.get();
+			auto default_dest = basic_blocks[switch_instr->default_target];
+
+			switch_lowering lowering{ builder, *llvm_mod };
+			if (ir::types::is_built_in<std::string>(type))
+			{
+				std::vector<switch_lowering::string_case> cases;
+				for (auto& [label, target] : switch_instr->cases)
+				{
+					// shares the global of the same literal anywhere else in the module
+					const auto& text = static_cast<ir::ast::expression::literal<std::string>*>(label)->val;
+					cases.push_back({ text, get_string_literal(text)->getAggregateElement(0u), basic_blocks[target] });
+				}
+
+				auto [data, size] = gen.string_parts(value);
+				lowering.lower(data, size, std::move(cases), default_dest);
+			}
+			else
+			{
+				std::vector<switch_lowering::integer_case> cases;
+				for (auto& [label, target] : switch_instr->cases)
+				{
+					label->visit(&gen);
+					cases.push_back({ llvm::cast<llvm::ConstantInt>(gen.val), basic_blocks[target] });
+				}
+
+				lowering.lower(value, std::move(cases), default_dest, ir::types::is_signed_integer(type));
+			}
+
+			// nothing else branches into the dispatch blocks
+			for (auto dispatch_block : lowering.blocks())
+			{
+				ssa.seal_block(dispatch_block);
+			}
+		}
+		else if (auto throw_instr = dynamic_cast<ir::cfg::throw_instruction*>(cf_instr))
+		{
+			throw_instr->stat->value->visit(&gen);
+
+			if (throw_instr->handler)
+			{
+				// caught by a try in the same function, nothing has to unwind
+				if (throw_instr->handler->catch_variable)
+				{
+					ssa.write_variable(&*throw_instr->handler->catch_variable, builder.GetInsertBlock(), gen.val);
+				}
+				builder.CreateBr(basic_blocks[throw_instr->catch_target]);
+			}
+			else
+			{
+				check_exception_support(throw_instr->stat->range.start);
+
+				builder.CreateCall(get_throw_function(), get_throw_arguments(gen.val));
+				builder.CreateUnreachable();
+			}
+		}
+		else if (auto ret = dynamic_cast<ir::cfg::return_instruction*>(cf_instr))
+		{
+			// falling off the end right after a call that doesn't return either never gets here
+			auto last_call = llvm::dyn_cast_or_null<llvm::CallInst>(builder.GetInsertBlock()->empty() ? nullptr : &builder.GetInsertBlock()->back());
+			if (function->doesNotReturn() && !ret->stat && last_call && last_call->doesNotReturn())
+			{
+				builder.CreateUnreachable();
+			}
+			else if (function->doesNotReturn())
+			{
+				throw exception(ret->stat ? ret->stat->range.start : graph.function->range.start, "@noreturn function '" + graph.function->name + "' can return");
+			}
+
+			else if (ret->stat)
+			{
+				ret->stat->visit(&gen);
+			}
+			else
+			{
+				builder.CreateRetVoid();
+			}
+		}
+
+		// one count per edge, like the predecessor list
+		for (auto succ : block->successors)
+		{
+			if (++filled_predecessors[succ] == succ->predecessors.size())
+			{
+				ssa.seal_block(basic_blocks[succ]);
+			}
+		}
 	}
+	gen.unwind_dest = nullptr;
+	builder.clearFastMathFlags();
 
-	auto function = llvm_mod->getFunction(symbol);
-	if (!function)
+	// a landing pad is only reached through invokes, without any it's dead along with catch code only it led to
+	llvm::EliminateUnreachableBlocks(*function);
+	if (llvm::any_of(*function, [](const llvm::BasicBlock& basic_block) { return basic_block.isLandingPad(); }))
 	{
-		llvm::FunctionType* func_type = get_llvm_function_type(def_stat);
-		function = llvm::Function::Create(func_type, linkage, name, *llvm_mod);
+		function->setPersonalityFn(get_runtime_function("seam_personality", llvm::FunctionType::get(llvm::Type::getInt32Ty(context), true)));
 	}
-
-	return function;
 }
 
-code_gen::code_gen::code_gen(std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& type_map, llvm::LLVMContext& context, ir::ast::module& root, const std::string& target_triple) :
+code_gen::code_gen::code_gen(std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& type_map, llvm::LLVMContext& context, ir::ast::module& root, const std::string& target_triple,
+	bool fast_math) :
 	mod(root),
 	type_map(type_map),
 	llvm_mod(std::make_shared<llvm::Module>(root.relative_path, context)),
-	builder(context)
+	builder(context),
+	fast_math(fast_math)
 {
 	llvm_mod->setTargetTriple(target_triple);
+
+	// sizes, alignments and the c abi all go by the layout of the target. without one llvm falls back to a default
+	// that aligns i64 and double to 4 bytes, which matches no target we generate code for
+	std::string error;
+	auto target = llvm::TargetRegistry::lookupTarget(target_triple, error);
+	if (!target)
+	{
+		throw std::runtime_error("no target for '" + target_triple + "': " + error);
+	}
+
+	std::unique_ptr<llvm::TargetMachine> target_machine{ target->createTargetMachine(target_triple, "generic", "", llvm::TargetOptions{}, llvm::None) };
+	llvm_mod->setDataLayout(target_machine->createDataLayout());
 	data_layout = std::make_unique<llvm::DataLayout>(llvm_mod.get());
+	c_abi = std::make_unique<abi_lowering>(*llvm_mod, *data_layout);
 }
 
 std::shared_ptr<llvm::Module> code_gen::code_gen::gen_code()
@@ -418,12 +2737,52 @@ std::shared_ptr<llvm::Module> code_gen::code_gen::gen_code()
 	parser::variable_resolver variable_resolver{ collector.collected };
 	mod.body->visit(&variable_resolver);
 
+	parser::attribute_checker attribute_checker;
+	mod.body->visit(&attribute_checker);
+
+	parser::literal_typer literal_typer;
+	mod.body->visit(&literal_typer);
+
+	parser::constant_folder constant_folder;
+	mod.body->visit(&constant_folder);
+
+	// before effect_analysis, a check that is gone can't throw anymore
+	parser::range_analysis range_analysis;
+	mod.body->visit(&range_analysis);
+	range_remarks = range_analysis.get_remarks();
+
+	parser::call_graph call_graph;
+	mod.body->visit(&call_graph);
+
+	// nothing outside of the module can reach a function that isn't reachable from the constructor or an export,
+	// so don't even declare it
+	const auto reachable = call_graph.reachable();
+
+	parser::effect_analysis effect_analysis;
+	mod.body->visit(&effect_analysis);
+	function_effects = effect_analysis.infer();
+
 	code_gen_visitor gen{ *this };
 
-	bool constructor_defined = false;
-	for (auto [symbol, func_def] : collector.collected)
-	{	
-		llvm::GlobalValue::LinkageTypes linkage;
+	std::vector<std::pair<llvm::Function*, ir::ast::statement::function_declaration*>> multiversioned;
+
+	// declare everything up front so functions land in the module in source order,
+	// instead of in whatever order the bodies happen to reference them
+	for (auto& [symbol, func_def] : collector.collected)
+	{
+		if (reachable.count(func_def))
+		{
+			add_function_attributes(get_or_declare_function(symbol, func_def), func_def);
+		}
+	}
+
+	for (auto& [symbol, func_def] : collector.collected)
+	{
+		if (!reachable.count(func_def))
+		{
+			continue;
+		}
+
 		auto function = get_or_declare_function(symbol, func_def);
 		if (!function->empty())
 		{
@@ -435,17 +2794,67 @@ std::shared_ptr<llvm::Module> code_gen::code_gen::gen_code()
 			continue;
 		}
 
-		llvm::BasicBlock *basic_block = llvm::BasicBlock::Create(llvm_mod->getContext(), "entry", function);
-		builder.SetInsertPoint(basic_block);
+		auto graph = cfg_builder::cfg_builder::build_function(static_cast<ir::ast::statement::function_definition*>(func_def));
+		lower_function(function, *graph, gen);
 
-		func_def->visit(&gen);
+		llvm::verifyFunction(*function);
 
-		if (basic_block->empty() || !llvm::isa<llvm::ReturnInst>(basic_block->back()))
+		if (func_def->attributes.find("target_clones") != func_def->attributes.cend())
 		{
-			builder.CreateRetVoid();
+			multiversioned.emplace_back(function, func_def);
 		}
+	}
 
-		llvm::verifyFunction(*function);
+	// before the clones, a wrapper calls the dispatch like any other caller
+	for (auto& c_export : c_exports)
+	{
+		emit_c_wrapper(c_export.implementation, c_export.func_def, c_export.name);
+	}
+
+	// callees need their bodies, and the clones below should get the flattened one
+	for (auto& [symbol, func_def] : collector.collected)
+	{
+		if (reachable.count(func_def) && func_def->attributes.find("flatten") != func_def->attributes.cend())
+		{
+			flatten(get_or_declare_function(symbol, func_def), multiversioned);
+		}
+	}
+
+	// only once every body is done, the function stops being a function on elf and couldn't be looked up by name anymore
+	target_clones clones{ *llvm_mod };
+	for (auto [function, func_def] : multiversioned)
+	{
+		clones.emit(function, func_def->attributes.at("target_clones"), func_def->range.start);
+	}
+
+	merge_string_suffixes();
+
+	// folded calls can leave internal functions (and the externs and constants only they used) without any users
+	bool erased = true;
+	while (erased)
+	{
+		erased = false;
+		for (auto it = llvm_mod->begin(); it != llvm_mod->end();)
+		{
+			auto& function = *it++;
+			function.removeDeadConstantUsers();
+			if ((function.hasLocalLinkage() || function.isDeclaration()) && function.use_empty())
+			{
+				function.eraseFromParent();
+				erased = true;
+			}
+		}
+
+		for (auto it = llvm_mod->global_begin(); it != llvm_mod->global_end();)
+		{
+			auto& global = *it++;
+			global.removeDeadConstantUsers();
+			if (global.hasLocalLinkage() && global.use_empty())
+			{
+				global.eraseFromParent();
+				erased = true;
+			}
+		}
 	}
 
 	return llvm_mod;
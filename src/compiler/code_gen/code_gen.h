@@ -1,18 +1,54 @@
 #pragma once
 
+#include <llvm/ADT/StringMap.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/LLVMContext.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 #include "../ir/ast/ast.h"
+#include "../ir/cfg/cfg.h"
+#include "../comptime/interpreter.h"
+#include "../parser/passes/effect_analysis.h"
+#include "../parser/passes/range_analysis.h"
+#include "ssa_builder.h"
+#include "abi_lowering.h"
 
 
 namespace seam::compiler::code_gen
 {
 	struct code_gen_visitor;
 
+	// how `T?` is represented. types with a niche (a bit pattern no value of theirs uses) mark the empty state with it,
+	// everything else gets a tag after the value so the value stays at offset 0
+	struct optional_layout
+	{
+		enum class kind
+		{
+			niche,
+			tagged, // { T, i8 }, the tag is 1 when a value is present
+		};
+
+		kind repr;
+		llvm::Type* type;
+		llvm::Constant* empty; // the whole empty optional
+	};
+
+	// where the fields of a class ended up in its llvm struct
+	struct class_layout
+	{
+		llvm::StructType* type;
+		std::vector<unsigned> field_indices; // struct element of every field, in declaration order
+		// classes with layout attributes become packed structs with explicit padding, so their llvm type
+		// doesn't know the alignment. anything placing one in memory has to use this one
+		llvm::Align alignment;
+	};
+
 	class code_gen
 	{
 		friend code_gen_visitor;
@@ -25,15 +61,100 @@ namespace seam::compiler::code_gen
 
 		std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& type_map;
 
+		comptime::interpreter interpreter;
+		ssa_builder ssa;
+
+		std::unordered_map<const ir::types::class_type_descriptor*, class_layout> class_layouts;
+
+		// one global per distinct string literal in the module
+		llvm::StringMap<llvm::GlobalVariable*> string_pool;
+
+		std::unique_ptr<abi_lowering> c_abi;
+		std::unordered_map<ir::ast::statement::function_declaration*, abi_lowering::signature> c_signatures;
+
+		// exports whose c signature differs from the seam one, the body is in `implementation`
+		struct c_export
+		{
+			llvm::Function* implementation;
+			ir::ast::statement::function_declaration* func_def;
+			std::string name;
+		};
+		std::vector<c_export> c_exports;
+
+		// --fast-math, every function is compiled as if it had @fast_math
+		bool fast_math;
+
+		std::vector<parser::range_analysis::remark> range_remarks;
+
+		// what calling each function can do, a call that can't unwind never needs an invoke
+		std::unordered_map<ir::ast::statement::function_declaration*, parser::effect_analysis::effects> function_effects;
+
+		llvm::Type* get_string_type();
 		llvm::Type* get_llvm_type(ir::types::type_descriptor* type_desc);
 		llvm::Type* get_llvm_type(ir::types::type_reference& type_ref);
+		optional_layout get_optional_layout(ir::types::type_descriptor* type_desc);
+		// computed on first use, the struct type is also cached in type_map
+		const class_layout& get_class_layout(ir::types::class_type_descriptor* class_type);
+		// storage for `length` elements of a @soa class, array i holds field i in declaration order
+		llvm::StructType* get_soa_type(ir::types::class_type_descriptor* class_type, std::uint64_t length);
+		llvm::Align get_alignment(ir::types::type_reference& type_ref);
+		llvm::Align get_alignment(ir::types::type_descriptor* type_desc);
 
-		llvm::FunctionType* get_llvm_function_type(ir::ast::statement::function_declaration* func_def);
+		// strings, optionals and classes of a few fields, anything bigger is better off in memory
+		constexpr static std::size_t max_scalars = 4;
+
+		// functions that never leave the module use fastcc, take small aggregates as their scalars and big arrays by pointer
+		llvm::FunctionType* get_llvm_function_type(ir::ast::statement::function_declaration* func_def, bool internal_abi);
+		// index paths of the scalars an argument is split into, empty when it's passed as is
+		std::vector<llvm::SmallVector<unsigned, 2>> get_scalar_paths(llvm::Type* type);
+		// a non-optional array of more than max_scalars scalars, a fastcc function gets a pointer to the caller's copy
+		bool passes_by_pointer(ir::types::type_reference& type_ref);
+		// adds a seam value to the arguments of a call, split up or spilled if the callee takes it that way
+		void push_argument(std::vector<llvm::Value*>& arguments, llvm::Function* callee, llvm::Value* value);
+		// how an extern or exported function crosses the module boundary
+		const abi_lowering::signature& get_c_signature(ir::ast::statement::function_declaration* func_def);
+		void emit_c_wrapper(llvm::Function* implementation, ir::ast::statement::function_declaration* func_def, const std::string& name);
+		// c may hand over an empty string or slice as { NULL, 0 }, seam code never has a null data pointer.
+		// such a value coming from an extern or into an export gets the one of the empty string literal instead
+		llvm::Value* normalize_from_c(llvm::Value* value, ir::types::type_reference& type_ref);
 
 		llvm::Function* get_or_declare_function(const std::string& symbol, ir::ast::statement::function_declaration* def_stat);
+		// nounwind, readnone, readonly, argmemonly and willreturn from function_effects
+		void add_inferred_attributes(llvm::Function* function, ir::ast::statement::function_declaration* func_def);
+		// what is known about the data pointers a fastcc function gets strings and slices split into and the arrays it gets by pointer
+		void add_pointer_attributes(llvm::Function* function, ir::ast::statement::function_declaration* func_def);
+		// @inline, @noinline, @noreturn, @pure, @hot, @cold and the floating point model
+		void add_function_attributes(llvm::Function* function, ir::ast::statement::function_declaration* func_def);
+		// @fast_math, @fp(...) or --fast-math, none for externs
+		llvm::FastMathFlags get_fast_math_flags(ir::ast::statement::function_declaration* func_def);
+		// @flatten, inlines every call in the body recursively
+		void flatten(llvm::Function* function, const std::vector<std::pair<llvm::Function*, ir::ast::statement::function_declaration*>>& multiversioned);
+		llvm::Constant* get_string_literal(llvm::StringRef value);
+		// what the interpreter worked out as a constant of `type`, nullptr when it doesn't fit
+		llvm::Constant* get_constant(const comptime::value& value, llvm::Type* type);
+		// lets literals that end another literal point into its bytes, needs every literal of the module
+		void merge_string_suffixes();
+
+		llvm::Function* get_runtime_function(const std::string& name, llvm::FunctionType* type);
+		// seam_throw, takes the bytes and the length of a string like the runtime declares it and never returns
+		llvm::Function* get_throw_function();
+		std::vector<llvm::Value*> get_throw_arguments(llvm::Value* message);
+		// seam_catch, hands back the thrown string the way the c abi returns it
+		llvm::Value* create_catch(llvm::Value* exception);
+
+		// throws on targets the runtime has no unwinder for
+		void check_exception_support(position pos);
+
+		void lower_function(llvm::Function* function, ir::cfg::function_graph& graph, code_gen_visitor& gen);
 	public:
-		code_gen(std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& type_map, llvm::LLVMContext& context, ir::ast::module& root, const std::string& target_triple);
+		code_gen(std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& type_map, llvm::LLVMContext& context, ir::ast::module& root, const std::string& target_triple,
+			bool fast_math);
 
 		std::shared_ptr<llvm::Module> gen_code();
+
+		// offsets, sizes and padding of every class in the module, the arrays of a @soa class, for --print-layout
+		void print_layouts(llvm::raw_ostream& os);
+		// the checks range_analysis removed, hoisted or had to keep, for --print-range-remarks
+		void print_range_remarks(llvm::raw_ostream& os);
 	};
 }
\ No newline at end of file
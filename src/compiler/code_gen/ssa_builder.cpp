@@ -0,0 +1,169 @@
+#include "ssa_builder.h"
+
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace seam::compiler;
+
+llvm::PHINode* code_gen::ssa_builder::create_phi(variable var, llvm::BasicBlock* block)
+{
+	auto type = variable_types.lookup(var);
+	if (!type)
+	{
+		throw std::runtime_error("read of variable '" + var->name + "' before it was written");
+	}
+
+	if (auto first = block->getFirstNonPHI())
+	{
+		return llvm::PHINode::Create(type, 0, var->name, first);
+	}
+	return llvm::PHINode::Create(type, 0, var->name, block);
+}
+
+void code_gen::ssa_builder::write_variable(variable var, llvm::BasicBlock* block, llvm::Value* value)
+{
+	variable_types.try_emplace(var, value->getType());
+	current_defs[block][var] = value;
+}
+
+llvm::Value* code_gen::ssa_builder::read_variable(variable var, llvm::BasicBlock* block)
+{
+	auto block_defs = current_defs.find(block);
+	if (block_defs != current_defs.end())
+	{
+		auto def = block_defs->second.find(var);
+		if (def != block_defs->second.end() && def->second)
+		{
+			return def->second;
+		}
+	}
+	return read_variable_recursive(var, block);
+}
+
+llvm::Value* code_gen::ssa_builder::read_variable_recursive(variable var, llvm::BasicBlock* block)
+{
+	llvm::Value* value;
+	if (!sealed_blocks.count(block))
+	{
+		// not all predecessors are known yet, the operands get filled in when the block is sealed
+		auto phi = create_phi(var, block);
+		incomplete_phis[block][var] = phi;
+		value = phi;
+	}
+	else if (auto pred = block->getSinglePredecessor())
+	{
+		value = read_variable(var, pred);
+	}
+	else if (llvm::pred_empty(block))
+	{
+		// only reachable when the variable is read on a path where it was never written
+		value = llvm::UndefValue::get(variable_types.lookup(var));
+	}
+	else
+	{
+		// write the phi first to break cycles through loops
+		auto phi = create_phi(var, block);
+		write_variable(var, block, phi);
+		value = add_phi_operands(var, phi);
+	}
+
+	write_variable(var, block, value);
+	return value;
+}
+
+llvm::Value* code_gen::ssa_builder::add_phi_operands(variable var, llvm::PHINode* phi)
+{
+	// an edge appears once per occurrence in the predecessor list, as the phi needs one entry per edge
+	for (auto pred : llvm::predecessors(phi->getParent()))
+	{
+		phi->addIncoming(read_variable(var, pred), pred);
+	}
+	return try_remove_trivial_phi(phi);
+}
+
+llvm::Value* code_gen::ssa_builder::try_remove_trivial_phi(llvm::PHINode* phi)
+{
+	llvm::Value* same = nullptr;
+	for (auto& op : phi->incoming_values())
+	{
+		if (op == same || op == phi)
+		{
+			continue;
+		}
+
+		if (same)
+		{
+			// merges at least two values
+			return phi;
+		}
+		same = op;
+	}
+
+	if (!same)
+	{
+		// unreachable or in the entry block
+		same = llvm::UndefValue::get(phi->getType());
+	}
+
+	// removing one user can remove another one further down, so don't hold on to raw pointers
+	std::vector<llvm::WeakVH> phi_users;
+	for (auto user : phi->users())
+	{
+		if (auto user_phi = llvm::dyn_cast<llvm::PHINode>(user); user_phi && user_phi != phi)
+		{
+			phi_users.push_back(user_phi);
+		}
+	}
+
+	phi->replaceAllUsesWith(same);
+	phi->eraseFromParent();
+
+	// users that were phis might have become trivial now
+	for (auto& user : phi_users)
+	{
+		if (user)
+		{
+			try_remove_trivial_phi(llvm::cast<llvm::PHINode>(user));
+		}
+	}
+
+	return same;
+}
+
+void code_gen::ssa_builder::seal_block(llvm::BasicBlock* block)
+{
+	if (!sealed_blocks.insert(block).second)
+	{
+		return;
+	}
+
+	auto it = incomplete_phis.find(block);
+	if (it == incomplete_phis.end())
+	{
+		return;
+	}
+
+	auto phis = std::move(it->second);
+	incomplete_phis.erase(it);
+
+	for (auto& [var, phi] : phis)
+	{
+		add_phi_operands(var, phi);
+	}
+}
+
+bool code_gen::ssa_builder::is_sealed(llvm::BasicBlock* block) const
+{
+	return sealed_blocks.count(block);
+}
+
+void code_gen::ssa_builder::reset()
+{
+	current_defs.clear();
+	incomplete_phis.clear();
+	sealed_blocks.clear();
+	variable_types.clear();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/ValueHandle.h>
+
+#include "../ir/ast/ast.h"
+
+namespace seam::compiler::code_gen
+{
+	// builds ssa values for locals while lowering, so they never go through an alloca.
+	// implements "Simple and Efficient Construction of Static Single Assignment Form" (Braun et al. 2013),
+	// phis are placed on demand when a variable is read in a block that doesn't define it and trivial ones are removed again.
+	// a block has to be sealed once all of its predecessors are known, reads in unsealed blocks get an incomplete phi
+	class ssa_builder
+	{
+		using variable = const ir::ast::var*;
+
+		// weak tracking handles follow replaceAllUsesWith, so removing a trivial phi also updates the definitions pointing to it
+		llvm::DenseMap<llvm::BasicBlock*, llvm::DenseMap<variable, llvm::WeakTrackingVH>> current_defs;
+		llvm::DenseMap<llvm::BasicBlock*, llvm::MapVector<variable, llvm::PHINode*>> incomplete_phis;
+		llvm::SmallPtrSet<llvm::BasicBlock*, 16> sealed_blocks;
+		llvm::DenseMap<variable, llvm::Type*> variable_types;
+
+		llvm::Value* read_variable_recursive(variable var, llvm::BasicBlock* block);
+		llvm::Value* add_phi_operands(variable var, llvm::PHINode* phi);
+		llvm::Value* try_remove_trivial_phi(llvm::PHINode* phi);
+
+		llvm::PHINode* create_phi(variable var, llvm::BasicBlock* block);
+	public:
+		void write_variable(variable var, llvm::BasicBlock* block, llvm::Value* value);
+		llvm::Value* read_variable(variable var, llvm::BasicBlock* block);
+
+		void seal_block(llvm::BasicBlock* block);
+		bool is_sealed(llvm::BasicBlock* block) const;
+
+		// forget everything about the previous function
+		void reset();
+	};
+}
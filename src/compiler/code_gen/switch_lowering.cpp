@@ -0,0 +1,389 @@
+#include "switch_lowering.h"
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+
+using namespace seam::compiler;
+
+namespace
+{
+	bool less(const llvm::APInt& left, const llvm::APInt& right, bool is_signed)
+	{
+		return is_signed ? left.slt(right) : left.ult(right);
+	}
+
+	// distance between two sorted case values, std::nullopt if it doesn't fit in 63 bits
+	std::optional<std::uint64_t> distance(const llvm::APInt& first, const llvm::APInt& last)
+	{
+		const auto diff = last - first;
+		if (diff.getActiveBits() > 63)
+		{
+			return std::nullopt;
+		}
+		return diff.getZExtValue();
+	}
+}
+
+llvm::BasicBlock* code_gen::switch_lowering::create_block(const char* name)
+{
+	auto block = llvm::BasicBlock::Create(mod.getContext(), name, builder.GetInsertBlock()->getParent(), insert_before);
+	created.push_back(block);
+	return block;
+}
+
+std::vector<code_gen::switch_lowering::cluster> code_gen::switch_lowering::build_clusters(const std::vector<integer_case>& cases)
+{
+	std::vector<cluster> clusters;
+
+	for (std::size_t i = 0; i < cases.size();)
+	{
+		const auto& first = cases[i].value->getValue();
+
+		// longest run from here that is still dense enough for a table
+		std::size_t table_last = i;
+		const auto max_range = (cases.size() - i) * 100 / jump_table_min_density;
+		for (std::size_t j = i + 1; j < cases.size(); ++j)
+		{
+			const auto range = distance(first, cases[j].value->getValue());
+			if (!range || *range >= max_range)
+			{
+				break;
+			}
+
+			if (*range < (j - i + 1) * 100 / jump_table_min_density)
+			{
+				table_last = j;
+			}
+		}
+
+		if (table_last - i + 1 >= jump_table_min_cases)
+		{
+			clusters.push_back({ cluster::kind::jump_table, i, table_last });
+			i = table_last + 1;
+			continue;
+		}
+
+		// longest run from here that fits in a machine word and only goes to a few places
+		std::size_t bits_last = i;
+		llvm::SmallPtrSet<llvm::BasicBlock*, 4> destinations;
+		destinations.insert(cases[i].dest);
+		for (std::size_t j = i + 1; j < cases.size(); ++j)
+		{
+			const auto range = distance(first, cases[j].value->getValue());
+			if (!range || *range >= bit_test_max_range)
+			{
+				break;
+			}
+
+			destinations.insert(cases[j].dest);
+			if (destinations.size() > bit_test_max_destinations)
+			{
+				break;
+			}
+			bits_last = j;
+		}
+
+		if (bits_last - i + 1 >= bit_test_min_cases)
+		{
+			clusters.push_back({ cluster::kind::bit_test, i, bits_last });
+			i = bits_last + 1;
+			continue;
+		}
+
+		clusters.push_back({ cluster::kind::single, i, i });
+		++i;
+	}
+
+	return clusters;
+}
+
+void code_gen::switch_lowering::emit_tree(llvm::Value* value, const std::vector<integer_case>& cases, const std::vector<cluster>& clusters,
+	std::size_t first, std::size_t last, llvm::BasicBlock* default_dest, bool is_signed)
+{
+	if (first == last)
+	{
+		emit_cluster(value, cases, clusters[first], default_dest);
+		return;
+	}
+
+	const auto mid = first + (last - first + 1) / 2;
+	auto pivot = cases[clusters[mid].first].value;
+
+	auto left = create_block("switch.left");
+	auto right = create_block("switch.right");
+	builder.CreateCondBr(is_signed ? builder.CreateICmpSLT(value, pivot) : builder.CreateICmpULT(value, pivot), left, right);
+
+	builder.SetInsertPoint(left);
+	emit_tree(value, cases, clusters, first, mid - 1, default_dest, is_signed);
+
+	builder.SetInsertPoint(right);
+	emit_tree(value, cases, clusters, mid, last, default_dest, is_signed);
+}
+
+void code_gen::switch_lowering::emit_cluster(llvm::Value* value, const std::vector<integer_case>& cases, const cluster& clus, llvm::BasicBlock* default_dest)
+{
+	switch (clus.type)
+	{
+		case cluster::kind::single:
+		{
+			builder.CreateCondBr(builder.CreateICmpEQ(value, cases[clus.first].value), cases[clus.first].dest, default_dest);
+			break;
+		}
+		case cluster::kind::jump_table:
+		{
+			// dense enough that the backend turns it into a table
+			auto switch_inst = builder.CreateSwitch(value, default_dest, static_cast<unsigned>(clus.last - clus.first + 1));
+			for (auto i = clus.first; i <= clus.last; ++i)
+			{
+				switch_inst->addCase(cases[i].value, cases[i].dest);
+			}
+			break;
+		}
+		case cluster::kind::bit_test:
+		{
+			const auto& low = cases[clus.first].value->getValue();
+			const auto range = *distance(low, cases[clus.last].value->getValue());
+
+			auto offset = builder.CreateSub(value, cases[clus.first].value);
+			auto test_block = create_block("switch.bits");
+			builder.CreateCondBr(builder.CreateICmpULE(offset, llvm::ConstantInt::get(value->getType(), range)), test_block, default_dest);
+			builder.SetInsertPoint(test_block);
+
+			auto word_type = builder.getInt64Ty();
+			auto bit = builder.CreateShl(llvm::ConstantInt::get(word_type, 1), builder.CreateZExtOrTrunc(offset, word_type));
+
+			// one mask per destination, in the order they first show up
+			llvm::MapVector<llvm::BasicBlock*, std::uint64_t> masks;
+			for (auto i = clus.first; i <= clus.last; ++i)
+			{
+				masks[cases[i].dest] |= std::uint64_t{ 1 } << *distance(low, cases[i].value->getValue());
+			}
+
+			for (std::size_t i = 0; i < masks.size(); ++i)
+			{
+				auto& [dest, mask] = *(masks.begin() + i);
+				auto next = i + 1 == masks.size() ? default_dest : create_block("switch.bits");
+
+				auto hit = builder.CreateICmpNE(builder.CreateAnd(bit, llvm::ConstantInt::get(word_type, mask)), llvm::ConstantInt::get(word_type, 0));
+				builder.CreateCondBr(hit, dest, next);
+
+				if (next != default_dest)
+				{
+					builder.SetInsertPoint(next);
+				}
+			}
+			break;
+		}
+	}
+}
+
+void code_gen::switch_lowering::lower(llvm::Value* value, std::vector<integer_case> cases, llvm::BasicBlock* default_dest, bool is_signed)
+{
+	if (cases.empty())
+	{
+		builder.CreateBr(default_dest);
+		return;
+	}
+
+	std::sort(cases.begin(), cases.end(), [is_signed](const integer_case& left, const integer_case& right)
+		{
+			return less(left.value->getValue(), right.value->getValue(), is_signed);
+		});
+
+	const auto clusters = build_clusters(cases);
+	emit_tree(value, cases, clusters, 0, clusters.size() - 1, default_dest, is_signed);
+}
+
+llvm::Function* code_gen::switch_lowering::get_string_equals()
+{
+	constexpr auto name = "seam.string_equals";
+	if (auto function = mod.getFunction(name))
+	{
+		return function;
+	}
+
+	auto& context = mod.getContext();
+	auto byte_ptr_type = llvm::Type::getInt8PtrTy(context);
+	auto size_type = llvm::Type::getInt64Ty(context);
+
+	auto function_type = llvm::FunctionType::get(llvm::Type::getInt1Ty(context), { byte_ptr_type, byte_ptr_type, size_type }, false);
+	auto function = llvm::Function::Create(function_type, llvm::GlobalValue::InternalLinkage, name, mod);
+	function->addFnAttr(llvm::Attribute::ReadOnly);
+	function->addFnAttr(llvm::Attribute::NoUnwind);
+
+	auto left = function->getArg(0);
+	auto right = function->getArg(1);
+	auto size = function->getArg(2);
+
+	auto entry = llvm::BasicBlock::Create(context, "entry", function);
+	auto loop = llvm::BasicBlock::Create(context, "loop", function);
+	auto body = llvm::BasicBlock::Create(context, "body", function);
+	auto equal = llvm::BasicBlock::Create(context, "equal", function);
+	auto differ = llvm::BasicBlock::Create(context, "differ", function);
+
+	llvm::IRBuilder<> function_builder{ entry };
+	function_builder.CreateBr(loop);
+
+	function_builder.SetInsertPoint(loop);
+	auto index = function_builder.CreatePHI(size_type, 2, "i");
+	index->addIncoming(llvm::ConstantInt::get(size_type, 0), entry);
+	function_builder.CreateCondBr(function_builder.CreateICmpEQ(index, size), equal, body);
+
+	function_builder.SetInsertPoint(body);
+	auto left_byte = function_builder.CreateLoad(function_builder.getInt8Ty(), function_builder.CreateInBoundsGEP(function_builder.getInt8Ty(), left, index));
+	auto right_byte = function_builder.CreateLoad(function_builder.getInt8Ty(), function_builder.CreateInBoundsGEP(function_builder.getInt8Ty(), right, index));
+	index->addIncoming(function_builder.CreateAdd(index, llvm::ConstantInt::get(size_type, 1)), body);
+	function_builder.CreateCondBr(function_builder.CreateICmpEQ(left_byte, right_byte), loop, differ);
+
+	function_builder.SetInsertPoint(equal);
+	function_builder.CreateRet(function_builder.getTrue());
+
+	function_builder.SetInsertPoint(differ);
+	function_builder.CreateRet(function_builder.getFalse());
+
+	return function;
+}
+
+void code_gen::switch_lowering::emit_string_compare(llvm::Value* data, const string_case& string_case, llvm::BasicBlock* default_dest)
+{
+	// the length already matched
+	if (string_case.value.empty())
+	{
+		builder.CreateBr(string_case.dest);
+		return;
+	}
+
+	auto equal = builder.CreateCall(get_string_equals(), { data, string_case.data, builder.getInt64(string_case.value.size()) });
+	builder.CreateCondBr(equal, string_case.dest, default_dest);
+}
+
+void code_gen::switch_lowering::emit_string_bucket(llvm::Value* data, std::size_t length, const std::vector<string_case>& cases, llvm::BasicBlock* default_dest)
+{
+	if (cases.size() == 1)
+	{
+		emit_string_compare(data, cases.front(), default_dest);
+		return;
+	}
+
+	// every string here has the same length, so any position can be read.
+	// greedily pick the positions that tell the most labels apart until each has its own key
+	std::vector<std::size_t> positions;
+	const auto key_of = [&positions](const std::string& value)
+	{
+		std::uint64_t key = 0;
+		for (std::size_t i = 0; i < positions.size(); ++i)
+		{
+			key |= std::uint64_t{ static_cast<std::uint8_t>(value[positions[i]]) } << (8 * i);
+		}
+		return key;
+	};
+
+	const auto distinct_keys = [&]()
+	{
+		std::set<std::uint64_t> keys;
+		for (auto& string_case : cases)
+		{
+			keys.insert(key_of(string_case.value));
+		}
+		return keys.size();
+	};
+
+	auto distinct = distinct_keys();
+	while (distinct < cases.size() && positions.size() < max_hash_positions)
+	{
+		auto best_position = length;
+		auto best_distinct = distinct;
+		for (std::size_t position = 0; position < length; ++position)
+		{
+			if (std::find(positions.cbegin(), positions.cend(), position) != positions.cend())
+			{
+				continue;
+			}
+
+			positions.push_back(position);
+			if (const auto count = distinct_keys(); count > best_distinct)
+			{
+				best_position = position;
+				best_distinct = count;
+			}
+			positions.pop_back();
+		}
+
+		// any two different strings of the same length differ somewhere, so this always makes progress
+		positions.push_back(best_position);
+		distinct = best_distinct;
+	}
+
+	if (distinct < cases.size())
+	{
+		// too many positions to pack, compare one after another
+		for (std::size_t i = 0; i < cases.size(); ++i)
+		{
+			auto next = i + 1 == cases.size() ? default_dest : create_block("switch.compare");
+			emit_string_compare(data, cases[i], next);
+
+			if (next != default_dest)
+			{
+				builder.SetInsertPoint(next);
+			}
+		}
+		return;
+	}
+
+	auto word_type = builder.getInt64Ty();
+	llvm::Value* key = nullptr;
+	for (std::size_t i = 0; i < positions.size(); ++i)
+	{
+		auto byte = builder.CreateLoad(builder.getInt8Ty(), builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), data, positions[i]));
+		auto part = builder.CreateZExt(byte, word_type);
+		key = key ? builder.CreateOr(key, builder.CreateShl(part, 8 * i)) : part;
+	}
+
+	std::vector<integer_case> key_cases;
+	std::vector<llvm::BasicBlock*> compare_blocks;
+	for (auto& string_case : cases)
+	{
+		compare_blocks.push_back(create_block("switch.compare"));
+		key_cases.push_back({ llvm::ConstantInt::get(word_type, key_of(string_case.value)), compare_blocks.back() });
+	}
+
+	lower(key, std::move(key_cases), default_dest, false);
+
+	for (std::size_t i = 0; i < cases.size(); ++i)
+	{
+		builder.SetInsertPoint(compare_blocks[i]);
+		emit_string_compare(data, cases[i], default_dest);
+	}
+}
+
+void code_gen::switch_lowering::lower(llvm::Value* data, llvm::Value* size, std::vector<string_case> cases, llvm::BasicBlock* default_dest)
+{
+	std::map<std::size_t, std::vector<string_case>> buckets;
+	for (auto& string_case : cases)
+	{
+		buckets[string_case.value.size()].push_back(std::move(string_case));
+	}
+
+	std::vector<integer_case> length_cases;
+	std::vector<llvm::BasicBlock*> bucket_blocks;
+	for (auto& [length, bucket] : buckets)
+	{
+		bucket_blocks.push_back(create_block("switch.length"));
+		length_cases.push_back({ llvm::ConstantInt::get(llvm::cast<llvm::IntegerType>(size->getType()), length), bucket_blocks.back() });
+	}
+
+	lower(size, std::move(length_cases), default_dest, false);
+
+	std::size_t i = 0;
+	for (auto& [length, bucket] : buckets)
+	{
+		builder.SetInsertPoint(bucket_blocks[i++]);
+		emit_string_bucket(data, length, bucket, default_dest);
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace seam::compiler::code_gen
+{
+	// turns a switch into dispatch code that runs in constant or logarithmic time.
+	// integer cases are split into clusters: dense runs become an llvm switch (a jump table in the backend),
+	// small ranges with few targets become bit tests and lone cases a compare, a balanced binary search picks the cluster.
+	// string cases dispatch on the length and then on a perfect hash made from the bytes at a few positions,
+	// so only a single candidate is compared in full
+	class switch_lowering
+	{
+	public:
+		struct integer_case
+		{
+			llvm::ConstantInt* value;
+			llvm::BasicBlock* dest;
+		};
+
+		struct string_case
+		{
+			std::string value;
+			llvm::Constant* data; // the bytes of the label, from the module's string pool
+			llvm::BasicBlock* dest;
+		};
+	private:
+		// a run of cases (by index into the sorted cases) that is dispatched in one go
+		struct cluster
+		{
+			enum class kind
+			{
+				single,
+				jump_table,
+				bit_test,
+			};
+
+			kind type;
+			std::size_t first, last;
+		};
+
+		// a run of cases has to fill at least this much of its range (in percent) to become a jump table
+		constexpr static std::size_t jump_table_min_density = 40;
+		constexpr static std::size_t jump_table_min_cases = 4;
+		constexpr static std::size_t bit_test_max_destinations = 3;
+		constexpr static std::size_t bit_test_min_cases = 3;
+		constexpr static std::size_t bit_test_max_range = 64;
+		// strings of the same length are told apart by packing up to this many of their bytes into an i64
+		constexpr static std::size_t max_hash_positions = 8;
+
+		llvm::IRBuilder<>& builder;
+		llvm::Module& mod;
+		llvm::BasicBlock* insert_before; // dispatch blocks go right after the block holding the switch
+
+		std::vector<llvm::BasicBlock*> created;
+
+		llvm::BasicBlock* create_block(const char* name);
+
+		std::vector<cluster> build_clusters(const std::vector<integer_case>& cases);
+		void emit_tree(llvm::Value* value, const std::vector<integer_case>& cases, const std::vector<cluster>& clusters,
+			std::size_t first, std::size_t last, llvm::BasicBlock* default_dest, bool is_signed);
+		void emit_cluster(llvm::Value* value, const std::vector<integer_case>& cases, const cluster& clus, llvm::BasicBlock* default_dest);
+
+		void emit_string_bucket(llvm::Value* data, std::size_t length, const std::vector<string_case>& cases, llvm::BasicBlock* default_dest);
+		void emit_string_compare(llvm::Value* data, const string_case& string_case, llvm::BasicBlock* default_dest);
+		llvm::Function* get_string_equals();
+	public:
+		switch_lowering(llvm::IRBuilder<>& builder, llvm::Module& mod) :
+			builder(builder), mod(mod), insert_before(builder.GetInsertBlock()->getNextNode()) {}
+
+		// both terminate the builder's current block
+		void lower(llvm::Value* value, std::vector<integer_case> cases, llvm::BasicBlock* default_dest, bool is_signed);
+		void lower(llvm::Value* data, llvm::Value* size, std::vector<string_case> cases, llvm::BasicBlock* default_dest);
+
+		// blocks added for the dispatch, all of their predecessors are known once lowering is done
+		const std::vector<llvm::BasicBlock*>& blocks() const { return created; }
+	};
+}
@@ -0,0 +1,236 @@
+#include "target_clones.h"
+
+#include "../utils/exception.h"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/IR/GlobalIFunc.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <algorithm>
+
+using namespace seam::compiler;
+
+// bits from the intel sdm, the avx family also needs the ymm (0x6) or ymm and zmm (0xe6) state enabled in xcr0
+const code_gen::target_clones::cpu_feature code_gen::target_clones::cpu_features[] =
+{
+	{ "sse4.2", cpu_feature::source::leaf1_ecx, 20, 0 },
+	{ "popcnt", cpu_feature::source::leaf1_ecx, 23, 0 },
+	{ "fma", cpu_feature::source::leaf1_ecx, 12, 0x6 },
+	{ "avx", cpu_feature::source::leaf1_ecx, 28, 0x6 },
+	{ "f16c", cpu_feature::source::leaf1_ecx, 29, 0x6 },
+	{ "bmi", cpu_feature::source::leaf7_ebx, 3, 0 },
+	{ "avx2", cpu_feature::source::leaf7_ebx, 5, 0x6 },
+	{ "bmi2", cpu_feature::source::leaf7_ebx, 8, 0 },
+	{ "avx512f", cpu_feature::source::leaf7_ebx, 16, 0xe6 },
+	{ "avx512dq", cpu_feature::source::leaf7_ebx, 17, 0xe6 },
+	{ "avx512bw", cpu_feature::source::leaf7_ebx, 30, 0xe6 },
+	{ "avx512vl", cpu_feature::source::leaf7_ebx, 31, 0xe6 },
+};
+
+std::vector<code_gen::target_clones::clone> code_gen::target_clones::parse_targets(const std::vector<std::string>& targets, position pos)
+{
+	if (!llvm::Triple{ mod.getTargetTriple() }.isX86())
+	{
+		throw exception(pos, "@target_clones needs an x86 target");
+	}
+
+	std::vector<clone> clones;
+	for (const auto& target : targets)
+	{
+		if (std::any_of(clones.cbegin(), clones.cend(), [&](const clone& other) { return other.target == target; }))
+		{
+			throw exception(pos, "target '" + target + "' is listed more than once in @target_clones");
+		}
+
+		clone target_clone{ target, {}, nullptr };
+		if (target != "default")
+		{
+			// "avx2+fma" needs both
+			llvm::SmallVector<llvm::StringRef, 4> names;
+			llvm::StringRef{ target }.split(names, '+');
+			for (auto name : names)
+			{
+				auto feature = std::find_if(std::begin(cpu_features), std::end(cpu_features), [&](const cpu_feature& f) { return name == f.name; });
+				if (feature == std::end(cpu_features))
+				{
+					throw exception(pos, "unknown cpu feature '" + name.str() + "' in @target_clones");
+				}
+				target_clone.features.push_back(feature);
+			}
+		}
+		clones.push_back(std::move(target_clone));
+	}
+
+	// the resolver falls back to it, so it goes last whatever its position in the list
+	auto default_clone = std::find_if(clones.begin(), clones.end(), [](const clone& c) { return c.features.empty(); });
+	if (default_clone == clones.end())
+	{
+		throw exception(pos, "@target_clones needs a \"default\" target");
+	}
+	std::rotate(default_clone, default_clone + 1, clones.end());
+
+	return clones;
+}
+
+llvm::Function* code_gen::target_clones::create_resolver(llvm::Function* function, const std::vector<clone>& clones)
+{
+	auto& context = mod.getContext();
+	auto i32 = llvm::Type::getInt32Ty(context);
+
+	auto resolver = llvm::Function::Create(llvm::FunctionType::get(function->getType(), false), llvm::GlobalValue::InternalLinkage,
+		function->getName() + ".resolver", mod);
+	resolver->addFnAttr(llvm::Attribute::NoUnwind);
+
+	auto entry = llvm::BasicBlock::Create(context, "entry", resolver);
+	auto read_xcr0 = llvm::BasicBlock::Create(context, "xgetbv", resolver);
+	auto select = llvm::BasicBlock::Create(context, "select", resolver);
+
+	llvm::IRBuilder<> builder{ entry };
+
+	auto cpuid = llvm::InlineAsm::get(llvm::FunctionType::get(llvm::StructType::get(context, { i32, i32, i32, i32 }), { i32, i32 }, false),
+		"cpuid", "={ax},={bx},={cx},={dx},{ax},{cx},~{dirflag},~{fpsr},~{flags}", false);
+	auto xgetbv = llvm::InlineAsm::get(llvm::FunctionType::get(llvm::StructType::get(context, { i32, i32 }), { i32 }, false),
+		"xgetbv", "={ax},={dx},{cx},~{dirflag},~{fpsr},~{flags}", false);
+
+	auto max_leaf = builder.CreateExtractValue(builder.CreateCall(cpuid, { builder.getInt32(0), builder.getInt32(0) }), 0);
+	auto leaf1_ecx = builder.CreateExtractValue(builder.CreateCall(cpuid, { builder.getInt32(1), builder.getInt32(0) }), 2);
+
+	// asking for a leaf past the highest one returns the highest, so it has to be thrown away
+	auto leaf7_ebx = builder.CreateExtractValue(builder.CreateCall(cpuid, { builder.getInt32(7), builder.getInt32(0) }), 1);
+	leaf7_ebx = builder.CreateSelect(builder.CreateICmpUGE(max_leaf, builder.getInt32(7)), leaf7_ebx, builder.getInt32(0));
+
+	// xgetbv faults unless the os has turned on osxsave
+	auto osxsave = builder.CreateICmpNE(builder.CreateAnd(leaf1_ecx, 1u << 27), builder.getInt32(0));
+	builder.CreateCondBr(osxsave, read_xcr0, select);
+
+	builder.SetInsertPoint(read_xcr0);
+	auto xcr0_value = builder.CreateExtractValue(builder.CreateCall(xgetbv, { builder.getInt32(0) }), 0);
+	builder.CreateBr(select);
+
+	builder.SetInsertPoint(select);
+	auto xcr0 = builder.CreatePHI(i32, 2);
+	xcr0->addIncoming(builder.getInt32(0), entry);
+	xcr0->addIncoming(xcr0_value, read_xcr0);
+
+	// the default clone is last, every other one is picked over the ones after it when the cpu has all of its features
+	llvm::Value* result = clones.back().function;
+	for (auto it = std::next(clones.rbegin()); it != clones.rend(); ++it)
+	{
+		llvm::Value* supported = builder.getTrue();
+		for (auto feature : it->features)
+		{
+			auto bits = feature->src == cpu_feature::source::leaf1_ecx ? leaf1_ecx : leaf7_ebx;
+			supported = builder.CreateAnd(supported, builder.CreateICmpNE(builder.CreateAnd(bits, 1u << feature->bit), builder.getInt32(0)));
+
+			if (feature->xcr0_mask != 0)
+			{
+				auto mask = builder.getInt32(feature->xcr0_mask);
+				supported = builder.CreateAnd(supported, builder.CreateICmpEQ(builder.CreateAnd(xcr0, mask), mask));
+			}
+		}
+		result = builder.CreateSelect(supported, it->function, result);
+	}
+	builder.CreateRet(result);
+
+	return resolver;
+}
+
+void code_gen::target_clones::create_dispatch_pointer(llvm::Function* function, llvm::Function* resolver)
+{
+	auto& context = mod.getContext();
+	const auto pointer_alignment = mod.getDataLayout().getPointerABIAlignment(0);
+
+	// both write to the dispatch pointer one way or another, whatever the clones promise about memory doesn't hold for them
+	function->removeFnAttr(llvm::Attribute::ReadNone);
+	function->removeFnAttr(llvm::Attribute::ReadOnly);
+
+	auto first_call = llvm::Function::Create(function->getFunctionType(), llvm::GlobalValue::InternalLinkage, function->getName() + ".first_call", mod);
+	first_call->setAttributes(function->getAttributes());
+	first_call->setCallingConv(function->getCallingConv());
+
+	auto dispatch = new llvm::GlobalVariable(mod, function->getType(), false, llvm::GlobalValue::InternalLinkage, first_call, function->getName() + ".dispatch");
+	dispatch->setAlignment(pointer_alignment);
+
+	std::vector<llvm::Value*> arguments;
+
+	// calls through the pointer forward their arguments untouched, so the call can reuse the frame
+	auto forward = [&](llvm::IRBuilder<>& builder, llvm::Function* from, llvm::Value* target)
+	{
+		arguments.clear();
+		for (auto& arg : from->args())
+		{
+			arguments.push_back(&arg);
+		}
+
+		auto call = builder.CreateCall(function->getFunctionType(), target, arguments);
+		call->setCallingConv(function->getCallingConv());
+		call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+		if (call->getType()->isVoidTy())
+		{
+			builder.CreateRetVoid();
+		}
+		else
+		{
+			builder.CreateRet(call);
+		}
+	};
+
+	// threads racing through here all store the same clone
+	{
+		llvm::IRBuilder<> builder{ llvm::BasicBlock::Create(context, "entry", first_call) };
+		auto target = builder.CreateCall(resolver);
+		builder.CreateAlignedStore(target, dispatch, pointer_alignment)->setAtomic(llvm::AtomicOrdering::Monotonic);
+		forward(builder, first_call, target);
+	}
+
+	{
+		llvm::IRBuilder<> builder{ llvm::BasicBlock::Create(context, "entry", function) };
+		auto target = builder.CreateAlignedLoad(function->getType(), dispatch, pointer_alignment);
+		target->setAtomic(llvm::AtomicOrdering::Monotonic);
+		forward(builder, function, target);
+	}
+}
+
+void code_gen::target_clones::emit(llvm::Function* function, const std::vector<std::string>& targets, position pos)
+{
+	auto clones = parse_targets(targets, pos);
+
+	for (auto& target_clone : clones)
+	{
+		llvm::ValueToValueMapTy value_map;
+		target_clone.function = llvm::CloneFunction(function, value_map);
+		target_clone.function->setName(function->getName() + "." + target_clone.target);
+		target_clone.function->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+		if (!target_clone.features.empty())
+		{
+			std::vector<std::string> features;
+			for (auto feature : target_clone.features)
+			{
+				features.push_back(std::string{ "+" } + feature->name);
+			}
+			target_clone.function->addFnAttr("target-features", llvm::join(features, ","));
+		}
+	}
+
+	auto resolver = create_resolver(function, clones);
+
+	// deleting the body turns it into a declaration, which is always external
+	const auto linkage = function->getLinkage();
+	function->deleteBody();
+	function->setLinkage(linkage);
+
+	if (llvm::Triple{ mod.getTargetTriple() }.isOSBinFormatELF())
+	{
+		// the dynamic loader runs the resolver once and binds every call straight to the clone
+		auto ifunc = llvm::GlobalIFunc::create(function->getFunctionType(), function->getAddressSpace(), linkage, "", resolver, &mod);
+		ifunc->takeName(function);
+		function->replaceAllUsesWith(ifunc);
+		function->eraseFromParent();
+		return;
+	}
+
+	create_dispatch_pointer(function, resolver);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+
+#include <string>
+#include <vector>
+
+#include "../utils/position.h"
+
+namespace seam::compiler::code_gen
+{
+	// function multiversioning for @target_clones("avx512f", "avx2+fma", "default").
+	// the body is cloned once per target with matching target-features and a resolver picks the first clone
+	// the cpu supports, testing cpuid itself so it can run before anything else in the process is set up.
+	// on elf the function becomes an ifunc, elsewhere calls go through a pointer that the first call fills in
+	class target_clones
+	{
+		struct cpu_feature
+		{
+			enum class source
+			{
+				leaf1_ecx,
+				leaf7_ebx,
+			};
+
+			const char* name;
+			source src;
+			unsigned bit;
+			std::uint32_t xcr0_mask; // register state the os has to save for the feature to be usable
+		};
+
+		struct clone
+		{
+			std::string target;
+			std::vector<const cpu_feature*> features; // empty for the default clone
+			llvm::Function* function;
+		};
+
+		static const cpu_feature cpu_features[];
+
+		llvm::Module& mod;
+
+		std::vector<clone> parse_targets(const std::vector<std::string>& targets, position pos);
+		llvm::Function* create_resolver(llvm::Function* function, const std::vector<clone>& clones);
+		void create_dispatch_pointer(llvm::Function* function, llvm::Function* resolver);
+	public:
+		explicit target_clones(llvm::Module& mod) :
+			mod(mod) {}
+
+		// the function has to have its body, every use of it ends up at the dispatch
+		void emit(llvm::Function* function, const std::vector<std::string>& targets, position pos);
+	};
+}
@@ -72,6 +72,45 @@ void seam::compiler::compiler::compile_bitcode(const llvm::StringRef& bc_file, c
 	}
 }
 
+static llvm::SmallVector<char, 0> write_bitcode(const llvm::Module& module)
+{
+	llvm::SmallVector<char, 0> buffer;
+	llvm::raw_svector_ostream stream{ buffer };
+	llvm::WriteBitcodeToFile(module, stream);
+
+	return buffer;
+}
+
+llvm::Expected<std::shared_ptr<llvm::Module>> compiler::gen_module(llvm::LLVMContext& module_context, std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& module_types,
+	const std::string& module_name, std::string_view source, bool print_layout, bool print_range_remarks)
+{
+	parser::parser parser{ module_name, source };
+	auto module_block = parser.parse();
+	if (!module_block)
+	{
+		return module_block.takeError();
+	}
+
+	ir::ast::module ast_module{ module_name, std::move(*module_block), true };
+
+	llvm::Triple target_triple{ llvm::sys::getDefaultTargetTriple() };
+
+	code_gen::code_gen gen{ module_types, module_context, ast_module, target_triple.getTriple(), opt.fast_math };
+	auto llvm_module = gen.gen_code();
+
+	if (print_layout)
+	{
+		gen.print_layouts(llvm::outs());
+	}
+
+	// remarks are diagnostics like errors and warnings, they don't go into the ir printed on stdout
+	if (print_range_remarks)
+	{
+		gen.print_range_remarks(llvm::errs());
+	}
+	return llvm_module;
+}
+
 compiler::compiler(const char* argv0, compiler_options opt) :
 	argv0(argv0), opt(std::move(opt))
 {
@@ -102,27 +141,40 @@ llvm::Error compiler::compile()
 	std::ifstream root_module_file{ opt.input_file_path, std::ios::binary | std::ios::in };
 	std::string root_module_source{ std::istreambuf_iterator{ root_module_file }, {} };
 
-	parser::parser parser{ input_filename, root_module_source };
-	auto root_module_block = parser.parse();
-	if (!root_module_block)
+	auto generated_root_module = gen_module(context, types, input_filename, root_module_source, opt.print_layout, opt.print_range_remarks);
+	if (!generated_root_module)
 	{
-		return root_module_block.takeError();
+		return generated_root_module.takeError();
 	}
 
-	ir::ast::module root_module{ input_filename, std::move(*root_module_block), true };
+	auto llvm_root_module = std::move(*generated_root_module);
 
-	llvm::Triple target_triple{ llvm::sys::getDefaultTargetTriple() };
-	
-	code_gen::code_gen gen{ types, context, root_module, target_triple.getTriple() };
-	auto llvm_root_module = gen.gen_code();
+	if (opt.verify_determinism)
+	{
+		// compile again from scratch in a fresh context, any difference in the bitcode means
+		// something in the pipeline depends on hashing or pointer order
+		llvm::LLVMContext check_context;
+		std::unordered_map<ir::types::type_descriptor*, llvm::Type*> check_types;
+
+		auto check_module = gen_module(check_context, check_types, input_filename, root_module_source, false, false);
+		if (!check_module)
+		{
+			return check_module.takeError();
+		}
+
+		if (write_bitcode(*llvm_root_module) != write_bitcode(**check_module))
+		{
+			throw std::runtime_error("code generation is not deterministic, compiling '" + opt.input_file_path.string() + "' twice produced different bitcode");
+		}
+	}
 	
-	std::string constructor = root_module.relative_path + "@@constructor";
+	std::string constructor = input_filename + "@@constructor";
 	if (!llvm_root_module->getFunction(constructor))
 	{
 		throw std::runtime_error("main module must have constructor");
 	}
 
-	auto llvm_root_module_bitcode_path = (opt.output_directory_path / (root_module.relative_path + ".bc")).string();
+	auto llvm_root_module_bitcode_path = (opt.output_directory_path / (input_filename + ".bc")).string();
 	llvm::raw_fd_ostream llvm_root_module_bitcode{ llvm_root_module_bitcode_path, error_code };
 	if (error_code)
 	{
@@ -136,12 +188,12 @@ llvm::Error compiler::compile()
 	llvm::WriteBitcodeToFile(*llvm_root_module, llvm_root_module_bitcode);
 	llvm_root_module_bitcode.close();
 
-	auto llvm_root_module_object_path = (opt.output_directory_path / (root_module.relative_path + ".o")).string();
+	auto llvm_root_module_object_path = (opt.output_directory_path / (input_filename + ".o")).string();
 	compile_bitcode(llvm_root_module_bitcode_path, llvm_root_module_object_path);
 
 	if (!opt.no_link)
 	{
-		auto llvm_root_module_executable_path = (opt.output_directory_path / (root_module.relative_path + ".exe")).string();
+		auto llvm_root_module_executable_path = (opt.output_directory_path / (input_filename + ".exe")).string();
 		auto runtime_lib = std::filesystem::absolute(opt.output_directory_path / "seam-runtime.lib").string();
 		llvm::outs() << runtime_lib << '\n';
 		link({ llvm_root_module_object_path, runtime_lib }, constructor, llvm_root_module_executable_path);
@@ -3,19 +3,26 @@
 #include "ir/ast/types.h"
 
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/Error.h>
 
 #include <filesystem>
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 
 namespace seam::compiler
 {
 	struct compiler_options
 	{
 		bool no_link;
+		bool verify_determinism;
+		bool print_layout;
+		bool fast_math;
+		bool print_range_remarks;
 		std::filesystem::path output_directory_path;
 		std::filesystem::path input_file_path;
 	};
@@ -29,6 +36,8 @@ namespace seam::compiler
 		std::unordered_map<ir::types::type_descriptor*, llvm::Type*> types;
 		llvm::LLVMContext context;
 
+		llvm::Expected<std::shared_ptr<llvm::Module>> gen_module(llvm::LLVMContext& module_context, std::unordered_map<ir::types::type_descriptor*, llvm::Type*>& module_types,
+			const std::string& module_name, std::string_view source, bool print_layout, bool print_range_remarks);
 		void link(const std::vector<llvm::StringRef>& object_files, const llvm::StringRef& entry, const llvm::StringRef& output);
 		void compile_bitcode(const llvm::StringRef& bc_file, const llvm::StringRef& output);
 	public:
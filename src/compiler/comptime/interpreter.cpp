@@ -0,0 +1,638 @@
+#include "interpreter.h"
+
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+using namespace seam::compiler;
+
+namespace seam::compiler::comptime
+{
+	template <typename T>
+	std::optional<value> compare(ir::ast::binary_operator op, T left, T right)
+	{
+		switch (op)
+		{
+			case ir::ast::binary_operator::equal: return value{ left == right };
+			case ir::ast::binary_operator::not_equal: return value{ left != right };
+			case ir::ast::binary_operator::less: return value{ left < right };
+			case ir::ast::binary_operator::less_equal: return value{ left <= right };
+			case ir::ast::binary_operator::greater: return value{ left > right };
+			case ir::ast::binary_operator::greater_equal: return value{ left >= right };
+			default: return std::nullopt;
+		}
+	}
+
+	std::optional<value> apply(ir::ast::binary_operator op, const value& left, const value& right)
+	{
+		return std::visit([op](auto&& left_val, auto&& right_val) -> std::optional<value>
+			{
+				using T = std::decay_t<decltype(left_val)>;
+				if constexpr (!std::is_same_v<T, std::decay_t<decltype(right_val)>> || !std::is_arithmetic_v<T>)
+				{
+					return std::nullopt;
+				}
+				else if (ir::ast::is_comparison(op))
+				{
+					return compare<T>(op, left_val, right_val);
+				}
+				else if constexpr (std::is_same_v<T, bool>)
+				{
+					return std::nullopt;
+				}
+				else if constexpr (std::is_floating_point_v<T>)
+				{
+					switch (op)
+					{
+						case ir::ast::binary_operator::add: return value{ static_cast<T>(left_val + right_val) };
+						case ir::ast::binary_operator::subtract: return value{ static_cast<T>(left_val - right_val) };
+						case ir::ast::binary_operator::multiply: return value{ static_cast<T>(left_val * right_val) };
+						case ir::ast::binary_operator::divide: return value{ static_cast<T>(left_val / right_val) };
+						default: return std::nullopt;
+					}
+				}
+				else
+				{
+					// done in 64 bit unsigned so it wraps instead of overflowing after promotion
+					const auto left_bits = static_cast<std::uint64_t>(left_val);
+					const auto right_bits = static_cast<std::uint64_t>(right_val);
+					switch (op)
+					{
+						case ir::ast::binary_operator::add: return value{ static_cast<T>(left_bits + right_bits) };
+						case ir::ast::binary_operator::subtract: return value{ static_cast<T>(left_bits - right_bits) };
+						case ir::ast::binary_operator::multiply: return value{ static_cast<T>(left_bits * right_bits) };
+						case ir::ast::binary_operator::divide:
+						{
+							if (right_val == 0)
+							{
+								return std::nullopt;
+							}
+
+							if constexpr (std::is_signed_v<T>)
+							{
+								if (left_val == std::numeric_limits<T>::min() && right_val == -1)
+								{
+									return std::nullopt;
+								}
+							}
+
+							return value{ static_cast<T>(left_val / right_val) };
+						}
+						default: return std::nullopt;
+					}
+				}
+			}, left, right);
+	}
+
+	std::optional<value> apply(ir::ast::unary_operator op, const value& operand)
+	{
+		return std::visit([op](auto&& operand_val) -> std::optional<value>
+			{
+				using T = std::decay_t<decltype(operand_val)>;
+				if constexpr (!std::is_arithmetic_v<T> || std::is_same_v<T, bool>)
+				{
+					return std::nullopt;
+				}
+				else if constexpr (std::is_floating_point_v<T>)
+				{
+					return value{ static_cast<T>(-operand_val) };
+				}
+				else
+				{
+					return value{ static_cast<T>(0 - static_cast<std::uint64_t>(operand_val)) };
+				}
+			}, operand);
+	}
+
+	struct literal_reader : ir::ast::visitor
+	{
+		std::optional<value> val;
+
+		bool visit(ir::ast::node* node) override
+		{
+			return false;
+		}
+
+		template <typename T>
+		bool visit_literal(ir::ast::expression::literal<T>* node)
+		{
+			val = node->val;
+			return false;
+		}
+
+		bool visit(ir::ast::expression::literal<std::string>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int8_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int16_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int32_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int64_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint8_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint16_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint32_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint64_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<float>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<double>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<bool>* node) override { return visit_literal(node); }
+	};
+
+	std::optional<value> literal_value(ir::ast::expression::expression* expr)
+	{
+		literal_reader reader;
+		expr->visit(&reader);
+		return std::move(reader.val);
+	}
+
+	std::unique_ptr<ir::ast::expression::expression> make_literal(const value& val, ir::ast::position_range range)
+	{
+		return std::visit([range](auto&& literal_val) -> std::unique_ptr<ir::ast::expression::expression>
+			{
+				using T = std::decay_t<decltype(literal_val)>;
+				if constexpr (std::is_same_v<T, std::monostate> || std::is_same_v<T, array_value>)
+				{
+					return nullptr;
+				}
+				else
+				{
+					return std::make_unique<ir::ast::expression::literal<T>>(range, literal_val);
+				}
+			}, val);
+	}
+
+	// thrown to unwind the evaluation once something non constant is hit
+	struct not_constant {};
+	// thrown once the fuel or depth limit is hit. says nothing about the call itself, only about this evaluation,
+	// so unlike not_constant it is never memoized
+	struct exhausted {};
+
+	struct evaluator : ir::ast::visitor
+	{
+		evaluator(interpreter& interp) :
+			interp(interp), fuel(interp.fuel_limit) {}
+
+		interpreter& interp;
+
+		std::size_t fuel;
+		std::size_t depth = 0;
+
+		value val;
+		bool returned = false;
+
+		// parameters and locals of every active call, innermost call last
+		std::vector<std::unordered_map<const ir::ast::var*, value>> frames;
+
+		value& local(const ir::ast::var* var)
+		{
+			if (frames.empty())
+			{
+				throw not_constant{};
+			}
+
+			auto it = frames.back().find(var);
+			if (it == frames.back().end())
+			{
+				throw not_constant{};
+			}
+			return it->second;
+		}
+
+		ir::ast::expression::local_variable* get_target(ir::ast::expression::expression* target)
+		{
+			auto target_var = dynamic_cast<ir::ast::expression::variable*>(target);
+			auto target_local = target_var ? dynamic_cast<ir::ast::expression::local_variable*>(target_var->var.get()) : nullptr;
+			if (!target_local)
+			{
+				throw not_constant{};
+			}
+			return target_local;
+		}
+
+		// a negative or out of bounds index throws at runtime, which isn't a constant
+		std::uint64_t get_index(const value& index, std::size_t length)
+		{
+			auto position = std::visit([](const auto& index_val) -> std::optional<std::uint64_t>
+				{
+					using T = std::decay_t<decltype(index_val)>;
+					if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+					{
+						return index_val < 0 ? std::nullopt : std::optional{ static_cast<std::uint64_t>(index_val) };
+					}
+					return std::nullopt;
+				}, index);
+
+			if (!position || *position >= length)
+			{
+				throw not_constant{};
+			}
+			return *position;
+		}
+
+		// a local or an element of one, m[i][j] in m[i][j] = x
+		value& get_place(ir::ast::expression::expression* target)
+		{
+			std::vector<ir::ast::expression::expression*> indices;
+			while (auto access = dynamic_cast<ir::ast::expression::index_access*>(target))
+			{
+				indices.push_back(access->index.get());
+				target = access->object.get();
+			}
+
+			// the indices go first, a call in one of them adds a frame
+			std::vector<value> positions;
+			for (auto it = indices.rbegin(); it != indices.rend(); ++it)
+			{
+				(*it)->visit(this);
+				positions.push_back(std::move(val));
+			}
+
+			auto current = &local(get_target(target)->def);
+			for (const auto& position : positions)
+			{
+				auto array = std::get_if<array_value>(current);
+				if (!array)
+				{
+					throw not_constant{};
+				}
+				current = &array->elements[get_index(position, array->elements.size())];
+			}
+			return *current;
+		}
+
+		void burn()
+		{
+			if (fuel-- == 0)
+			{
+				throw exhausted{};
+			}
+		}
+
+		bool visit(ir::ast::node* node) override
+		{
+			throw not_constant{};
+		}
+
+		template <typename T>
+		bool visit_literal(ir::ast::expression::literal<T>* node)
+		{
+			burn();
+			val = node->val;
+			return false;
+		}
+
+		bool visit(ir::ast::expression::literal<std::string>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int8_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int16_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int32_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::int64_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint8_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint16_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint32_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<std::uint64_t>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<float>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<double>* node) override { return visit_literal(node); }
+		bool visit(ir::ast::expression::literal<bool>* node) override { return visit_literal(node); }
+
+		bool visit(ir::ast::expression::binary* node) override
+		{
+			burn();
+
+			node->left->visit(this);
+			auto left = std::move(val);
+			node->right->visit(this);
+
+			auto result = comptime::apply(node->op, left, val);
+			if (!result)
+			{
+				throw not_constant{};
+			}
+
+			val = std::move(*result);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::unary* node) override
+		{
+			burn();
+
+			node->operand->visit(this);
+
+			auto result = comptime::apply(node->op, val);
+			if (!result)
+			{
+				throw not_constant{};
+			}
+
+			val = std::move(*result);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::array_literal* node) override
+		{
+			burn();
+
+			auto array = ir::types::as_array(node->type.get());
+			if (!array)
+			{
+				throw not_constant{};
+			}
+
+			array_value result;
+			for (auto& element : node->elements)
+			{
+				element->visit(this);
+				result.elements.push_back(std::move(val));
+			}
+
+			if (result.elements.size() == 1)
+			{
+				burn();
+				result.elements.resize(array->length, result.elements.front());
+			}
+			val = std::move(result);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::index_access* node) override
+		{
+			burn();
+
+			node->object->visit(this);
+			auto object = std::move(val);
+			node->index->visit(this);
+
+			auto array = std::get_if<array_value>(&object);
+			if (!array)
+			{
+				throw not_constant{};
+			}
+
+			val = std::move(array->elements[get_index(val, array->elements.size())]);
+			return false;
+		}
+
+		// len(a) of an array or a string, every other builtin is left to the generated code
+		void visit_builtin(ir::ast::expression::call* node, ir::ast::expression::builtin_function* builtin)
+		{
+			if (builtin->kind != ir::ast::builtin::len || node->arguments.size() != 1)
+			{
+				throw not_constant{};
+			}
+
+			node->arguments.front()->visit(this);
+			if (auto array = std::get_if<array_value>(&val))
+			{
+				val = static_cast<std::uint64_t>(array->elements.size());
+			}
+			else if (auto str = std::get_if<std::string>(&val))
+			{
+				val = static_cast<std::uint64_t>(str->size());
+			}
+			else
+			{
+				throw not_constant{};
+			}
+		}
+
+		bool visit(ir::ast::expression::call* node) override
+		{
+			burn();
+
+			auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get());
+			if (auto builtin = callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr)
+			{
+				visit_builtin(node, builtin);
+				return false;
+			}
+
+			auto callee = callee_var ? dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()) : nullptr;
+			auto func_def = callee ? dynamic_cast<ir::ast::statement::function_definition*>(callee->def_stat) : nullptr;
+			if (!func_def)
+			{
+				throw not_constant{};
+			}
+
+			std::vector<value> arguments;
+			arguments.reserve(node->arguments.size());
+			for (auto& arg : node->arguments)
+			{
+				arg->visit(this);
+				arguments.push_back(std::move(val));
+			}
+
+			auto key = std::make_pair(func_def, std::move(arguments));
+			if (auto it = interp.memo.find(key); it != interp.memo.cend())
+			{
+				if (!it->second)
+				{
+					throw not_constant{};
+				}
+
+				val = *it->second;
+				return false;
+			}
+
+			if (++depth > interp.depth_limit)
+			{
+				throw exhausted{};
+			}
+
+			auto& frame = frames.emplace_back();
+			for (std::size_t i = 0; i < func_def->arguments.size() && i < key.second.size(); ++i)
+			{
+				frame.emplace(&func_def->arguments[i], key.second[i]);
+			}
+
+			try
+			{
+				returned = false;
+				func_def->body_stat->visit(this);
+			}
+			catch (const not_constant&)
+			{
+				interp.memo.emplace(std::move(key), std::nullopt);
+				throw;
+			}
+
+			if (!returned)
+			{
+				val = std::monostate{};
+			}
+
+			returned = false;
+			frames.pop_back();
+			--depth;
+
+			interp.memo.emplace(std::move(key), val);
+			return false;
+		}
+
+		bool visit(ir::ast::expression::variable* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::expression::local_variable* node) override
+		{
+			burn();
+			val = local(node->def);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::variable_declaration* node) override
+		{
+			if (frames.empty())
+			{
+				throw not_constant{};
+			}
+
+			node->value->visit(this);
+			frames.back()[&node->variable] = std::move(val);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::variable_assignment* node) override
+		{
+			node->value->visit(this);
+			auto assigned = std::move(val);
+			get_place(node->target.get()) = std::move(assigned);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::compound_assignment* node) override
+		{
+			node->value->visit(this);
+			auto operand = std::move(val);
+
+			auto& current = get_place(node->target.get());
+			auto result = comptime::apply(node->op, current, operand);
+			if (!result)
+			{
+				throw not_constant{};
+			}
+
+			current = std::move(*result);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::block* node) override
+		{
+			for (auto& stat : node->body)
+			{
+				burn();
+				stat->visit(this);
+
+				if (returned)
+				{
+					break;
+				}
+			}
+
+			return false;
+		}
+
+		bool visit(ir::ast::statement::expression_statement* node) override
+		{
+			node->expr->visit(this);
+			return false;
+		}
+
+		bool condition(ir::ast::expression::expression* expr)
+		{
+			expr->visit(this);
+			if (auto result = std::get_if<bool>(&val))
+			{
+				return *result;
+			}
+			throw not_constant{};
+		}
+
+		bool visit(ir::ast::statement::if_statement* node) override
+		{
+			if (condition(node->condition.get()))
+			{
+				node->then_body->visit(this);
+			}
+			else if (node->else_body)
+			{
+				node->else_body->visit(this);
+			}
+			return false;
+		}
+
+		bool visit(ir::ast::statement::while_statement* node) override
+		{
+			// every iteration burns fuel, so loops that don't end give up instead of hanging the compiler
+			while (!returned && condition(node->condition.get()))
+			{
+				burn();
+				node->body->visit(this);
+			}
+			return false;
+		}
+
+		bool visit(ir::ast::statement::switch_statement* node) override
+		{
+			node->value->visit(this);
+			const auto switch_value = std::move(val);
+
+			for (auto& switch_case : node->cases)
+			{
+				for (auto& label : switch_case.labels)
+				{
+					burn();
+
+					auto label_value = literal_value(label.get());
+					if (!label_value)
+					{
+						throw not_constant{};
+					}
+
+					if (*label_value == switch_value)
+					{
+						switch_case.body->visit(this);
+						return false;
+					}
+				}
+			}
+
+			if (node->default_body)
+			{
+				node->default_body->visit(this);
+			}
+			return false;
+		}
+
+		bool visit(ir::ast::statement::ret* node) override
+		{
+			if (node->value)
+			{
+				node->value->visit(this);
+			}
+			else
+			{
+				val = std::monostate{};
+			}
+
+			returned = true;
+			return false;
+		}
+	};
+
+	std::optional<value> interpreter::evaluate(ir::ast::expression::call* call)
+	{
+		evaluator eval{ *this };
+
+		try
+		{
+			call->visit(&eval);
+		}
+		catch (const not_constant&)
+		{
+			return std::nullopt;
+		}
+		catch (const exhausted&)
+		{
+			return std::nullopt;
+		}
+
+		return std::move(eval.val);
+	}
+}
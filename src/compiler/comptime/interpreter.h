@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../ir/ast/ast.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace seam::compiler::comptime
+{
+	struct array_value;
+
+	// std::monostate is the result of a void function
+	using value = std::variant<std::monostate, bool, std::int8_t, std::int16_t, std::int32_t, std::int64_t,
+		std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t, float, double, std::string, array_value>;
+
+	// copied on assignment like any other value, a single element literal is already filled out to the length
+	struct array_value
+	{
+		std::vector<value> elements;
+	};
+
+	inline bool operator==(const array_value& left, const array_value& right) { return left.elements == right.elements; }
+	inline bool operator!=(const array_value& left, const array_value& right) { return left.elements != right.elements; }
+	inline bool operator<(const array_value& left, const array_value& right) { return left.elements < right.elements; }
+
+	// integer arithmetic wraps like the generated code does,
+	// std::nullopt if the operation has no defined result (division by zero) or the operands don't match
+	std::optional<value> apply(ir::ast::binary_operator op, const value& left, const value& right);
+	std::optional<value> apply(ir::ast::unary_operator op, const value& operand);
+
+	// std::nullopt if the expression isn't a typed literal
+	std::optional<value> literal_value(ir::ast::expression::expression* expr);
+	// std::monostate and arrays have no literal, returns nullptr
+	std::unique_ptr<ir::ast::expression::expression> make_literal(const value& val, ir::ast::position_range range);
+
+	// evaluates calls to seam functions at compile time by walking their ast,
+	// anything that touches the outside world (externs) makes the call non constant
+	class interpreter
+	{
+		friend struct evaluator;
+
+		// number of nodes a single top level evaluation may visit before giving up
+		std::size_t fuel_limit;
+		// maximum call depth, so runaway recursion can't overflow the compiler's stack
+		std::size_t depth_limit;
+
+		std::map<std::pair<ir::ast::statement::function_definition*, std::vector<value>>, std::optional<value>> memo;
+	public:
+		explicit interpreter(std::size_t fuel_limit = 100000, std::size_t depth_limit = 256) :
+			fuel_limit(fuel_limit), depth_limit(depth_limit) {}
+
+		// returns std::nullopt if the call can't be evaluated at compile time
+		std::optional<value> evaluate(ir::ast::expression::call* call);
+	};
+}
@@ -2,6 +2,47 @@
 
 namespace seam::compiler::ir::ast
 {
+	std::optional<builtin> find_builtin(const std::string& name)
+	{
+		static const std::unordered_map<std::string, builtin> builtins
+		{
+			{ "lane", builtin::lane },
+			{ "with_lane", builtin::with_lane },
+			{ "shuffle", builtin::shuffle },
+			{ "reduce_add", builtin::reduce_add },
+			{ "reduce_mul", builtin::reduce_mul },
+			{ "reduce_min", builtin::reduce_min },
+			{ "reduce_max", builtin::reduce_max },
+			{ "popcount", builtin::popcount },
+			{ "ctz", builtin::ctz },
+			{ "clz", builtin::clz },
+			{ "bswap", builtin::bswap },
+			{ "fshl", builtin::fshl },
+			{ "fshr", builtin::fshr },
+			{ "checked_add", builtin::checked_add },
+			{ "checked_sub", builtin::checked_sub },
+			{ "checked_mul", builtin::checked_mul },
+			{ "expect", builtin::expect },
+			{ "assume", builtin::assume },
+			{ "prefetch", builtin::prefetch },
+			{ "len", builtin::len },
+			{ "load", builtin::load },
+			{ "store", builtin::store },
+		};
+
+		if (auto it = builtins.find(name); it != builtins.cend())
+		{
+			return it->second;
+		}
+
+		// every vector type doubles as its constructor
+		if (types::make_vector_type(name))
+		{
+			return builtin::make_vector;
+		}
+		return std::nullopt;
+	}
+
 	void expression::call::visit_children(visitor* vst)
 	{
 		func->visit(vst);
@@ -20,11 +61,51 @@ namespace seam::compiler::ir::ast
 	}
 
 
+	void expression::binary::visit_children(visitor* vst)
+	{
+		left->visit(vst);
+		right->visit(vst);
+	}
+
+	void expression::binary::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void expression::unary::visit_children(visitor* vst)
+	{
+		operand->visit(vst);
+	}
+
+	void expression::unary::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
 	void expression::unresolved_variable::visit(visitor* vst)
 	{
 		vst->visit(this);
 	}
 
+	void expression::member_access::visit_children(visitor* vst)
+	{
+		object->visit(vst);
+	}
+
+	void expression::member_access::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
 	void expression::variable::visit_children(visitor* vst)
 	{
 		var->visit(vst);
@@ -38,10 +119,71 @@ namespace seam::compiler::ir::ast
 		}
 	}
 
+	void expression::local_variable::visit(visitor* vst)
+	{
+		vst->visit(this);
+	}
+
 	void expression::function_variable::visit(visitor* vst)
 	{
 		vst->visit(this);
 	}
+
+	void expression::builtin_function::visit(visitor* vst)
+	{
+		vst->visit(this);
+	}
+
+	void expression::index_access::visit_children(visitor* vst)
+	{
+		object->visit(vst);
+		index->visit(vst);
+	}
+
+	void expression::index_access::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void expression::slice_access::visit_children(visitor* vst)
+	{
+		object->visit(vst);
+		if (from)
+		{
+			from->visit(vst);
+		}
+		if (to)
+		{
+			to->visit(vst);
+		}
+	}
+
+	void expression::slice_access::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void expression::array_literal::visit_children(visitor* vst)
+	{
+		for (auto& element : elements)
+		{
+			element->visit(vst);
+		}
+	}
+
+	void expression::array_literal::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
 	
 
 	void statement::variable_declaration::visit_children(visitor* vst)
@@ -59,6 +201,7 @@ namespace seam::compiler::ir::ast
 
 	void statement::variable_assignment::visit_children(visitor* vst)
 	{
+		target->visit(vst);
 		value->visit(vst);
 	}
 
@@ -70,6 +213,20 @@ namespace seam::compiler::ir::ast
 		}
 	}
 
+	void statement::compound_assignment::visit_children(visitor* vst)
+	{
+		target->visit(vst);
+		value->visit(vst);
+	}
+
+	void statement::compound_assignment::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
 	void statement::expression_statement::visit_children(visitor* vst)
 	{
 		expr->visit(vst);
@@ -152,6 +309,91 @@ namespace seam::compiler::ir::ast
 		}
 	}
 
+	void statement::if_statement::visit_children(visitor* vst)
+	{
+		condition->visit(vst);
+		then_body->visit(vst);
+		if (else_body)
+		{
+			else_body->visit(vst);
+		}
+	}
+
+	void statement::if_statement::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void statement::while_statement::visit_children(visitor* vst)
+	{
+		condition->visit(vst);
+		body->visit(vst);
+	}
+
+	void statement::while_statement::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void statement::switch_statement::visit_children(visitor* vst)
+	{
+		value->visit(vst);
+		for (auto& switch_case : cases)
+		{
+			for (auto& label : switch_case.labels)
+			{
+				label->visit(vst);
+			}
+			switch_case.body->visit(vst);
+		}
+
+		if (default_body)
+		{
+			default_body->visit(vst);
+		}
+	}
+
+	void statement::switch_statement::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void statement::try_statement::visit_children(visitor* vst)
+	{
+		body->visit(vst);
+		catch_body->visit(vst);
+	}
+
+	void statement::try_statement::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
+	void statement::throw_statement::visit_children(visitor* vst)
+	{
+		value->visit(vst);
+	}
+
+	void statement::throw_statement::visit(visitor* vst)
+	{
+		if (vst->visit(this))
+		{
+			visit_children(vst);
+		}
+	}
+
 	void statement::ret::visit_children(visitor* vst)
 	{
 		if (value)
@@ -8,6 +8,7 @@
 #include <optional>
 #include <variant>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 
@@ -65,6 +66,55 @@ namespace seam::compiler::ir::ast
 	
 	using type_reference = std::variant<type, types::type_reference>;
 
+	// @name or @name(arg, ...), mapped to the arguments
+	using attribute_map = std::unordered_map<std::string, std::vector<std::string>>;
+
+	// functions the compiler implements itself, found after the functions of the module
+	enum class builtin
+	{
+		make_vector, // f32x4(x) puts x in every lane, f32x4(a, b, c, d) one value per lane
+		lane, // lane(v, i)
+		with_lane, // with_lane(v, i, x), v with lane i replaced
+		shuffle, // shuffle(a, b, i...), lanes picked from a followed by b with constant indices
+		reduce_add,
+		reduce_mul,
+		reduce_min,
+		reduce_max,
+
+		// integers of every width, the vector ones work on every lane
+		popcount, // bits set
+		ctz, // zeros below the lowest set bit, the width for 0
+		clz, // zeros above the highest set bit, the width for 0
+		bswap, // bytes in reverse order
+		fshl, // fshl(a, b, n), the upper half of a:b shifted left by n modulo the width, fshl(x, x, n) rotates
+		fshr, // fshr(a, b, n), the lower half of a:b shifted right by n modulo the width
+
+		// throw "integer overflow" when the result doesn't fit the type
+		checked_add,
+		checked_sub,
+		checked_mul,
+
+		// hints, they don't change what the program does
+		expect, // expect(x, c) is x, which is most likely the constant c
+		assume, // assume(condition), the optimizer may rely on it, nothing checks it
+		prefetch, // prefetch(s), prefetch(s, rw, locality) starts loading the bytes of a string into the cache
+
+		len, // len(a), the number of elements of an array or a slice or the bytes of a string, as a u64
+
+		// throw "index out of bounds" when the lanes don't all fit
+		load, // load(a, i), elements i onwards of an array or a slice as a vector, which one comes from where the result goes
+		store, // store(a, i, v), the lanes of v to elements i onwards
+	};
+
+	std::optional<builtin> find_builtin(const std::string& name);
+
+	// the checked arithmetic and the vector loads and stores, which throw when the check fails
+	inline bool can_throw(builtin kind)
+	{
+		return kind == builtin::checked_add || kind == builtin::checked_sub || kind == builtin::checked_mul
+			|| kind == builtin::load || kind == builtin::store;
+	}
+
 	struct number
 	{
 		std::string value;
@@ -73,13 +123,69 @@ namespace seam::compiler::ir::ast
 			value(std::move(value)) {}
 	};
 
+	enum class binary_operator
+	{
+		add,
+		subtract,
+		multiply,
+		divide,
+		equal,
+		not_equal,
+		less,
+		less_equal,
+		greater,
+		greater_equal,
+	};
+
+	enum class unary_operator
+	{
+		negate,
+	};
+
+	inline const char* to_string(binary_operator op)
+	{
+		switch (op)
+		{
+			case binary_operator::add: return "+";
+			case binary_operator::subtract: return "-";
+			case binary_operator::multiply: return "*";
+			case binary_operator::divide: return "/";
+			case binary_operator::equal: return "==";
+			case binary_operator::not_equal: return "!=";
+			case binary_operator::less: return "<";
+			case binary_operator::less_equal: return "<=";
+			case binary_operator::greater: return ">";
+			case binary_operator::greater_equal: return ">=";
+		}
+		return "<unknown>";
+	}
+
+	// comparisons always result in a bool, whatever the operand type
+	inline bool is_comparison(binary_operator op)
+	{
+		return op >= binary_operator::equal;
+	}
+
+	inline const char* to_string(unary_operator op)
+	{
+		switch (op)
+		{
+			case unary_operator::negate: return "-";
+		}
+		return "<unknown>";
+	}
+
     struct var
     {
 		type_reference type_;
         std::string name;
+		attribute_map attributes; // only fields have them so far
 
 		var(type type_, std::string name) :
 			type_(std::move(type_)), name(std::move(name)) {}
+
+		var(type type_, std::string name, attribute_map attributes) :
+			type_(std::move(type_)), name(std::move(name)), attributes(std::move(attributes)) {}
     };
 
 	namespace statement
@@ -87,6 +193,17 @@ namespace seam::compiler::ir::ast
 		struct function_declaration;
 	}
 
+	// a bounds check range_analysis moved in front of a loop. every index it covers is below `limit` (or `constant_limit`)
+	// and neither that nor the length of `sequence` changes while the loop runs, so comparing the two once on the way in
+	// is enough to know they're all in bounds
+	struct hoisted_check
+	{
+		const var* sequence = nullptr; // the slice being indexed, nullptr for an array of array_length elements
+		std::uint64_t array_length = 0;
+		const var* limit = nullptr; // nullptr for constant_limit
+		std::uint64_t constant_limit = 0;
+	};
+
 	namespace expression
 	{
 		struct expression : node
@@ -123,6 +240,35 @@ namespace seam::compiler::ir::ast
 			void visit(visitor* vst);
 		};
 
+		struct binary : expression
+		{
+			binary_operator op;
+			std::unique_ptr<expression> left, right;
+			std::shared_ptr<types::type_descriptor> type; // type of both operands, set by literal_typer
+
+			// an integer division by something that can be 0, or -1 with the smallest value on the left, range_analysis clears it when it can't
+			bool checked = true;
+
+			binary(position_range range, binary_operator op, std::unique_ptr<expression> left, std::unique_ptr<expression> right) :
+				expression(range), op(op), left(std::move(left)), right(std::move(right)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct unary : expression
+		{
+			unary_operator op;
+			std::unique_ptr<expression> operand;
+			std::shared_ptr<types::type_descriptor> type; // set by literal_typer
+
+			unary(position_range range, unary_operator op, std::unique_ptr<expression> operand) :
+				expression(range), op(op), operand(std::move(operand)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
 		struct variable : expression
 		{
 			std::unique_ptr<expression> var;
@@ -146,7 +292,27 @@ namespace seam::compiler::ir::ast
 
 		struct local_variable : expression
 		{
+			std::string name;
+			var* def; // the parameter or variable_declaration::variable this refers to
+
+			local_variable(position_range range, std::string name, var* def) :
+				expression(range), name(std::move(name)), def(def) {}
+
+			void visit(visitor* vst);
+		};
+
+		struct member_access : expression // a.b
+		{
+			std::unique_ptr<expression> object;
+			std::string name;
+			types::class_type_descriptor* object_type = nullptr; // set by literal_typer, like field_index
+			std::size_t field_index = 0; // declaration order in the class
+
+			member_access(position_range range, std::unique_ptr<expression> object, std::string name) :
+				expression(range), object(std::move(object)), name(std::move(name)) {}
 
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
 		};
 
 		struct function_variable : expression
@@ -159,6 +325,77 @@ namespace seam::compiler::ir::ast
 
 			void visit(visitor* vst);
 		};
+
+		struct builtin_function : expression // can only be called, there is no function behind it
+		{
+			std::string name;
+			builtin kind;
+
+			// set by literal_typer
+			std::shared_ptr<types::type_descriptor> type; // of the result
+			std::shared_ptr<types::type_descriptor> operand_type; // the vector or integer the builtin works on, the array or slice of a load or store
+			std::shared_ptr<types::type_descriptor> index_type; // of a load or store
+			unsigned lanes = 0; // the elements a load or store goes over
+
+			// checked arithmetic that can overflow or a load or store that can be out of bounds, range_analysis clears it when it can't
+			bool checked = true;
+			const hoisted_check* hoisted = nullptr; // set by range_analysis for a load or store, like the one of index_access
+
+			builtin_function(position_range range, std::string name, builtin kind) :
+				expression(range), name(std::move(name)), kind(kind) {}
+
+			void visit(visitor* vst);
+		};
+
+		struct index_access : expression // a[i]
+		{
+			std::unique_ptr<expression> object;
+			std::unique_ptr<expression> index;
+
+			// set by literal_typer
+			std::shared_ptr<types::type_descriptor> object_type; // the array or slice
+			std::shared_ptr<types::type_descriptor> index_type;
+
+			bool checked = true; // the bounds check, range_analysis clears it when the index is always in bounds
+			const hoisted_check* hoisted = nullptr; // set by range_analysis, the check only runs here when the hoisted one failed
+
+			index_access(position_range range, std::unique_ptr<expression> object, std::unique_ptr<expression> index) :
+				expression(range), object(std::move(object)), index(std::move(index)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct slice_access : expression // a[i:j], a[i:], a[:j] or a[:]
+		{
+			std::unique_ptr<expression> object;
+			std::unique_ptr<expression> from, to; // can be nullptr, the start and the end of the object
+
+			// set by literal_typer
+			std::shared_ptr<types::type_descriptor> object_type; // the array or slice
+			std::shared_ptr<types::type_descriptor> from_type, to_type; // nullptr for a missing bound
+			std::shared_ptr<types::type_descriptor> type; // the slice it results in
+
+			bool checked = true; // cleared in @unchecked functions
+
+			slice_access(position_range range, std::unique_ptr<expression> object, std::unique_ptr<expression> from, std::unique_ptr<expression> to) :
+				expression(range), object(std::move(object)), from(std::move(from)), to(std::move(to)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct array_literal : expression // [a, b, c], a single element [x] fills the whole array
+		{
+			std::vector<std::unique_ptr<expression>> elements;
+			std::shared_ptr<types::type_descriptor> type; // set by literal_typer
+
+			array_literal(position_range range, std::vector<std::unique_ptr<expression>> elements) :
+				expression(range), elements(std::move(elements)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
 	}
 
 	namespace statement
@@ -185,11 +422,27 @@ namespace seam::compiler::ir::ast
 
 		struct variable_assignment : statement // a = 2
 		{
-			var variable;
+			std::unique_ptr<expression::expression> target;
 			std::unique_ptr<expression::expression> value;
 			
-			variable_assignment(position_range range, var variable, std::unique_ptr<expression::expression> value) :
-				statement(range), variable(std::move(variable)), value(std::move(value)) {}
+			variable_assignment(position_range range, std::unique_ptr<expression::expression> target, std::unique_ptr<expression::expression> value) :
+				statement(range), target(std::move(target)), value(std::move(value)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+		
+		struct compound_assignment : statement // a += 2
+		{
+			std::unique_ptr<expression::expression> target;
+			binary_operator op;
+			std::unique_ptr<expression::expression> value;
+
+			std::shared_ptr<types::type_descriptor> type; // of the target, set by literal_typer
+			bool checked = true; // like the one of binary, for /=
+
+			compound_assignment(position_range range, std::unique_ptr<expression::expression> target, binary_operator op, std::unique_ptr<expression::expression> value) :
+				statement(range), target(std::move(target)), op(op), value(std::move(value)) {}
 
 			void visit_children(visitor* vst);
 			void visit(visitor* vst);
@@ -230,10 +483,10 @@ namespace seam::compiler::ir::ast
 			std::string name;
 			std::vector<var> arguments;
 			type_reference return_type;
-			std::unordered_set<std::string> attributes;
+			attribute_map attributes;
 
 			function_declaration(position_range range, std::string name, std::vector<var> arguments, type return_type,
-				std::unordered_set<std::string> attributes) :
+				attribute_map attributes) :
 				restricted_statement(range),
 				name(std::move(name)),
 				arguments(std::move(arguments)),
@@ -247,7 +500,7 @@ namespace seam::compiler::ir::ast
 		struct extern_definition : function_declaration
 		{
 			extern_definition(position_range range, std::string name, std::vector<var> arguments, type return_type,
-				std::unordered_set<std::string> attributes) :
+				attribute_map attributes) :
 				function_declaration(range, std::move(name), std::move(arguments), std::move(return_type), std::move(attributes))
 			{}
 
@@ -259,7 +512,7 @@ namespace seam::compiler::ir::ast
 			std::unique_ptr<block> body_stat;
 
 			function_definition(position_range range, std::string name, std::vector<var> arguments, type return_type,
-				std::unordered_set<std::string> attributes, std::unique_ptr<block> body_stat) :
+				attribute_map attributes, std::unique_ptr<block> body_stat) :
 				function_declaration(range, std::move(name), std::move(arguments), std::move(return_type), std::move(attributes)),
 				body_stat(std::move(body_stat))
 			{}
@@ -302,10 +555,87 @@ namespace seam::compiler::ir::ast
 			std::string name;
 
 			std::vector<var> fields;
+			attribute_map attributes;
 			std::unique_ptr<restricted_block> body;
 
-			class_type_definition(position_range range, std::vector<var> fields, std::unique_ptr<restricted_block> body) :
-				type_definition(range), fields(std::move(fields)), body(std::move(body)) {}
+			std::shared_ptr<types::class_type_descriptor> descriptor; // set by type_collector
+
+			class_type_definition(position_range range, std::string name, std::vector<var> fields, attribute_map attributes, std::unique_ptr<restricted_block> body) :
+				type_definition(range), name(std::move(name)), fields(std::move(fields)), attributes(std::move(attributes)), body(std::move(body)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct if_statement : statement // if a < b { } else { }
+		{
+			std::unique_ptr<expression::expression> condition;
+			std::unique_ptr<block> then_body;
+			std::unique_ptr<statement> else_body; // can be nullptr, a block or another if_statement
+
+			if_statement(position_range range, std::unique_ptr<expression::expression> condition, std::unique_ptr<block> then_body, std::unique_ptr<statement> else_body) :
+				statement(range), condition(std::move(condition)), then_body(std::move(then_body)), else_body(std::move(else_body)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct while_statement : statement // while a < b { }
+		{
+			std::unique_ptr<expression::expression> condition;
+			std::unique_ptr<block> body;
+			std::vector<std::unique_ptr<hoisted_check>> hoisted_checks; // set by range_analysis, they run right before the loop
+
+			while_statement(position_range range, std::unique_ptr<expression::expression> condition, std::unique_ptr<block> body) :
+				statement(range), condition(std::move(condition)), body(std::move(body)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct switch_case
+		{
+			position_range range;
+			std::vector<std::unique_ptr<expression::expression>> labels; // constants, checked by constant_folder
+			std::unique_ptr<block> body;
+
+			switch_case(position_range range, std::vector<std::unique_ptr<expression::expression>> labels, std::unique_ptr<block> body) :
+				range(range), labels(std::move(labels)), body(std::move(body)) {}
+		};
+
+		struct switch_statement : statement // switch a { 1, 2 -> { } else -> { } }
+		{
+			std::unique_ptr<expression::expression> value;
+			std::vector<switch_case> cases;
+			std::unique_ptr<block> default_body; // can be nullptr
+			std::shared_ptr<types::type_descriptor> type; // type of the value and every label, set by literal_typer
+
+			switch_statement(position_range range, std::unique_ptr<expression::expression> value, std::vector<switch_case> cases, std::unique_ptr<block> default_body) :
+				statement(range), value(std::move(value)), cases(std::move(cases)), default_body(std::move(default_body)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct try_statement : statement // try { } catch e { }
+		{
+			std::unique_ptr<block> body;
+			std::optional<var> catch_variable; // holds the thrown string, only there if the catch names it
+			std::unique_ptr<block> catch_body;
+
+			try_statement(position_range range, std::unique_ptr<block> body, std::optional<var> catch_variable, std::unique_ptr<block> catch_body) :
+				statement(range), body(std::move(body)), catch_variable(std::move(catch_variable)), catch_body(std::move(catch_body)) {}
+
+			void visit_children(visitor* vst);
+			void visit(visitor* vst);
+		};
+
+		struct throw_statement : statement // throw "message"
+		{
+			std::unique_ptr<expression::expression> value;
+
+			throw_statement(position_range range, std::unique_ptr<expression::expression> value) :
+				statement(range), value(std::move(value)) {}
 
 			void visit_children(visitor* vst);
 			void visit(visitor* vst);
@@ -361,9 +691,17 @@ namespace seam::compiler::ir::ast
 		VISITOR(expression::expression, expression::literal<bool>);
 
 		VISITOR(expression::expression, expression::call);
+		VISITOR(expression::expression, expression::binary);
+		VISITOR(expression::expression, expression::unary);
 		VISITOR(expression::expression, expression::variable);
 		VISITOR(expression::expression, expression::unresolved_variable);
+		VISITOR(expression::expression, expression::local_variable);
 		VISITOR(expression::expression, expression::function_variable);
+		VISITOR(expression::expression, expression::builtin_function);
+		VISITOR(expression::expression, expression::member_access);
+		VISITOR(expression::expression, expression::index_access);
+		VISITOR(expression::expression, expression::slice_access);
+		VISITOR(expression::expression, expression::array_literal);
 
 		VISITOR(statement::restricted_statement, statement::type_definition);
 		VISITOR(statement::restricted_statement, statement::extern_definition);
@@ -375,8 +713,14 @@ namespace seam::compiler::ir::ast
 		VISITOR(statement::statement, statement::expression_statement);
 		VISITOR(statement::statement, statement::variable_declaration);
 		VISITOR(statement::statement, statement::variable_assignment);
+		VISITOR(statement::statement, statement::compound_assignment);
 		VISITOR(statement::statement, statement::block);
 		VISITOR(statement::statement, statement::restricted_block);
+		VISITOR(statement::statement, statement::if_statement);
+		VISITOR(statement::statement, statement::while_statement);
+		VISITOR(statement::statement, statement::switch_statement);
+		VISITOR(statement::statement, statement::try_statement);
+		VISITOR(statement::statement, statement::throw_statement);
 		VISITOR(statement::statement, statement::ret);
 	};
 
@@ -1,8 +1,11 @@
 #pragma once
 
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace seam::compiler::ir::types
 {
@@ -22,17 +25,43 @@ namespace seam::compiler::ir::types
 		bool is_optional;
 	};
 	
+	// @align(N), @packed and @cacheline, on a class or on a single field
+	struct layout_attributes
+	{
+		std::uint64_t align = 0; // 0 keeps the natural alignment
+		bool packed = false; // alignment 1, no padding in front
+		bool cacheline = false; // starts on a cache line and nothing else shares the lines it covers
+
+		bool any() const { return align != 0 || packed || cacheline; }
+	};
+
 	struct field_descriptor
 	{
 		std::string name;
 		type_reference type;
+		layout_attributes layout;
 	};
 
 	struct class_type_descriptor : type_descriptor
 	{
-		std::unordered_map<std::string, field_descriptor> fields;
+		std::vector<field_descriptor> fields; // in declaration order, code generation may lay them out differently
+		bool repr_c = false; // @repr(C), keeps the declaration order in memory
+		bool soa = false; // @soa, a collection of this class stores every field in its own array
+		layout_attributes layout;
 
 		using type_descriptor::type_descriptor;
+
+		std::optional<std::size_t> find_field(const std::string& field_name) const
+		{
+			for (std::size_t i = 0; i < fields.size(); ++i)
+			{
+				if (fields[i].name == field_name)
+				{
+					return i;
+				}
+			}
+			return std::nullopt;
+		}
 	};
 
 	struct alias_type_descriptor : type_descriptor
@@ -48,4 +77,203 @@ namespace seam::compiler::ir::types
 	{
 		using type_descriptor::type_descriptor;
 	};
+
+	// f32x4, i32x8, u8x16, ... a fixed number of lanes of a number type, operators work on every lane
+	struct vector_type_descriptor : type_descriptor
+	{
+		std::shared_ptr<type_descriptor> element;
+		unsigned lanes;
+
+		vector_type_descriptor(std::string name, std::shared_ptr<type_descriptor> element, unsigned lanes) :
+			type_descriptor(std::move(name)), element(std::move(element)), lanes(lanes) {}
+	};
+
+	// T[N], N elements one after the other. locals of it live in a stack slot, arrays of @soa classes store every field in its own array
+	struct array_type_descriptor : type_descriptor
+	{
+		std::shared_ptr<type_descriptor> element;
+		std::uint64_t length;
+
+		array_type_descriptor(std::string name, std::shared_ptr<type_descriptor> element, std::uint64_t length) :
+			type_descriptor(std::move(name)), element(std::move(element)), length(length) {}
+	};
+
+	// T[], a pointer to the first element and the number of elements, a view into an array it doesn't own
+	struct slice_type_descriptor : type_descriptor
+	{
+		std::shared_ptr<type_descriptor> element;
+
+		slice_type_descriptor(std::string name, std::shared_ptr<type_descriptor> element) :
+			type_descriptor(std::move(name)), element(std::move(element)) {}
+	};
+
+	inline type_descriptor* unwrap_alias(type_descriptor* type_desc)
+	{
+		while (auto alias = dynamic_cast<alias_type_descriptor*>(type_desc))
+		{
+			type_desc = alias->aliased_type.get();
+		}
+		return type_desc;
+	}
+
+	template <typename T>
+	bool is_built_in(type_descriptor* type_desc)
+	{
+		return dynamic_cast<built_in_type_descriptor<T>*>(unwrap_alias(type_desc)) != nullptr;
+	}
+
+	inline bool is_signed_integer(type_descriptor* type_desc)
+	{
+		return is_built_in<std::int8_t>(type_desc) || is_built_in<std::int16_t>(type_desc)
+			|| is_built_in<std::int32_t>(type_desc) || is_built_in<std::int64_t>(type_desc);
+	}
+
+	inline bool is_unsigned_integer(type_descriptor* type_desc)
+	{
+		return is_built_in<std::uint8_t>(type_desc) || is_built_in<std::uint16_t>(type_desc)
+			|| is_built_in<std::uint32_t>(type_desc) || is_built_in<std::uint64_t>(type_desc);
+	}
+
+	inline bool is_integer(type_descriptor* type_desc)
+	{
+		return is_signed_integer(type_desc) || is_unsigned_integer(type_desc);
+	}
+
+	inline bool is_floating_point(type_descriptor* type_desc)
+	{
+		return is_built_in<float>(type_desc) || is_built_in<double>(type_desc);
+	}
+
+	inline vector_type_descriptor* as_vector(type_descriptor* type_desc)
+	{
+		return dynamic_cast<vector_type_descriptor*>(unwrap_alias(type_desc));
+	}
+
+	inline array_type_descriptor* as_array(type_descriptor* type_desc)
+	{
+		return dynamic_cast<array_type_descriptor*>(unwrap_alias(type_desc));
+	}
+
+	inline slice_type_descriptor* as_slice(type_descriptor* type_desc)
+	{
+		return dynamic_cast<slice_type_descriptor*>(unwrap_alias(type_desc));
+	}
+
+	// the element of an array or a slice, nullptr for anything else
+	inline const std::shared_ptr<type_descriptor>* element_type(type_descriptor* type_desc)
+	{
+		if (auto array = as_array(type_desc))
+		{
+			return &array->element;
+		}
+		if (auto slice = as_slice(type_desc))
+		{
+			return &slice->element;
+		}
+		return nullptr;
+	}
+
+	// what the operators of a type work on, the element type of a vector
+	inline type_descriptor* scalar_type(type_descriptor* type_desc)
+	{
+		auto vector = as_vector(type_desc);
+		return vector ? vector->element.get() : type_desc;
+	}
+
+	inline unsigned bit_width(type_descriptor* type_desc)
+	{
+		if (is_built_in<std::int8_t>(type_desc) || is_built_in<std::uint8_t>(type_desc)) return 8;
+		if (is_built_in<std::int16_t>(type_desc) || is_built_in<std::uint16_t>(type_desc)) return 16;
+		if (is_built_in<std::int32_t>(type_desc) || is_built_in<std::uint32_t>(type_desc) || is_built_in<float>(type_desc)) return 32;
+		if (is_built_in<std::int64_t>(type_desc) || is_built_in<std::uint64_t>(type_desc) || is_built_in<double>(type_desc)) return 64;
+		return 0;
+	}
+
+	inline std::shared_ptr<type_descriptor> make_number_type(const std::string& name)
+	{
+		if (name == "i8") return std::make_shared<built_in_type_descriptor<std::int8_t>>(name);
+		if (name == "i16") return std::make_shared<built_in_type_descriptor<std::int16_t>>(name);
+		if (name == "i32") return std::make_shared<built_in_type_descriptor<std::int32_t>>(name);
+		if (name == "i64") return std::make_shared<built_in_type_descriptor<std::int64_t>>(name);
+		if (name == "u8") return std::make_shared<built_in_type_descriptor<std::uint8_t>>(name);
+		if (name == "u16") return std::make_shared<built_in_type_descriptor<std::uint16_t>>(name);
+		if (name == "u32") return std::make_shared<built_in_type_descriptor<std::uint32_t>>(name);
+		if (name == "u64") return std::make_shared<built_in_type_descriptor<std::uint64_t>>(name);
+		if (name == "f32") return std::make_shared<built_in_type_descriptor<float>>(name);
+		if (name == "f64") return std::make_shared<built_in_type_descriptor<double>>(name);
+		return nullptr;
+	}
+
+	inline std::shared_ptr<array_type_descriptor> make_array_type(std::shared_ptr<type_descriptor> element, std::uint64_t length)
+	{
+		auto name = element->name + '[' + std::to_string(length) + ']';
+		return std::make_shared<array_type_descriptor>(std::move(name), std::move(element), length);
+	}
+
+	inline std::shared_ptr<slice_type_descriptor> make_slice_type(std::shared_ptr<type_descriptor> element)
+	{
+		auto name = element->name + "[]";
+		return std::make_shared<slice_type_descriptor>(std::move(name), std::move(element));
+	}
+
+	// the widest vector registers around (avx-512), wider vectors would only be split up again
+	constexpr unsigned max_vector_bits = 512;
+
+	// <element>x<lanes> with a power of two number of lanes, nullptr if the name isn't a vector type
+	inline std::shared_ptr<vector_type_descriptor> make_vector_type(const std::string& name)
+	{
+		const auto separator = name.find('x');
+		if (separator == std::string::npos || separator + 1 == name.size() || name[separator + 1] == '0')
+		{
+			return nullptr;
+		}
+
+		auto element = make_number_type(name.substr(0, separator));
+		if (!element)
+		{
+			return nullptr;
+		}
+
+		unsigned lanes = 0;
+		for (auto it = name.cbegin() + separator + 1; it != name.cend(); ++it)
+		{
+			if (*it < '0' || *it > '9' || lanes > max_vector_bits)
+			{
+				return nullptr;
+			}
+			lanes = lanes * 10 + (*it - '0');
+		}
+
+		if (lanes < 2 || (lanes & (lanes - 1)) != 0 || lanes * bit_width(element.get()) > max_vector_bits)
+		{
+			return nullptr;
+		}
+		return std::make_shared<vector_type_descriptor>(name, std::move(element), lanes);
+	}
+
+	// built in types can have more than one descriptor (one per module plus the ones passes create),
+	// names are unique within a module so they're good enough to compare. arrays and slices of an alias are the same
+	// as the ones of what it stands for, so those go by their elements
+	inline bool is_same(type_descriptor* a, type_descriptor* b)
+	{
+		a = unwrap_alias(a);
+		b = unwrap_alias(b);
+		if (a == b)
+		{
+			return true;
+		}
+
+		auto a_array = as_array(a), b_array = as_array(b);
+		if (a_array || b_array)
+		{
+			return a_array && b_array && a_array->length == b_array->length && is_same(a_array->element.get(), b_array->element.get());
+		}
+
+		auto a_slice = as_slice(a), b_slice = as_slice(b);
+		if (a_slice || b_slice)
+		{
+			return a_slice && b_slice && is_same(a_slice->element.get(), b_slice->element.get());
+		}
+		return a && b && a->name == b->name;
+	}
 }
@@ -1,9 +1,64 @@
 #include "cfg.h"
 
+#include <llvm/ADT/DepthFirstIterator.h>
+
+#include <algorithm>
+
 using namespace seam::compiler;
 
-void ir::cfg::block::add_successor(std::shared_ptr<block> succ)
+void ir::cfg::block::add_successor(block* succ)
+{
+	succ->predecessors.push_back(this);
+	successors.push_back(succ);
+}
+
+void ir::cfg::block::remove_successor(block* succ)
+{
+	successors.erase(std::remove(successors.begin(), successors.end(), succ), successors.end());
+	succ->predecessors.erase(std::remove(succ->predecessors.begin(), succ->predecessors.end(), this), succ->predecessors.end());
+}
+
+ir::cfg::function_graph::function_graph(ast::statement::function_definition* function) :
+	function(function)
+{
+	entry = create_block();
+}
+
+ir::cfg::block* ir::cfg::function_graph::create_block()
+{
+	auto new_block = new (allocator.Allocate()) block{ blocks.size() };
+	blocks.push_back(new_block);
+	return new_block;
+}
+
+std::size_t ir::cfg::function_graph::remove_unreachable()
 {
-	succ->predecessors.push_back(weak_from_this());
-	successors.push_back(std::move(succ));
-}
\ No newline at end of file
+	llvm::df_iterator_default_set<block*, 32> reachable;
+	for (auto reached : llvm::depth_first_ext(this, reachable))
+	{
+		(void)reached;
+	}
+
+	if (reachable.size() == blocks.size())
+	{
+		return 0;
+	}
+
+	// unreachable blocks can still have edges into the reachable part
+	for (auto dead : blocks)
+	{
+		if (!reachable.count(dead))
+		{
+			while (!dead->successors.empty())
+			{
+				dead->remove_successor(dead->successors.back());
+			}
+		}
+	}
+
+	const auto old_size = blocks.size();
+	blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [&](block* b) { return !reachable.count(b); }), blocks.end());
+
+	// the memory stays with the allocator until the graph goes away
+	return old_size - blocks.size();
+}
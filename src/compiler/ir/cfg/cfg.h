@@ -2,35 +2,153 @@
 
 #include "../ast/ast.h"
 
+#include <llvm/ADT/GraphTraits.h>
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Allocator.h>
+
+#include <cstddef>
 #include <memory>
 #include <vector>
-#include <unordered_map>
 
 namespace seam::compiler::ir::cfg
 {
+	struct block;
+
+	// ends a block, every edge of the graph comes from one of these
 	struct cf_instruction
 	{
 		virtual ~cf_instruction() {}
 	};
 
+	struct jump_instruction : cf_instruction
+	{
+		block* target;
+
+		jump_instruction(block* target) :
+			target(target) {}
+	};
+
 	struct if_instruction : cf_instruction
 	{
 		ast::expression::expression* condition;
+		block* true_target;
+		block* false_target;
+
+		if_instruction(ast::expression::expression* condition, block* true_target, block* false_target) :
+			condition(condition), true_target(true_target), false_target(false_target) {}
 	};
 
-	struct jump_instruction : cf_instruction
+	// the condition check at the head of a loop, the body jumps back to the block holding this
+	struct loop_instruction : if_instruction
+	{
+		loop_instruction(ast::expression::expression* condition, block* body, block* exit) :
+			if_instruction(condition, body, exit) {}
+
+		block* body() const { return true_target; }
+		block* exit() const { return false_target; }
+	};
+
+	struct switch_instruction : cf_instruction
+	{
+		ast::statement::switch_statement* stat;
+		std::vector<std::pair<ast::expression::expression*, block*>> cases; // one entry per label
+		block* default_target;
+
+		switch_instruction(ast::statement::switch_statement* stat, std::vector<std::pair<ast::expression::expression*, block*>> cases, block* default_target) :
+			stat(stat), cases(std::move(cases)), default_target(default_target) {}
+	};
+
+	// a throw inside a try of the same function jumps straight to its catch, otherwise the exception unwinds the stack
+	struct throw_instruction : cf_instruction
+	{
+		ast::statement::throw_statement* stat;
+		ast::statement::try_statement* handler; // nullptr when the exception leaves the function
+		block* catch_target;
+
+		throw_instruction(ast::statement::throw_statement* stat, ast::statement::try_statement* handler, block* catch_target) :
+			stat(stat), handler(handler), catch_target(catch_target) {}
+	};
+
+	struct return_instruction : cf_instruction
 	{
-		
+		ast::statement::ret* stat; // nullptr when falling off the end of the function
+
+		return_instruction(ast::statement::ret* stat) :
+			stat(stat) {}
 	};
 
-	struct block : std::enable_shared_from_this<block>
+	struct block
 	{
-		std::vector<std::weak_ptr<block>> predecessors;
-		std::vector<std::shared_ptr<block>> successors;
+		std::size_t id; // creation order within the function
+
+		llvm::SmallVector<block*, 2> predecessors;
+		llvm::SmallVector<block*, 2> successors; // one entry per edge, so a block can show up twice
 
+		// only straight line statements, control flow statements become the terminator
 		std::vector<ast::statement::statement*> body;
 		std::unique_ptr<cf_instruction> cf_instr;
 
-		void add_successor(std::shared_ptr<block> successor);
+		// calls in a try body that can throw unwind to the landing pad of the try, the edge is in successors as well
+		block* unwind_target = nullptr;
+		ast::statement::try_statement* landing_pad_for = nullptr; // set on the landing pad, it binds the caught value
+		ast::statement::while_statement* loop_for = nullptr; // set on the head of a loop, its hoisted checks run on the edge into it
+
+		explicit block(std::size_t id) :
+			id(id) {}
+
+		void add_successor(block* succ);
+		void remove_successor(block* succ);
+	};
+
+	// the blocks of a single function, they live as long as the graph and are handed out as plain pointers
+	class function_graph
+	{
+		llvm::SpecificBumpPtrAllocator<block> allocator;
+		std::vector<block*> blocks;
+	public:
+		ast::statement::function_definition* function;
+		block* entry;
+
+		explicit function_graph(ast::statement::function_definition* function);
+		function_graph(const function_graph&) = delete;
+		function_graph& operator=(const function_graph&) = delete;
+
+		block* create_block();
+
+		// drops every block that can't be reached from the entry, returns the number of removed blocks
+		std::size_t remove_unreachable();
+
+		std::size_t size() const { return blocks.size(); }
+		std::vector<block*>::const_iterator begin() const { return blocks.cbegin(); }
+		std::vector<block*>::const_iterator end() const { return blocks.cend(); }
+	};
+
+	// every block comes after all of its predecessors, except the ones reaching it through a back edge
+	using rpo_traversal = llvm::ReversePostOrderTraversal<function_graph*>;
+}
+
+namespace llvm
+{
+	template <>
+	struct GraphTraits<seam::compiler::ir::cfg::block*>
+	{
+		using NodeRef = seam::compiler::ir::cfg::block*;
+		using ChildIteratorType = SmallVectorImpl<NodeRef>::iterator;
+
+		static NodeRef getEntryNode(NodeRef node) { return node; }
+		static ChildIteratorType child_begin(NodeRef node) { return node->successors.begin(); }
+		static ChildIteratorType child_end(NodeRef node) { return node->successors.end(); }
+	};
+
+	template <>
+	struct GraphTraits<seam::compiler::ir::cfg::function_graph*> : GraphTraits<seam::compiler::ir::cfg::block*>
+	{
+		using nodes_iterator = std::vector<NodeRef>::const_iterator;
+
+		static NodeRef getEntryNode(seam::compiler::ir::cfg::function_graph* graph) { return graph->entry; }
+		static nodes_iterator nodes_begin(seam::compiler::ir::cfg::function_graph* graph) { return graph->begin(); }
+		static nodes_iterator nodes_end(seam::compiler::ir::cfg::function_graph* graph) { return graph->end(); }
+		static unsigned size(seam::compiler::ir::cfg::function_graph* graph) { return static_cast<unsigned>(graph->size()); }
 	};
-}
\ No newline at end of file
+}
@@ -1,60 +1,301 @@
 #include "cfg_builder.h"
 
-#include <unordered_map>
-#include <stdexcept>
+#include "../../utils/exception.h"
+#include "../../comptime/interpreter.h"
+
+#include <vector>
 
 using namespace seam::compiler;
 
-struct cfg_visitor : ir::ast::visitor
+namespace
 {
-	std::vector<std::pair<ir::ast::statement::function_definition*, std::shared_ptr<ir::cfg::block>>>& function_blocks;
-	std::shared_ptr<ir::cfg::block> current;
+	struct cfg_visitor : ir::ast::visitor
+	{
+		ir::cfg::function_graph& graph;
+		ir::cfg::block* current;
 
-	cfg_visitor(std::vector<std::pair<ir::ast::statement::function_definition*, std::shared_ptr<ir::cfg::block>>>& function_blocks) :
-		function_blocks(function_blocks) {}
+		struct try_region
+		{
+			ir::ast::statement::try_statement* stat;
+			ir::cfg::block* landing_pad;
+			ir::cfg::block* catch_block;
+		};
+		std::vector<try_region> try_regions; // innermost last
 
-	bool visit(ir::ast::node* node) override
-	{
-		return true;
-	}
+		cfg_visitor(ir::cfg::function_graph& graph) :
+			graph(graph), current(graph.entry) {}
 
-	bool visit(ir::ast::statement::restricted_block* node) override
-	{
-		return true;
-	}
+		// blocks created inside a try body can unwind to its landing pad
+		ir::cfg::block* create_block()
+		{
+			auto new_block = graph.create_block();
+			if (!try_regions.empty())
+			{
+				new_block->unwind_target = try_regions.back().landing_pad;
+				new_block->add_successor(new_block->unwind_target);
+			}
+			return new_block;
+		}
 
-	bool visit(ir::ast::statement::statement* node)
-	{
-		if (!current)
+		void terminate(std::unique_ptr<ir::cfg::cf_instruction> instr)
+		{
+			current->cf_instr = std::move(instr);
+
+			// anything following is dead, it goes into a block without predecessors which is removed later
+			current = create_block();
+		}
+
+		void jump_to(ir::cfg::block* target)
 		{
-			throw std::runtime_error("oh no");
+			current->add_successor(target);
+			terminate(std::make_unique<ir::cfg::jump_instruction>(target));
+		}
+
+		void branch(ir::ast::expression::expression* condition, ir::cfg::block* true_target, ir::cfg::block* false_target, bool is_loop)
+		{
+			if (auto constant = dynamic_cast<ir::ast::expression::literal<bool>*>(condition))
+			{
+				jump_to(constant->val ? true_target : false_target);
+				return;
+			}
+
+			current->add_successor(true_target);
+			current->add_successor(false_target);
+
+			if (is_loop)
+			{
+				terminate(std::make_unique<ir::cfg::loop_instruction>(condition, true_target, false_target));
+			}
+			else
+			{
+				terminate(std::make_unique<ir::cfg::if_instruction>(condition, true_target, false_target));
+			}
+		}
+
+		bool visit(ir::ast::node* node) override
+		{
+			throw exception(node->range.start, "unexpected node in function body");
+		}
+
+		bool visit(ir::ast::statement::statement* node) override
+		{
+			current->body.push_back(node);
+			return false;
+		}
+
+		bool visit(ir::ast::statement::block* node) override
+		{
+			return true;
+		}
+
+		bool visit(ir::ast::statement::if_statement* node) override
+		{
+			auto then_block = create_block();
+			auto else_block = node->else_body ? create_block() : nullptr;
+			auto merge_block = create_block();
+
+			branch(node->condition.get(), then_block, else_block ? else_block : merge_block, false);
+
+			current = then_block;
+			node->then_body->visit(this);
+			jump_to(merge_block);
+
+			if (else_block)
+			{
+				current = else_block;
+				node->else_body->visit(this);
+				jump_to(merge_block);
+			}
+
+			current = merge_block;
+			return false;
+		}
+
+		bool visit(ir::ast::statement::while_statement* node) override
+		{
+			auto header_block = create_block();
+			auto body_block = create_block();
+			auto exit_block = create_block();
+			header_block->loop_for = node;
+
+			jump_to(header_block);
+
+			current = header_block;
+			branch(node->condition.get(), body_block, exit_block, true);
+
+			current = body_block;
+			node->body->visit(this);
+			jump_to(header_block);
+
+			current = exit_block;
+			return false;
 		}
-		current->body.push_back(node);
-		return false;
-	}
 
-	bool visit(ir::ast::statement::block* node)
+		bool visit(ir::ast::statement::switch_statement* node) override
+		{
+			auto merge_block = create_block();
+			auto default_block = node->default_body ? create_block() : merge_block;
+
+			// the value already folded into a literal, only the matching case is reachable
+			auto constant = comptime::literal_value(node->value.get());
+
+			std::vector<std::pair<ir::ast::expression::expression*, ir::cfg::block*>> cases;
+			std::vector<ir::cfg::block*> case_blocks;
+			ir::cfg::block* constant_target = nullptr;
+			for (auto& switch_case : node->cases)
+			{
+				auto case_block = create_block();
+				case_blocks.push_back(case_block);
+
+				for (auto& label : switch_case.labels)
+				{
+					cases.emplace_back(label.get(), case_block);
+					if (constant && comptime::literal_value(label.get()) == constant)
+					{
+						constant_target = case_block;
+					}
+				}
+			}
+
+			if (constant)
+			{
+				jump_to(constant_target ? constant_target : default_block);
+			}
+			else
+			{
+				for (auto case_block : case_blocks)
+				{
+					current->add_successor(case_block);
+				}
+
+				if (node->default_body)
+				{
+					current->add_successor(default_block);
+				}
+				else
+				{
+					current->add_successor(merge_block);
+				}
+
+				terminate(std::make_unique<ir::cfg::switch_instruction>(node, std::move(cases), default_block));
+			}
+
+			for (std::size_t i = 0; i < node->cases.size(); ++i)
+			{
+				current = case_blocks[i];
+				node->cases[i].body->visit(this);
+				jump_to(merge_block);
+			}
+
+			if (node->default_body)
+			{
+				current = default_block;
+				node->default_body->visit(this);
+				jump_to(merge_block);
+			}
+
+			current = merge_block;
+			return false;
+		}
+
+		bool visit(ir::ast::statement::try_statement* node) override
+		{
+			auto landing_pad = create_block();
+			auto catch_block = create_block();
+			auto merge_block = create_block();
+			landing_pad->landing_pad_for = node;
+
+			try_regions.push_back({ node, landing_pad, catch_block });
+			auto body_block = create_block();
+			jump_to(body_block);
+
+			current = body_block;
+			node->body->visit(this);
+			jump_to(merge_block);
+			try_regions.pop_back();
+
+			current = landing_pad;
+			jump_to(catch_block);
+
+			current = catch_block;
+			node->catch_body->visit(this);
+			jump_to(merge_block);
+
+			current = merge_block;
+			return false;
+		}
+
+		bool visit(ir::ast::statement::throw_statement* node) override
+		{
+			if (try_regions.empty())
+			{
+				terminate(std::make_unique<ir::cfg::throw_instruction>(node, nullptr, nullptr));
+				return false;
+			}
+
+			auto& region = try_regions.back();
+			current->add_successor(region.catch_block);
+			terminate(std::make_unique<ir::cfg::throw_instruction>(node, region.stat, region.catch_block));
+			return false;
+		}
+
+		bool visit(ir::ast::statement::ret* node) override
+		{
+			terminate(std::make_unique<ir::cfg::return_instruction>(node));
+			return false;
+		}
+	};
+
+	struct function_collector : ir::ast::visitor
 	{
-		node->visit_children(this);
-		return false;
-	}
+		cfg_builder::function_graph_map& graphs;
+
+		function_collector(cfg_builder::function_graph_map& graphs) :
+			graphs(graphs) {}
+
+		bool visit(ir::ast::statement::function_definition* node) override
+		{
+			graphs.insert({ node, cfg_builder::cfg_builder::build_function(node) });
+			return false;
+		}
+	};
+}
 
-	bool visit(ir::ast::statement::function_definition* node)
+std::unique_ptr<ir::cfg::function_graph> cfg_builder::cfg_builder::build_function(ir::ast::statement::function_definition* func_def)
+{
+	auto graph = std::make_unique<ir::cfg::function_graph>(func_def);
+
+	cfg_visitor visitor{ *graph };
+	func_def->body_stat->visit(&visitor);
+
+	// falling off the end of the function
+	visitor.current->cf_instr = std::make_unique<ir::cfg::return_instruction>(nullptr);
+
+	graph->remove_unreachable();
+
+	auto& return_type = std::get<ir::types::type_reference>(func_def->return_type);
+	if (!ir::types::is_built_in<void>(return_type.type.get()))
 	{
-		function_blocks.emplace_back(node, current = std::make_shared<ir::cfg::block>());
-		node->visit_children(this);
-		current.reset();
-		return false;
+		for (auto block : *graph)
+		{
+			auto ret = dynamic_cast<ir::cfg::return_instruction*>(block->cf_instr.get());
+			if (ret && (!ret->stat || !ret->stat->value))
+			{
+				const auto pos = ret->stat ? ret->stat->range.start : func_def->body_stat->range.end;
+				throw exception(pos, "function '" + func_def->name + "' has to return a value of type '" + return_type.type->name + "' on every path");
+			}
+		}
 	}
-};
 
-cfg_builder::function_block_map cfg_builder::cfg_builder::build()
+	return graph;
+}
+
+cfg_builder::function_graph_map cfg_builder::cfg_builder::build()
 {
-	std::vector<std::pair<ir::ast::statement::function_definition*, std::shared_ptr<ir::cfg::block>>> function_blocks;
-	cfg_visitor visitor{ function_blocks };
-	root->visit(&visitor);
-
-	function_block_map block;
-	
-	return block;//function_blocks;
-}
\ No newline at end of file
+	function_graph_map graphs;
+
+	function_collector collector{ graphs };
+	root->visit(&collector);
+
+	return graphs;
+}
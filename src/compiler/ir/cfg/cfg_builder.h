@@ -3,10 +3,16 @@
 #include "../cfg/cfg.h"
 #include "../ast/ast.h"
 
+#include <llvm/ADT/MapVector.h>
+
+#include <memory>
+
 namespace seam::compiler::cfg_builder
 {
-	using function_block_map = std::unordered_map<ir::ast::statement::function_definition*, std::shared_ptr<ir::cfg::block>>;
+	using function_graph_map = llvm::MapVector<ir::ast::statement::function_definition*, std::unique_ptr<ir::cfg::function_graph>>;
 
+	// splits function bodies into basic blocks, needs to run after the passes that rewrite expressions (constant_folder).
+	// conditions that folded to a literal become plain jumps, so the branch not taken is dropped with the rest of the dead code
 	class cfg_builder
 	{
 		ir::ast::statement::restricted_block* root;
@@ -14,6 +20,10 @@ namespace seam::compiler::cfg_builder
 		cfg_builder(ir::ast::statement::restricted_block* root) :
 			root(root) {}
 
-		function_block_map build();
+		// graphs for every function definition, in source order
+		function_graph_map build();
+
+		// throws if a path through a function with a return type ends without returning
+		static std::unique_ptr<ir::cfg::function_graph> build_function(ir::ast::statement::function_definition* func_def);
 	};
 }
@@ -32,6 +32,9 @@ namespace seam::compiler::lexer
 			kw_throw,
 			kw_true,
 			kw_false,
+			kw_if,
+			kw_else,
+			kw_while,
 			
 			// symbols
 			symb_declare,
@@ -45,9 +48,16 @@ namespace seam::compiler::lexer
 			symb_divide_assign,
 			symb_arrow,
 			symb_equals,
+			symb_equal,
+			symb_not_equal,
+			symb_less,
+			symb_less_equal,
+			symb_greater,
+			symb_greater_equal,
 			symb_question,
 			symb_colon,
 			symb_comma,
+			symb_dot,
 
 			// symbol pairs
 			symb_open_parenthesis,
@@ -116,6 +126,18 @@ namespace seam::compiler::lexer
 				{
 					return "false";
 				}
+				case lexeme_type::kw_if:
+				{
+					return "'if'";
+				}
+				case lexeme_type::kw_else:
+				{
+					return "'else'";
+				}
+				case lexeme_type::kw_while:
+				{
+					return "'while'";
+				}
 				case lexeme_type::string_literal:
 				{
 					return "<string>";
@@ -160,6 +182,30 @@ namespace seam::compiler::lexer
 				{
 					return "'='";
 				}
+				case lexeme_type::symb_equal:
+				{
+					return "'=='";
+				}
+				case lexeme_type::symb_not_equal:
+				{
+					return "'!='";
+				}
+				case lexeme_type::symb_less:
+				{
+					return "'<'";
+				}
+				case lexeme_type::symb_less_equal:
+				{
+					return "'<='";
+				}
+				case lexeme_type::symb_greater:
+				{
+					return "'>'";
+				}
+				case lexeme_type::symb_greater_equal:
+				{
+					return "'>='";
+				}
 				case lexeme_type::symb_question:
 				{
 					return "'?'";
@@ -172,6 +218,10 @@ namespace seam::compiler::lexer
 				{
 					return "','";
 				}
+				case lexeme_type::symb_dot:
+				{
+					return "'.'";
+				}
 				case lexeme_type::symb_open_parenthesis:
 				{
 					return "'('";
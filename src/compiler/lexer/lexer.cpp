@@ -40,9 +40,16 @@ namespace seam::compiler::lexer
 		{ "}", lexeme::lexeme_type::symb_close_brace },
 		{ "->", lexeme::lexeme_type::symb_arrow },
 		{ "=", lexeme::lexeme_type::symb_equals },
+		{ "==", lexeme::lexeme_type::symb_equal },
+		{ "!=", lexeme::lexeme_type::symb_not_equal },
+		{ "<", lexeme::lexeme_type::symb_less },
+		{ "<=", lexeme::lexeme_type::symb_less_equal },
+		{ ">", lexeme::lexeme_type::symb_greater },
+		{ ">=", lexeme::lexeme_type::symb_greater_equal },
 		{ "?", lexeme::lexeme_type::symb_question },
 		{ ":", lexeme::lexeme_type::symb_colon },
 		{ ",", lexeme::lexeme_type::symb_comma },
+		{ ".", lexeme::lexeme_type::symb_dot },
 	};
 
 	const lexeme_map_t keyword_map
@@ -58,6 +65,9 @@ namespace seam::compiler::lexer
 		{ "throw", lexeme::lexeme_type::kw_throw },
 		{ "true", lexeme::lexeme_type::kw_true },
 		{ "false", lexeme::lexeme_type::kw_false },
+		{ "if", lexeme::lexeme_type::kw_if },
+		{ "else", lexeme::lexeme_type::kw_else },
+		{ "while", lexeme::lexeme_type::kw_while },
 	};
 
 	position lexer::current_position() const
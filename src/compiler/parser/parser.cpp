@@ -3,6 +3,7 @@
 #include "../utils/error.h"
 
 #include <iostream>
+#include <optional>
 #include <sstream>
 
 #include "passes/pass.h"
@@ -37,6 +38,24 @@ llvm::Expected<ir::ast::type> parser::parser::parse_type()
 	auto target_type_name = std::string{ lexer.current_lexeme().value };
 	lexer.next_lexeme();
 
+	// i32[4] is an array, i32[] a slice. they stay part of the name, type_analyzer makes descriptors out of them
+	while (lexer.current_lexeme().type == lexeme_type::symb_open_bracket)
+	{
+		lexer.next_lexeme();
+		target_type_name += '[';
+		if (lexer.current_lexeme().type == lexeme_type::number_literal)
+		{
+			target_type_name += lexer.current_lexeme().value;
+			lexer.next_lexeme();
+		}
+
+		if (auto err = expect(lexeme_type::symb_close_bracket, true))
+		{
+			return std::move(err);
+		}
+		target_type_name += ']';
+	}
+
 	if (lexer.current_lexeme().type == lexer::lexeme::lexeme_type::symb_question)
 	{
 		lexer.next_lexeme();
@@ -151,7 +170,118 @@ llvm::Expected<std::unique_ptr<ir::ast::expression::call>> parser::parser::parse
 	return std::make_unique<ir::ast::expression::call>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(func), std::move(arguments));
 }
 
+namespace
+{
+	struct binary_operator_info
+	{
+		ir::ast::binary_operator op;
+		int precedence;
+	};
+
+	std::optional<binary_operator_info> get_binary_operator(lexeme_type type)
+	{
+		switch (type)
+		{
+			case lexeme_type::symb_equal: return binary_operator_info{ ir::ast::binary_operator::equal, 1 };
+			case lexeme_type::symb_not_equal: return binary_operator_info{ ir::ast::binary_operator::not_equal, 1 };
+			case lexeme_type::symb_less: return binary_operator_info{ ir::ast::binary_operator::less, 1 };
+			case lexeme_type::symb_less_equal: return binary_operator_info{ ir::ast::binary_operator::less_equal, 1 };
+			case lexeme_type::symb_greater: return binary_operator_info{ ir::ast::binary_operator::greater, 1 };
+			case lexeme_type::symb_greater_equal: return binary_operator_info{ ir::ast::binary_operator::greater_equal, 1 };
+			case lexeme_type::symb_add: return binary_operator_info{ ir::ast::binary_operator::add, 2 };
+			case lexeme_type::symb_minus: return binary_operator_info{ ir::ast::binary_operator::subtract, 2 };
+			case lexeme_type::symb_multiply: return binary_operator_info{ ir::ast::binary_operator::multiply, 3 };
+			case lexeme_type::symb_divide: return binary_operator_info{ ir::ast::binary_operator::divide, 3 };
+			default: return std::nullopt;
+		}
+	}
+
+	std::optional<ir::ast::binary_operator> get_compound_assignment_operator(lexeme_type type)
+	{
+		switch (type)
+		{
+			case lexeme_type::symb_add_assign: return ir::ast::binary_operator::add;
+			case lexeme_type::symb_minus_assign: return ir::ast::binary_operator::subtract;
+			case lexeme_type::symb_multiply_assign: return ir::ast::binary_operator::multiply;
+			case lexeme_type::symb_divide_assign: return ir::ast::binary_operator::divide;
+			default: return std::nullopt;
+		}
+	}
+}
+
 llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser::parse_expr()
+{
+	return parse_binary_expr(0);
+}
+
+// precedence climbing, operators of the same precedence are left associative
+llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser::parse_binary_expr(int min_precedence)
+{
+	const auto start = lexer.current_lexeme().pos;
+
+	auto left = parse_unary_expr();
+	if (!left)
+	{
+		return left.takeError();
+	}
+
+	auto expr = std::move(*left);
+	auto operand_line = start.line;
+	while (true)
+	{
+		const auto& lexeme = lexer.current_lexeme();
+		const auto op = get_binary_operator(lexeme.type);
+
+		// an operator on a new line starts a new statement
+		if (!op || op->precedence < min_precedence || lexeme.pos.line != operand_line)
+		{
+			break;
+		}
+
+		lexer.next_lexeme();
+		operand_line = lexer.current_lexeme().pos.line;
+
+		auto right = parse_binary_expr(op->precedence + 1);
+		if (!right)
+		{
+			return right.takeError();
+		}
+
+		expr = std::make_unique<ir::ast::expression::binary>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, op->op, std::move(expr), std::move(*right));
+	}
+
+	return expr;
+}
+
+llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser::parse_unary_expr()
+{
+	const auto start = lexer.current_lexeme().pos;
+	if (lexer.current_lexeme().type != lexeme_type::symb_minus)
+	{
+		return parse_primary_expr();
+	}
+
+	lexer.next_lexeme();
+
+	auto operand = parse_unary_expr();
+	if (!operand)
+	{
+		return operand.takeError();
+	}
+
+	// fold the sign into number literals so the most negative value of a type can be written
+	if (auto number = dynamic_cast<ir::ast::expression::literal<ir::ast::number>*>(operand->get()))
+	{
+		auto& value = number->val.value;
+		value = value.front() == '-' ? value.substr(1) : '-' + value;
+		number->range.start = start;
+		return std::move(*operand);
+	}
+
+	return std::make_unique<ir::ast::expression::unary>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, ir::ast::unary_operator::negate, std::move(*operand));
+}
+
+llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser::parse_primary_expr()
 {	
 	const auto start = lexer.current_lexeme().pos;
 	switch (const auto type = lexer.current_lexeme().type)
@@ -164,13 +294,15 @@ llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser:
 		}
 		case lexeme_type::number_literal:
 		{
+			auto value = std::string{ lexer.current_lexeme().value };
 			lexer.next_lexeme();
-			return std::make_unique<ir::ast::expression::literal<ir::ast::number>>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, ir::ast::number{ std::string{ lexer.current_lexeme().value } } );
+			return std::make_unique<ir::ast::expression::literal<ir::ast::number>>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, ir::ast::number{ std::move(value) } );
 		}
 		case lexeme_type::string_literal:
 		{
+			auto value = std::string{ lexer.current_lexeme().value };
 			lexer.next_lexeme();
-			return std::make_unique<ir::ast::expression::literal<std::string>>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::string{ lexer.current_lexeme().value });
+			return std::make_unique<ir::ast::expression::literal<std::string>>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(value));
 		}
 		case lexeme_type::symb_open_parenthesis:
 		case lexeme_type::identifier:
@@ -196,12 +328,68 @@ llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser:
 						expr = std::move(*call_args);
 						continue;
 					}
+					case lexeme_type::symb_dot:
+					{
+						lexer.next_lexeme();
+						if (auto err = expect(lexeme_type::identifier))
+						{
+							return std::move(err);
+						}
+
+						auto member_name = std::string{ lexer.current_lexeme().value };
+						lexer.next_lexeme();
+						expr = std::make_unique<ir::ast::expression::member_access>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+							std::move(expr), std::move(member_name));
+						continue;
+					}
+					case lexeme_type::symb_open_bracket:
+					{
+						auto access = parse_index_expr(std::move(expr), start);
+						if (!access)
+						{
+							return access.takeError();
+						}
+						expr = std::move(*access);
+						continue;
+					}
 				}
 
 				break;
 			}
 			return expr;
 		}
+		case lexeme_type::symb_open_bracket:
+		{
+			lexer.next_lexeme();
+
+			std::vector<std::unique_ptr<ir::ast::expression::expression>> elements;
+			while (lexer.current_lexeme().type != lexeme_type::symb_close_bracket)
+			{
+				auto element = parse_expr();
+				if (!element)
+				{
+					return element.takeError();
+				}
+				elements.push_back(std::move(*element));
+
+				if (lexer.current_lexeme().type != lexeme_type::symb_comma)
+				{
+					break;
+				}
+				lexer.next_lexeme();
+			}
+
+			if (auto err = expect(lexeme_type::symb_close_bracket, true))
+			{
+				return std::move(err);
+			}
+
+			if (elements.empty())
+			{
+				return llvm::make_error<error_info>(filename, start, "an array literal needs at least one element");
+			}
+			return std::make_unique<ir::ast::expression::array_literal>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(elements));
+		}
 		default:
 		{
 			std::stringstream error_message;
@@ -211,6 +399,54 @@ llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser:
 	}
 }
 
+llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser::parse_index_expr(std::unique_ptr<ir::ast::expression::expression> object, position start)
+{
+	lexer.next_lexeme();
+
+	std::unique_ptr<ir::ast::expression::expression> from;
+	if (lexer.current_lexeme().type != lexeme_type::symb_colon)
+	{
+		auto index = parse_expr();
+		if (!index)
+		{
+			return index.takeError();
+		}
+		from = std::move(*index);
+
+		// a[i]
+		if (lexer.current_lexeme().type != lexeme_type::symb_colon)
+		{
+			if (auto err = expect(lexeme_type::symb_close_bracket, true))
+			{
+				return std::move(err);
+			}
+			return std::make_unique<ir::ast::expression::index_access>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+				std::move(object), std::move(from));
+		}
+	}
+
+	// a[i:j], either end can be left out
+	lexer.next_lexeme();
+
+	std::unique_ptr<ir::ast::expression::expression> to;
+	if (lexer.current_lexeme().type != lexeme_type::symb_close_bracket)
+	{
+		auto end = parse_expr();
+		if (!end)
+		{
+			return end.takeError();
+		}
+		to = std::move(*end);
+	}
+
+	if (auto err = expect(lexeme_type::symb_close_bracket, true))
+	{
+		return std::move(err);
+	}
+	return std::make_unique<ir::ast::expression::slice_access>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+		std::move(object), std::move(from), std::move(to));
+}
+
 llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser::parse_prefix_expr()
 {
 	const auto start = lexer.current_lexeme().pos;
@@ -248,6 +484,56 @@ llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parser::parser:
 	}
 }
 
+llvm::Expected<ir::ast::attribute_map> parser::parser::parse_attributes()
+{
+	ir::ast::attribute_map attributes;
+	while (lexer.current_lexeme().type == lexeme_type::attribute)
+	{
+		const auto attribute_start = lexer.current_lexeme().pos;
+		auto name = std::string{ lexer.current_lexeme().value };
+		lexer.next_lexeme();
+
+		// @repr(C), @align(64), @target_clones("avx2", "default")
+		std::vector<std::string> arguments;
+		if (lexer.current_lexeme().type == lexeme_type::symb_open_parenthesis && lexer.current_lexeme().pos.line == attribute_start.line)
+		{
+			lexer.next_lexeme();
+			while (lexer.current_lexeme().type != lexeme_type::symb_close_parenthesis)
+			{
+				if (lexer.current_lexeme().type != lexeme_type::identifier && lexer.current_lexeme().type != lexeme_type::number_literal
+					&& lexer.current_lexeme().type != lexeme_type::string_literal)
+				{
+					std::stringstream error_message;
+					error_message << "expected attribute argument, got " << lexer.current_lexeme().to_string();
+					return llvm::make_error<error_info>(filename, lexer.current_lexeme().pos, error_message.str());
+				}
+
+				arguments.emplace_back(lexer.current_lexeme().value);
+				lexer.next_lexeme();
+
+				if (lexer.current_lexeme().type != lexeme_type::symb_comma)
+				{
+					break;
+				}
+				lexer.next_lexeme();
+			}
+
+			if (auto err = expect(lexeme_type::symb_close_parenthesis, true))
+			{
+				return std::move(err);
+			}
+		}
+
+		if (attributes.find(name) != attributes.cend())
+		{
+			return llvm::make_error<error_info>(filename, attribute_start, "duplicate attribute '@" + name + "'");
+		}
+		attributes.emplace(std::move(name), std::move(arguments));
+	}
+
+	return attributes;
+}
+
 llvm::Expected<std::unique_ptr<ir::ast::statement::extern_definition>> parser::parser::parse_extern_stat()
 {
 	position start = lexer.current_lexeme().pos;
@@ -301,15 +587,14 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::extern_definition>> parser::p
 		return_type.is_optional = false;
 	}
 
-	std::unordered_set<std::string> attributes;
-	while (lexer.current_lexeme().type == lexeme_type::attribute)
+	auto attributes = parse_attributes();
+	if (!attributes)
 	{
-		attributes.insert(std::string{ lexer.current_lexeme().value });
-		lexer.next_lexeme();
+		return attributes.takeError();
 	}
 
 	return std::make_unique<ir::ast::statement::extern_definition>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::string{ function_name }, std::move(*arg_list),
-		std::move(return_type), std::move(attributes));
+		std::move(return_type), std::move(*attributes));
 }
 
 llvm::Expected<std::unique_ptr<ir::ast::statement::function_definition>> parser::parser::parse_function_definition_stat()
@@ -359,11 +644,10 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::function_definition>> parser:
 		return_type.is_optional = false;
 	}
 
-	std::unordered_set<std::string> attributes;
-	while (lexer.current_lexeme().type == lexeme_type::attribute)
+	auto attributes = parse_attributes();
+	if (!attributes)
 	{
-		attributes.insert(std::string{ lexer.current_lexeme().value });
-		lexer.next_lexeme();
+		return attributes.takeError();
 	}
 
 	if (auto err = expect(lexeme_type::symb_open_brace))
@@ -378,7 +662,7 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::function_definition>> parser:
 	}
 
 	return std::make_unique<ir::ast::statement::function_definition>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::string{ function_name }, std::move(*arg_list),
-		std::move(return_type), std::move(attributes), std::move(*block));
+		std::move(return_type), std::move(*attributes), std::move(*block));
 }
 
 llvm::Expected<std::unique_ptr<ir::ast::statement::type_definition>> parser::parser::parse_type_definition_stat()
@@ -393,10 +677,21 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::type_definition>> parser::par
 
 	lexer.next_lexeme();
 
+	auto attributes = parse_attributes();
+	if (!attributes)
+	{
+		return attributes.takeError();
+	}
+
 	switch (lexer.current_lexeme().type)
 	{
 		case lexeme_type::symb_equals: // type <name> = <existing type>
 		{
+			if (!attributes->empty())
+			{
+				return llvm::make_error<error_info>(filename, start, "type aliases can not have attributes");
+			}
+
 			lexer.next_lexeme();
 
 			auto target_type_desc = parse_type();
@@ -431,8 +726,14 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::type_definition>> parser::par
 					{
 						return type.takeError();
 					}
+
+					auto field_attributes = parse_attributes();
+					if (!field_attributes)
+					{
+						return field_attributes.takeError();
+					}
 		
-					fields.emplace_back(std::move(*type), field_name);
+					fields.emplace_back(std::move(*type), field_name, std::move(*field_attributes));
 				}
 				else
 				{
@@ -453,7 +754,8 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::type_definition>> parser::par
 
 			auto body_stat = std::make_unique<ir::ast::statement::restricted_block>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(body));
 
-			return std::make_unique<ir::ast::statement::class_type_definition>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(fields), std::move(body_stat));
+			return std::make_unique<ir::ast::statement::class_type_definition>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, type_name,
+				std::move(fields), std::move(*attributes), std::move(body_stat));
 		}
 		default:
 		{
@@ -483,6 +785,236 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::ret>> parser::parser::parse_r
 	return std::make_unique<ir::ast::statement::ret>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(expr));
 }
 
+llvm::Expected<std::unique_ptr<ir::ast::statement::if_statement>> parser::parser::parse_if_stat()
+{
+	const auto start = lexer.current_lexeme().pos;
+	lexer.next_lexeme(); // if
+
+	auto condition = parse_expr();
+	if (!condition)
+	{
+		return condition.takeError();
+	}
+
+	if (auto err = expect(lexeme_type::symb_open_brace))
+	{
+		return std::move(err);
+	}
+
+	auto then_body = parse_block_stat();
+	if (!then_body)
+	{
+		return then_body.takeError();
+	}
+
+	std::unique_ptr<ir::ast::statement::statement> else_body;
+	if (lexer.current_lexeme().type == lexeme_type::kw_else)
+	{
+		lexer.next_lexeme();
+
+		if (lexer.current_lexeme().type == lexeme_type::kw_if)
+		{
+			auto else_if = parse_if_stat();
+			if (!else_if)
+			{
+				return else_if.takeError();
+			}
+			else_body = std::move(*else_if);
+		}
+		else
+		{
+			if (auto err = expect(lexeme_type::symb_open_brace))
+			{
+				return std::move(err);
+			}
+
+			auto else_block = parse_block_stat();
+			if (!else_block)
+			{
+				return else_block.takeError();
+			}
+			else_body = std::move(*else_block);
+		}
+	}
+
+	return std::make_unique<ir::ast::statement::if_statement>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+		std::move(*condition), std::move(*then_body), std::move(else_body));
+}
+
+llvm::Expected<std::unique_ptr<ir::ast::statement::while_statement>> parser::parser::parse_while_stat()
+{
+	const auto start = lexer.current_lexeme().pos;
+	lexer.next_lexeme(); // while
+
+	auto condition = parse_expr();
+	if (!condition)
+	{
+		return condition.takeError();
+	}
+
+	if (auto err = expect(lexeme_type::symb_open_brace))
+	{
+		return std::move(err);
+	}
+
+	auto body = parse_block_stat();
+	if (!body)
+	{
+		return body.takeError();
+	}
+
+	return std::make_unique<ir::ast::statement::while_statement>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+		std::move(*condition), std::move(*body));
+}
+
+llvm::Expected<std::unique_ptr<ir::ast::statement::switch_statement>> parser::parser::parse_switch_stat()
+{
+	const auto start = lexer.current_lexeme().pos;
+	lexer.next_lexeme(); // switch
+
+	auto value = parse_expr();
+	if (!value)
+	{
+		return value.takeError();
+	}
+
+	if (auto err = expect(lexeme_type::symb_open_brace, true))
+	{
+		return std::move(err);
+	}
+
+	std::vector<ir::ast::statement::switch_case> cases;
+	std::unique_ptr<ir::ast::statement::block> default_body;
+	while (lexer.current_lexeme().type != lexeme_type::symb_close_brace)
+	{
+		const auto case_start = lexer.current_lexeme().pos;
+
+		if (lexer.current_lexeme().type == lexeme_type::kw_else)
+		{
+			if (default_body)
+			{
+				return llvm::make_error<error_info>(filename, case_start, "switch already has an else case");
+			}
+
+			lexer.next_lexeme();
+			if (auto err = expect(lexeme_type::symb_arrow, true))
+			{
+				return std::move(err);
+			}
+
+			if (auto err = expect(lexeme_type::symb_open_brace))
+			{
+				return std::move(err);
+			}
+
+			auto body = parse_block_stat();
+			if (!body)
+			{
+				return body.takeError();
+			}
+
+			default_body = std::move(*body);
+			continue;
+		}
+
+		std::vector<std::unique_ptr<ir::ast::expression::expression>> labels;
+		while (true)
+		{
+			auto label = parse_expr();
+			if (!label)
+			{
+				return label.takeError();
+			}
+			labels.push_back(std::move(*label));
+
+			if (lexer.current_lexeme().type != lexeme_type::symb_comma)
+			{
+				break;
+			}
+			lexer.next_lexeme();
+		}
+
+		if (auto err = expect(lexeme_type::symb_arrow, true))
+		{
+			return std::move(err);
+		}
+
+		if (auto err = expect(lexeme_type::symb_open_brace))
+		{
+			return std::move(err);
+		}
+
+		auto body = parse_block_stat();
+		if (!body)
+		{
+			return body.takeError();
+		}
+
+		cases.emplace_back(ir::ast::position_range{ case_start, lexer.current_lexeme().pos }, std::move(labels), std::move(*body));
+	}
+	lexer.next_lexeme(); // }
+
+	return std::make_unique<ir::ast::statement::switch_statement>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+		std::move(*value), std::move(cases), std::move(default_body));
+}
+
+llvm::Expected<std::unique_ptr<ir::ast::statement::try_statement>> parser::parser::parse_try_stat()
+{
+	const auto start = lexer.current_lexeme().pos;
+	lexer.next_lexeme(); // try
+
+	if (auto err = expect(lexeme_type::symb_open_brace))
+	{
+		return std::move(err);
+	}
+
+	auto body = parse_block_stat();
+	if (!body)
+	{
+		return body.takeError();
+	}
+
+	if (auto err = expect(lexeme_type::kw_catch, true))
+	{
+		return std::move(err);
+	}
+
+	std::optional<ir::ast::var> catch_variable;
+	if (lexer.current_lexeme().type == lexeme_type::identifier)
+	{
+		catch_variable.emplace(ir::ast::type{ "string", false }, std::string{ lexer.current_lexeme().value });
+		lexer.next_lexeme();
+	}
+
+	if (auto err = expect(lexeme_type::symb_open_brace))
+	{
+		return std::move(err);
+	}
+
+	auto catch_body = parse_block_stat();
+	if (!catch_body)
+	{
+		return catch_body.takeError();
+	}
+
+	return std::make_unique<ir::ast::statement::try_statement>(ir::ast::position_range{ start, lexer.current_lexeme().pos },
+		std::move(*body), std::move(catch_variable), std::move(*catch_body));
+}
+
+llvm::Expected<std::unique_ptr<ir::ast::statement::throw_statement>> parser::parser::parse_throw_stat()
+{
+	const auto start = lexer.current_lexeme().pos;
+	lexer.next_lexeme(); // throw
+
+	auto value = parse_expr();
+	if (!value)
+	{
+		return value.takeError();
+	}
+
+	return std::make_unique<ir::ast::statement::throw_statement>(ir::ast::position_range{ start, lexer.current_lexeme().pos }, std::move(*value));
+}
+
 llvm::Expected<std::unique_ptr<ir::ast::statement::block>> parser::parser::parse_block_stat()
 {
 	position start = lexer.current_lexeme().pos;
@@ -514,6 +1046,61 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::block>> parser::parser::parse
 				body.push_back(std::move(*return_stat));
 				break;
 			}
+			case lexeme_type::kw_if:
+			{
+				auto if_stat = parse_if_stat();
+				if (!if_stat)
+				{
+					return if_stat.takeError();
+				}
+
+				body.push_back(std::move(*if_stat));
+				break;
+			}
+			case lexeme_type::kw_while:
+			{
+				auto while_stat = parse_while_stat();
+				if (!while_stat)
+				{
+					return while_stat.takeError();
+				}
+
+				body.push_back(std::move(*while_stat));
+				break;
+			}
+			case lexeme_type::kw_switch:
+			{
+				auto switch_stat = parse_switch_stat();
+				if (!switch_stat)
+				{
+					return switch_stat.takeError();
+				}
+
+				body.push_back(std::move(*switch_stat));
+				break;
+			}
+			case lexeme_type::kw_try:
+			{
+				auto try_stat = parse_try_stat();
+				if (!try_stat)
+				{
+					return try_stat.takeError();
+				}
+
+				body.push_back(std::move(*try_stat));
+				break;
+			}
+			case lexeme_type::kw_throw:
+			{
+				auto throw_stat = parse_throw_stat();
+				if (!throw_stat)
+				{
+					return throw_stat.takeError();
+				}
+
+				body.push_back(std::move(*throw_stat));
+				break;
+			}
 			default:
 			{
 				auto expr = parse_expr();
@@ -580,8 +1167,45 @@ llvm::Expected<std::unique_ptr<ir::ast::statement::block>> parser::parser::parse
 					continue;
 				}
 
-				if (lexer.current_lexeme().type == lexeme_type::symb_equals) // expresison perhaps?
+				if (const auto op = get_compound_assignment_operator(lexer.current_lexeme().type))
 				{
+					lexer.next_lexeme();
+
+					auto value_expr = parse_expr();
+					if (!value_expr)
+					{
+						err = llvm::joinErrors(std::move(err), value_expr.takeError());
+						while (lexer.current_lexeme().pos.line == stat_start.line
+								&& lexer.current_lexeme().type != lexeme_type::eof)
+						{
+							lexer.next_lexeme();
+						}
+						continue;
+					}
+
+					body.push_back(std::make_unique<ir::ast::statement::compound_assignment>(
+						ir::ast::position_range{ stat_start, lexer.current_lexeme().pos }, std::move(*expr), *op, std::move(*value_expr)));
+					continue;
+				}
+
+				if (lexer.current_lexeme().type == lexeme_type::symb_equals)
+				{
+					lexer.next_lexeme();
+
+					auto value_expr = parse_expr();
+					if (!value_expr)
+					{
+						err = llvm::joinErrors(std::move(err), value_expr.takeError());
+						while (lexer.current_lexeme().pos.line == stat_start.line
+								&& lexer.current_lexeme().type != lexeme_type::eof)
+						{
+							lexer.next_lexeme();
+						}
+						continue;
+					}
+
+					body.push_back(std::make_unique<ir::ast::statement::variable_assignment>(
+						ir::ast::position_range{ stat_start, lexer.current_lexeme().pos }, std::move(*expr), std::move(*value_expr)));
 					continue;
 				}
 
@@ -27,12 +27,24 @@ namespace seam::compiler::parser
 		
 		llvm::Expected<std::unique_ptr<ir::ast::expression::call>> parse_call_expr_args(std::unique_ptr<ir::ast::expression::expression> func);
 		llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parse_expr();
+		llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parse_binary_expr(int min_precedence);
+		llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parse_unary_expr();
+		llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parse_primary_expr();
 		llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parse_prefix_expr();
+		// a[i] or a[i:j], the current lexeme is the '['
+		llvm::Expected<std::unique_ptr<ir::ast::expression::expression>> parse_index_expr(std::unique_ptr<ir::ast::expression::expression> object, position start);
+
+		llvm::Expected<ir::ast::attribute_map> parse_attributes();
 
 		llvm::Expected<std::unique_ptr<ir::ast::statement::extern_definition>> parse_extern_stat();
 		llvm::Expected<std::unique_ptr<ir::ast::statement::function_definition>> parse_function_definition_stat();
 		llvm::Expected<std::unique_ptr<ir::ast::statement::type_definition>> parse_type_definition_stat();
 		llvm::Expected<std::unique_ptr<ir::ast::statement::ret>> parse_return_stat();
+		llvm::Expected<std::unique_ptr<ir::ast::statement::if_statement>> parse_if_stat();
+		llvm::Expected<std::unique_ptr<ir::ast::statement::while_statement>> parse_while_stat();
+		llvm::Expected<std::unique_ptr<ir::ast::statement::switch_statement>> parse_switch_stat();
+		llvm::Expected<std::unique_ptr<ir::ast::statement::try_statement>> parse_try_stat();
+		llvm::Expected<std::unique_ptr<ir::ast::statement::throw_statement>> parse_throw_stat();
 		llvm::Expected<std::unique_ptr<ir::ast::statement::block>> parse_block_stat();
 		llvm::Expected<std::unique_ptr<ir::ast::statement::restricted_statement>> parse_restricted_stat();
 		llvm::Expected<std::unique_ptr<ir::ast::statement::restricted_block>> parse_block_restricted_stat();
@@ -0,0 +1,251 @@
+#include "attribute_checker.h"
+
+#include "../../utils/exception.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+using namespace seam::compiler;
+
+namespace
+{
+	struct attribute_rule
+	{
+		const char* name;
+		std::size_t min_arguments;
+		std::size_t max_arguments;
+		bool needs_body; // says something about the code of the function, meaningless on an extern
+	};
+
+	constexpr attribute_rule attribute_rules[] =
+	{
+		{ "constructor", 0, 0, false },
+		{ "export", 0, 0, false },
+		{ "comptime", 0, 0, false },
+		{ "target_clones", 1, SIZE_MAX, true },
+		{ "inline", 0, 0, true },
+		{ "noinline", 0, 0, true },
+		{ "flatten", 0, 0, true },
+		{ "hot", 0, 0, false },
+		{ "cold", 0, 0, false },
+		{ "noreturn", 0, 0, false },
+		{ "pure", 0, 0, false },
+		{ "fast_math", 0, 0, true },
+		{ "fp", 1, SIZE_MAX, true },
+		{ "unchecked", 0, 0, true }, // no bounds checks on indexing, slicing, load and store and no division checks
+	};
+
+	// @fp(reassoc, contract), the llvm fast math flags by their names in the ir
+	constexpr const char* fp_options[] = { "reassoc", "contract", "nnan", "ninf", "nsz", "arcp", "afn" };
+
+	constexpr std::pair<const char*, const char*> conflicting_attributes[] =
+	{
+		{ "inline", "noinline" },
+		{ "hot", "cold" },
+		{ "inline", "target_clones" }, // calls go through the dispatch, there is no single body to inline
+		{ "fast_math", "fp" }, // @fast_math already allows everything
+	};
+
+	bool has_attribute(ir::ast::statement::function_declaration* node, const char* name)
+	{
+		return node->attributes.find(name) != node->attributes.cend();
+	}
+
+	// of locals and what's reached from them through indices and fields, nullptr when only literal_typer can tell
+	ir::types::type_descriptor* declared_type(ir::ast::expression::expression* expr)
+	{
+		if (auto var_expr = dynamic_cast<ir::ast::expression::variable*>(expr))
+		{
+			auto local = dynamic_cast<ir::ast::expression::local_variable*>(var_expr->var.get());
+			auto type_ref = local ? std::get_if<ir::types::type_reference>(&local->def->type_) : nullptr;
+			return type_ref ? type_ref->type.get() : nullptr;
+		}
+
+		if (auto access = dynamic_cast<ir::ast::expression::index_access*>(expr))
+		{
+			auto element = ir::types::element_type(declared_type(access->object.get()));
+			return element ? element->get() : nullptr;
+		}
+
+		if (auto member = dynamic_cast<ir::ast::expression::member_access*>(expr))
+		{
+			auto class_desc = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(declared_type(member->object.get())));
+			auto field = class_desc ? class_desc->find_field(member->name) : std::nullopt;
+			return field ? class_desc->fields[*field].type.type.get() : nullptr;
+		}
+		return nullptr;
+	}
+
+	// s[i] = x and s[i].y = x store to memory the caller can see, a[i] = x only changes the local array
+	bool writes_through_slice(ir::ast::expression::expression* target)
+	{
+		while (true)
+		{
+			if (auto member = dynamic_cast<ir::ast::expression::member_access*>(target))
+			{
+				target = member->object.get();
+			}
+			else if (auto access = dynamic_cast<ir::ast::expression::index_access*>(target))
+			{
+				if (!ir::types::as_array(declared_type(access->object.get())))
+				{
+					return true;
+				}
+				target = access->object.get();
+			}
+			else
+			{
+				return false;
+			}
+		}
+	}
+}
+
+void parser::attribute_checker::check(ir::ast::statement::function_declaration* node, bool is_definition)
+{
+	for (const auto& [name, arguments] : node->attributes)
+	{
+		auto rule = std::find_if(std::begin(attribute_rules), std::end(attribute_rules), [&](const attribute_rule& r) { return name == r.name; });
+		if (rule == std::end(attribute_rules))
+		{
+			throw exception(node->range.start, "unknown attribute '@" + name + "' on function '" + node->name + "'");
+		}
+
+		if (arguments.size() < rule->min_arguments || arguments.size() > rule->max_arguments)
+		{
+			throw exception(node->range.start, rule->max_arguments == 0 ? "'@" + name + "' does not take arguments" : "'@" + name + "' needs arguments");
+		}
+
+		if (rule->needs_body && !is_definition)
+		{
+			throw exception(node->range.start, "'@" + name + "' can not be used on extern function '" + node->name + "'");
+		}
+	}
+
+	for (const auto& [first, second] : conflicting_attributes)
+	{
+		if (has_attribute(node, first) && has_attribute(node, second))
+		{
+			throw exception(node->range.start, std::string{ "'@" } + first + "' and '@" + second + "' can not be combined");
+		}
+	}
+
+	if (auto fp = node->attributes.find("fp"); fp != node->attributes.cend())
+	{
+		for (const auto& option : fp->second)
+		{
+			if (std::none_of(std::begin(fp_options), std::end(fp_options), [&](const char* name) { return option == name; }))
+			{
+				throw exception(node->range.start, "unknown option '" + option + "' in @fp, expected reassoc, contract, nnan, ninf, nsz, arcp or afn");
+			}
+		}
+	}
+
+	if (has_attribute(node, "noreturn"))
+	{
+		auto return_type = std::get_if<ir::types::type_reference>(&node->return_type);
+		if (return_type && !ir::types::is_built_in<void>(return_type->type.get()))
+		{
+			throw exception(node->range.start, "@noreturn function '" + node->name + "' can not have a return type");
+		}
+	}
+}
+
+bool parser::attribute_checker::visit(ir::ast::statement::extern_definition* node)
+{
+	check(node, false);
+	return false;
+}
+
+bool parser::attribute_checker::visit(ir::ast::statement::function_definition* node)
+{
+	check(node, true);
+
+	pure_function = has_attribute(node, "pure") ? node : nullptr;
+	node->visit_children(this);
+	pure_function = nullptr;
+	return false;
+}
+
+bool parser::attribute_checker::visit(ir::ast::statement::throw_statement* node)
+{
+	if (pure_function)
+	{
+		throw exception(node->range.start, "@pure function '" + pure_function->name + "' can not throw");
+	}
+	return true;
+}
+
+bool parser::attribute_checker::visit(ir::ast::expression::call* node)
+{
+	if (!pure_function)
+	{
+		return true;
+	}
+
+	auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get());
+	if (auto builtin = callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr)
+	{
+		const auto is_memory = builtin->kind == ir::ast::builtin::load || builtin->kind == ir::ast::builtin::store;
+		if (is_memory && !has_attribute(pure_function, "unchecked"))
+		{
+			throw exception(node->range.start, "@pure function '" + pure_function->name + "' has to be @unchecked to use '" + builtin->name + "', a failed bounds check throws");
+		}
+		else if (ir::ast::can_throw(builtin->kind) && !is_memory)
+		{
+			throw exception(node->range.start, "@pure function '" + pure_function->name + "' can not use '" + builtin->name + "', it throws on overflow");
+		}
+
+		// store(s, i, v) writes to memory the caller can see, store(a, i, v) only changes the local array
+		if (builtin->kind == ir::ast::builtin::store && !node->arguments.empty() && !ir::types::as_array(declared_type(node->arguments.front().get())))
+		{
+			throw exception(node->range.start, "@pure function '" + pure_function->name + "' can not write through a slice");
+		}
+		return true;
+	}
+
+	auto callee = callee_var ? dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()) : nullptr;
+	if (!callee || !has_attribute(callee->def_stat, "pure"))
+	{
+		throw exception(node->range.start, "@pure function '" + pure_function->name + "' can only call @pure functions");
+	}
+	return true;
+}
+
+bool parser::attribute_checker::visit(ir::ast::statement::variable_assignment* node)
+{
+	if (pure_function && writes_through_slice(node->target.get()))
+	{
+		throw exception(node->range.start, "@pure function '" + pure_function->name + "' can not write through a slice");
+	}
+	return true;
+}
+
+bool parser::attribute_checker::visit(ir::ast::statement::compound_assignment* node)
+{
+	if (pure_function && writes_through_slice(node->target.get()))
+	{
+		throw exception(node->range.start, "@pure function '" + pure_function->name + "' can not write through a slice");
+	}
+	return true;
+}
+
+bool parser::attribute_checker::visit(ir::ast::expression::index_access* node)
+{
+	if (pure_function && !has_attribute(pure_function, "unchecked"))
+	{
+		throw exception(node->range.start, "@pure function '" + pure_function->name + "' has to be @unchecked to index, a failed bounds check throws");
+	}
+	return true;
+}
+
+bool parser::attribute_checker::visit(ir::ast::expression::slice_access* node)
+{
+	if (pure_function && !has_attribute(pure_function, "unchecked"))
+	{
+		throw exception(node->range.start, "@pure function '" + pure_function->name + "' has to be @unchecked to slice, a failed bounds check throws");
+	}
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../../ir/ast/ast.h"
+
+namespace seam::compiler::parser
+{
+	// rejects unknown function attributes, wrong arguments and combinations that contradict each other.
+	// a @pure function may only call other @pure functions, can't throw and can't write through slices,
+	// so it needs to run after variable_resolver
+	class attribute_checker : public ir::ast::visitor
+	{
+		ir::ast::statement::function_definition* pure_function = nullptr; // the one being checked, if it's @pure
+
+		void check(ir::ast::statement::function_declaration* node, bool is_definition);
+	public:
+		bool visit(ir::ast::statement::extern_definition* node) override;
+		bool visit(ir::ast::statement::function_definition* node) override;
+		bool visit(ir::ast::statement::throw_statement* node) override;
+		bool visit(ir::ast::statement::variable_assignment* node) override;
+		bool visit(ir::ast::statement::compound_assignment* node) override;
+		bool visit(ir::ast::expression::call* node) override;
+		bool visit(ir::ast::expression::index_access* node) override;
+		bool visit(ir::ast::expression::slice_access* node) override;
+	};
+}
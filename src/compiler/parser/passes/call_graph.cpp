@@ -0,0 +1,69 @@
+#include "call_graph.h"
+
+#include <vector>
+
+using namespace seam::compiler;
+
+bool parser::call_graph::visit(ir::ast::statement::extern_definition* node)
+{
+	callees[node];
+	return false;
+}
+
+bool parser::call_graph::visit(ir::ast::statement::function_definition* node)
+{
+	callees[node];
+
+	current = node;
+	node->visit_children(this);
+	current = nullptr;
+	return false;
+}
+
+bool parser::call_graph::visit(ir::ast::expression::function_variable* node)
+{
+	if (current)
+	{
+		callees[current].insert(node->def_stat);
+	}
+	return false;
+}
+
+std::unordered_set<ir::ast::statement::function_declaration*> parser::call_graph::reachable() const
+{
+	std::unordered_set<ir::ast::statement::function_declaration*> visited;
+	std::vector<ir::ast::statement::function_declaration*> worklist;
+
+	for (const auto& [func, _] : callees)
+	{
+		if (func->attributes.find("constructor") != func->attributes.cend()
+			|| func->attributes.find("export") != func->attributes.cend())
+		{
+			worklist.push_back(func);
+		}
+	}
+
+	while (!worklist.empty())
+	{
+		auto func = worklist.back();
+		worklist.pop_back();
+
+		if (!visited.insert(func).second)
+		{
+			continue;
+		}
+
+		auto it = callees.find(func);
+		if (it == callees.end())
+		{
+			continue;
+		}
+
+		for (auto callee : it->second)
+		{
+			worklist.push_back(callee);
+		}
+	}
+
+	return visited;
+}
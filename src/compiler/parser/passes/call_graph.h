@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../../ir/ast/ast.h"
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SetVector.h>
+
+#include <unordered_set>
+
+namespace seam::compiler::parser
+{
+	// needs to run after variable_resolver, edges come from the resolved function_variable links
+	class call_graph : public ir::ast::visitor
+	{
+		ir::ast::statement::function_declaration* current = nullptr;
+	public:
+		// every function mapped to the functions it references, both in source order
+		llvm::MapVector<ir::ast::statement::function_declaration*, llvm::SetVector<ir::ast::statement::function_declaration*>> callees;
+
+		bool visit(ir::ast::statement::extern_definition* node) override;
+		bool visit(ir::ast::statement::function_definition* node) override;
+		bool visit(ir::ast::expression::function_variable* node) override;
+
+		// functions reachable from the module constructor and exported functions
+		std::unordered_set<ir::ast::statement::function_declaration*> reachable() const;
+	};
+}
@@ -0,0 +1,159 @@
+#include "constant_folder.h"
+
+#include "../../comptime/interpreter.h"
+#include "../../utils/exception.h"
+
+#include <set>
+
+using namespace seam::compiler;
+
+void parser::constant_folder::fold(std::unique_ptr<ir::ast::expression::expression>& expr)
+{
+	if (auto binary = dynamic_cast<ir::ast::expression::binary*>(expr.get()))
+	{
+		fold(binary->left);
+		fold(binary->right);
+
+		auto left = comptime::literal_value(binary->left.get());
+		auto right = comptime::literal_value(binary->right.get());
+		if (!left || !right)
+		{
+			return;
+		}
+
+		if (auto result = comptime::apply(binary->op, *left, *right))
+		{
+			expr = comptime::make_literal(*result, binary->range);
+		}
+		else if (binary->op == ir::ast::binary_operator::divide && ir::types::is_integer(binary->type.get()))
+		{
+			throw exception(binary->range.start, "integer division by zero or overflow in constant expression");
+		}
+	}
+	else if (auto unary = dynamic_cast<ir::ast::expression::unary*>(expr.get()))
+	{
+		fold(unary->operand);
+
+		if (auto operand = comptime::literal_value(unary->operand.get()))
+		{
+			if (auto result = comptime::apply(unary->op, *operand))
+			{
+				expr = comptime::make_literal(*result, unary->range);
+			}
+		}
+	}
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::variable_declaration* node)
+{
+	fold(node->value);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::variable_assignment* node)
+{
+	fold(node->value);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::compound_assignment* node)
+{
+	fold(node->value);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::expression_statement* node)
+{
+	fold(node->expr);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::if_statement* node)
+{
+	fold(node->condition);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::while_statement* node)
+{
+	fold(node->condition);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::switch_statement* node)
+{
+	fold(node->value);
+
+	std::set<comptime::value> seen;
+	for (auto& switch_case : node->cases)
+	{
+		for (auto& label : switch_case.labels)
+		{
+			fold(label);
+
+			auto label_value = comptime::literal_value(label.get());
+			if (!label_value)
+			{
+				throw exception(label->range.start, "case label has to be a constant");
+			}
+
+			if (!seen.insert(std::move(*label_value)).second)
+			{
+				throw exception(label->range.start, "duplicate case label");
+			}
+		}
+	}
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::throw_statement* node)
+{
+	fold(node->value);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::statement::ret* node)
+{
+	if (node->value)
+	{
+		fold(node->value);
+	}
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::expression::call* node)
+{
+	for (auto& arg : node->arguments)
+	{
+		fold(arg);
+	}
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::expression::index_access* node)
+{
+	fold(node->index);
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::expression::slice_access* node)
+{
+	if (node->from)
+	{
+		fold(node->from);
+	}
+	if (node->to)
+	{
+		fold(node->to);
+	}
+	return true;
+}
+
+bool parser::constant_folder::visit(ir::ast::expression::array_literal* node)
+{
+	for (auto& element : node->elements)
+	{
+		fold(element);
+	}
+	return true;
+}
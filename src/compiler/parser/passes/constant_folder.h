@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../../ir/ast/ast.h"
+
+namespace seam::compiler::parser
+{
+	// collapses operator expressions on literals into a single literal, needs to run after literal_typer
+	class constant_folder : public ir::ast::visitor
+	{
+		void fold(std::unique_ptr<ir::ast::expression::expression>& expr);
+	public:
+		bool visit(ir::ast::statement::variable_declaration* node) override;
+		bool visit(ir::ast::statement::variable_assignment* node) override;
+		bool visit(ir::ast::statement::compound_assignment* node) override;
+		bool visit(ir::ast::statement::expression_statement* node) override;
+		bool visit(ir::ast::statement::if_statement* node) override;
+		bool visit(ir::ast::statement::while_statement* node) override;
+		bool visit(ir::ast::statement::switch_statement* node) override;
+		bool visit(ir::ast::statement::throw_statement* node) override;
+		bool visit(ir::ast::statement::ret* node) override;
+		bool visit(ir::ast::expression::call* node) override;
+		bool visit(ir::ast::expression::index_access* node) override;
+		bool visit(ir::ast::expression::slice_access* node) override;
+		bool visit(ir::ast::expression::array_literal* node) override;
+	};
+}
@@ -0,0 +1,355 @@
+#include "effect_analysis.h"
+
+using namespace seam::compiler;
+
+namespace
+{
+	// s[i] = x goes to memory the caller can see, a[i] = x only to the stack slot of a local array
+	bool writes_through_slice(ir::ast::expression::expression* target)
+	{
+		while (true)
+		{
+			if (auto member = dynamic_cast<ir::ast::expression::member_access*>(target))
+			{
+				target = member->object.get();
+			}
+			else if (auto access = dynamic_cast<ir::ast::expression::index_access*>(target))
+			{
+				if (ir::types::as_slice(access->object_type.get()))
+				{
+					return true;
+				}
+				target = access->object.get();
+			}
+			else
+			{
+				return false;
+			}
+		}
+	}
+
+	// the local whose array a[i].x = y and a[:] point into, nullptr when a slice is in between
+	const ir::ast::var* get_array_root(ir::ast::expression::expression* target)
+	{
+		while (true)
+		{
+			if (auto member = dynamic_cast<ir::ast::expression::member_access*>(target))
+			{
+				target = member->object.get();
+			}
+			else if (auto access = dynamic_cast<ir::ast::expression::index_access*>(target); access && ir::types::as_array(access->object_type.get()))
+			{
+				target = access->object.get();
+			}
+			else
+			{
+				auto variable = dynamic_cast<ir::ast::expression::variable*>(target);
+				auto local = variable ? dynamic_cast<ir::ast::expression::local_variable*>(variable->var.get()) : nullptr;
+				return local ? local->def : nullptr;
+			}
+		}
+	}
+}
+
+void parser::effect_analysis::set_modified(ir::ast::expression::expression* target)
+{
+	auto root = get_array_root(target);
+	if (!current_function || !root)
+	{
+		return;
+	}
+
+	auto& arguments = current_function->arguments;
+	for (std::size_t i = 0; i < arguments.size(); ++i)
+	{
+		if (&arguments[i] == root)
+		{
+			current->own.modified[i] = true;
+		}
+	}
+}
+
+void parser::effect_analysis::add_check()
+{
+	current->own.unwinds |= try_depth == 0;
+	current->own.reads_memory = true;
+	current->own.writes_memory = true;
+	current->own.may_not_return |= try_depth == 0;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::extern_definition* node)
+{
+	// @pure is a promise about the code behind it, nothing else is known
+	auto& own = functions[node].own;
+	own.unwinds = true;
+	own.reads_memory = true;
+	own.writes_memory = node->attributes.find("pure") == node->attributes.cend();
+	own.writes_slices = own.writes_memory;
+	own.may_not_return = true;
+	return false;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::function_definition* node)
+{
+	current = &functions[node];
+	current->own.captured.assign(node->arguments.size(), false);
+	current->own.modified.assign(node->arguments.size(), false);
+	current_function = node;
+	node->visit_children(this);
+	current_function = nullptr;
+	current = nullptr;
+	borrows.clear();
+	return false;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::while_statement*)
+{
+	if (current)
+	{
+		current->own.may_not_return = true;
+	}
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::switch_statement* node)
+{
+	// comparing against string labels looks at the bytes
+	if (current && ir::types::is_built_in<std::string>(node->type.get()))
+	{
+		current->own.reads_memory = true;
+		borrows.insert(node->value.get());
+	}
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::try_statement* node)
+{
+	// the catch hands the exception back to the runtime, which frees it
+	if (current)
+	{
+		current->own.reads_memory = true;
+		current->own.writes_memory = true;
+	}
+
+	++try_depth;
+	node->body->visit(this);
+	--try_depth;
+
+	node->catch_body->visit(this);
+	return false;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::throw_statement*)
+{
+	if (current)
+	{
+		current->own.unwinds |= try_depth == 0;
+		current->own.reads_memory = true;
+		current->own.writes_memory = true;
+		current->own.may_not_return |= try_depth == 0;
+	}
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::variable_assignment* node)
+{
+	if (current && writes_through_slice(node->target.get()))
+	{
+		current->own.writes_memory = true;
+		current->own.writes_slices = true;
+	}
+	set_modified(node->target.get());
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::statement::compound_assignment* node)
+{
+	if (current && writes_through_slice(node->target.get()))
+	{
+		current->own.writes_memory = true;
+		current->own.writes_slices = true;
+	}
+
+	if (current && node->checked && node->op == ir::ast::binary_operator::divide)
+	{
+		add_check();
+	}
+	set_modified(node->target.get());
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::expression::binary* node)
+{
+	if (current && node->checked && node->op == ir::ast::binary_operator::divide)
+	{
+		add_check();
+	}
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::expression::index_access* node)
+{
+	if (!current)
+	{
+		return true;
+	}
+
+	borrows.insert(node->object.get());
+	if (node->checked)
+	{
+		add_check();
+	}
+
+	if (ir::types::as_slice(node->object_type.get()))
+	{
+		current->own.reads_memory = true;
+	}
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::expression::slice_access* node)
+{
+	if (current && node->checked)
+	{
+		add_check();
+	}
+
+	// the slice can be written through
+	set_modified(node->object.get());
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::expression::variable* node)
+{
+	auto local = dynamic_cast<ir::ast::expression::local_variable*>(node->var.get());
+	if (!current_function || !local || borrows.count(node))
+	{
+		return true;
+	}
+
+	auto& arguments = current_function->arguments;
+	for (std::size_t i = 0; i < arguments.size(); ++i)
+	{
+		if (&arguments[i] == local->def)
+		{
+			current->own.captured[i] = true;
+		}
+	}
+	return true;
+}
+
+bool parser::effect_analysis::visit(ir::ast::expression::call* node)
+{
+	if (!current)
+	{
+		return true;
+	}
+
+	auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get());
+	auto callee = callee_var ? dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()) : nullptr;
+	if (callee)
+	{
+		current->callees.insert(callee->def_stat);
+		if (try_depth == 0)
+		{
+			current->unwinding_callees.insert(callee->def_stat);
+		}
+	}
+	else if (auto builtin = callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr)
+	{
+		// a failed check throws, the rest compiles to plain instructions
+		if (ir::ast::can_throw(builtin->kind) && builtin->checked)
+		{
+			add_check();
+		}
+		else if (builtin->kind == ir::ast::builtin::prefetch)
+		{
+			current->own.reads_memory = true;
+		}
+
+		const auto is_memory = builtin->kind == ir::ast::builtin::load || builtin->kind == ir::ast::builtin::store;
+		if ((is_memory || builtin->kind == ir::ast::builtin::len || builtin->kind == ir::ast::builtin::prefetch) && !node->arguments.empty())
+		{
+			borrows.insert(node->arguments.front().get());
+		}
+
+		// like s[i] and s[i] = x, only a slice is memory the caller can see
+		const auto is_slice = ir::types::as_slice(builtin->operand_type.get());
+		if (builtin->kind == ir::ast::builtin::load && is_slice)
+		{
+			current->own.reads_memory = true;
+		}
+		else if (builtin->kind == ir::ast::builtin::store && (is_slice || writes_through_slice(node->arguments.front().get())))
+		{
+			current->own.writes_memory = true;
+			current->own.writes_slices = true;
+		}
+
+		if (builtin->kind == ir::ast::builtin::store)
+		{
+			set_modified(node->arguments.front().get());
+		}
+	}
+	else
+	{
+		current->own.unwinds |= try_depth == 0;
+		current->own.reads_memory = true;
+		current->own.writes_memory = true;
+		current->own.writes_slices = true;
+		current->own.may_not_return = true;
+	}
+	return true;
+}
+
+std::unordered_map<ir::ast::statement::function_declaration*, parser::effect_analysis::effects> parser::effect_analysis::infer() const
+{
+	std::unordered_map<ir::ast::statement::function_declaration*, effects> result;
+	for (const auto& [func, info] : functions)
+	{
+		result[func] = info.own;
+
+		// returning is proven from the callees up, so a cycle of calls never does
+		result[func].may_not_return = true;
+	}
+
+	// spread to the callers until nothing changes, recursion on its own doesn't unwind or touch memory
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (const auto& [func, info] : functions)
+		{
+			auto& func_effects = result[func];
+			auto update = [&](bool& effect, bool value)
+			{
+				if (value && !effect)
+				{
+					effect = true;
+					changed = true;
+				}
+			};
+
+			for (auto callee : info.callees)
+			{
+				const auto& callee_effects = result[callee];
+				update(func_effects.reads_memory, callee_effects.reads_memory);
+				update(func_effects.writes_memory, callee_effects.writes_memory);
+				update(func_effects.writes_slices, callee_effects.writes_slices);
+			}
+
+			for (auto callee : info.unwinding_callees)
+			{
+				update(func_effects.unwinds, result[callee].unwinds);
+			}
+
+			if (func_effects.may_not_return && !info.own.may_not_return
+				&& llvm::none_of(info.callees, [&](ir::ast::statement::function_declaration* callee) { return result[callee].may_not_return; }))
+			{
+				func_effects.may_not_return = false;
+				changed = true;
+			}
+		}
+	}
+
+	return result;
+}
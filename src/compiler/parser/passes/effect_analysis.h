@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../../ir/ast/ast.h"
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SetVector.h>
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace seam::compiler::parser
+{
+	// works out what calling a function can do, bottom up over the call graph. needs to run after variable_resolver.
+	// seam values live in registers or the stack slots of local arrays, memory the caller can see is only touched by the bytes
+	// of a string, the elements of a slice, the exception runtime and extern functions. big arrays passed by pointer are left to `modified`.
+	// extern functions and calls to something other than a known function are assumed to do anything
+	class effect_analysis : public ir::ast::visitor
+	{
+	public:
+		struct effects
+		{
+			bool unwinds = false; // an exception can escape, throws and calls inside a try body are caught there
+			bool reads_memory = false;
+			bool writes_memory = false;
+			// through a slice or in an extern function, which might be an array passed by pointer. exceptions only write the runtime's memory
+			bool writes_slices = false;
+			bool may_not_return = false; // loops, recursion and exceptions leaving the function, an uncaught one aborts
+			// per argument, a string or slice the function uses for more than s[i], len(s) and the like, which may keep its pointer
+			std::vector<bool> captured;
+			// per argument, an array the function assigns to, stores to or slices. big ones are passed by pointer,
+			// the caller only has to hand over a copy when it's changed
+			std::vector<bool> modified;
+		};
+	private:
+		struct function_info
+		{
+			effects own; // of the body alone
+			llvm::SetVector<ir::ast::statement::function_declaration*> callees;
+			llvm::SetVector<ir::ast::statement::function_declaration*> unwinding_callees; // called outside of a try
+		};
+
+		llvm::MapVector<ir::ast::statement::function_declaration*, function_info> functions;
+		function_info* current = nullptr;
+		ir::ast::statement::function_definition* current_function = nullptr;
+		std::size_t try_depth = 0;
+		// uses of a local that only look at what it points to, s in s[i] and len(s), found before the variable itself is visited
+		std::unordered_set<const ir::ast::expression::expression*> borrows;
+
+		void set_modified(ir::ast::expression::expression* target);
+		// a failed check throws, which also takes the exception runtime
+		void add_check();
+	public:
+		bool visit(ir::ast::statement::extern_definition* node) override;
+		bool visit(ir::ast::statement::function_definition* node) override;
+		bool visit(ir::ast::statement::while_statement* node) override;
+		bool visit(ir::ast::statement::switch_statement* node) override;
+		bool visit(ir::ast::statement::try_statement* node) override;
+		bool visit(ir::ast::statement::throw_statement* node) override;
+		bool visit(ir::ast::statement::variable_assignment* node) override;
+		bool visit(ir::ast::statement::compound_assignment* node) override;
+		bool visit(ir::ast::expression::binary* node) override;
+		bool visit(ir::ast::expression::call* node) override;
+		bool visit(ir::ast::expression::index_access* node) override;
+		bool visit(ir::ast::expression::slice_access* node) override;
+		bool visit(ir::ast::expression::variable* node) override;
+
+		// the effects of every function along with the ones of everything it calls
+		std::unordered_map<ir::ast::statement::function_declaration*, effects> infer() const;
+	};
+}
@@ -0,0 +1,1180 @@
+#include "literal_typer.h"
+
+#include "../../utils/exception.h"
+
+#include <charconv>
+#include <limits>
+#include <sstream>
+
+using namespace seam::compiler;
+
+namespace
+{
+	struct number_parts
+	{
+		bool negative = false;
+		bool is_float = false;
+		int base = 10;
+		std::string digits; // without sign, prefix and separators
+	};
+
+	number_parts split_number(const ir::ast::expression::literal<ir::ast::number>* node)
+	{
+		number_parts parts;
+
+		std::string_view value = node->val.value;
+		if (!value.empty() && value.front() == '-')
+		{
+			parts.negative = true;
+			value.remove_prefix(1);
+		}
+
+		if (value.size() > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X'))
+		{
+			parts.base = 16;
+			value.remove_prefix(2);
+		}
+
+		parts.digits.reserve(value.size());
+		for (const auto c : value)
+		{
+			if (c == '_')
+			{
+				continue;
+			}
+
+			if (c == '.')
+			{
+				parts.is_float = true;
+			}
+			parts.digits.push_back(c);
+		}
+
+		if (parts.digits.empty() || parts.digits.front() == '.' || parts.digits.back() == '.')
+		{
+			throw exception(node->range.start, "malformed number '" + node->val.value + "'");
+		}
+
+		return parts;
+	}
+
+	std::uint64_t parse_magnitude(const ir::ast::expression::literal<ir::ast::number>* node, const number_parts& parts)
+	{
+		std::uint64_t magnitude = 0;
+		const auto digits_end = parts.digits.data() + parts.digits.size();
+
+		const auto [end, ec] = std::from_chars(parts.digits.data(), digits_end, magnitude, parts.base);
+		if (ec == std::errc::result_out_of_range)
+		{
+			throw exception(node->range.start, "number '" + node->val.value + "' does not fit in 64 bits");
+		}
+
+		if (ec != std::errc{} || end != digits_end)
+		{
+			throw exception(node->range.start, "malformed number '" + node->val.value + "'");
+		}
+
+		return magnitude;
+	}
+
+	template <typename T>
+	bool fits(bool negative, std::uint64_t magnitude)
+	{
+		if constexpr (std::is_signed_v<T>)
+		{
+			const auto max = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+			return negative ? magnitude <= max + 1 : magnitude <= max;
+		}
+		else
+		{
+			return (!negative || magnitude == 0) && magnitude <= std::numeric_limits<T>::max();
+		}
+	}
+
+	template <typename T>
+	std::unique_ptr<ir::ast::expression::expression> make_integer(const ir::ast::expression::literal<ir::ast::number>* node, const number_parts& parts, const std::string& type_name)
+	{
+		if (parts.is_float)
+		{
+			throw exception(node->range.start, "expected integer for type '" + type_name + "', got '" + node->val.value + "'");
+		}
+
+		const auto magnitude = parse_magnitude(node, parts);
+		if (!fits<T>(parts.negative, magnitude))
+		{
+			throw exception(node->range.start, "number '" + node->val.value + "' is out of range for type '" + type_name + "'");
+		}
+
+		// unsigned negation wraps, the conversion back gives the two's complement value
+		const auto value = static_cast<T>(parts.negative ? 0 - magnitude : magnitude);
+		return std::make_unique<ir::ast::expression::literal<T>>(node->range, value);
+	}
+
+	template <typename T>
+	std::unique_ptr<ir::ast::expression::expression> make_float(const ir::ast::expression::literal<ir::ast::number>* node, const number_parts& parts, const std::string& type_name)
+	{
+		if (parts.base != 10)
+		{
+			throw exception(node->range.start, "hexadecimal number '" + node->val.value + "' can not be used as type '" + type_name + "'");
+		}
+
+		T value{};
+		const auto digits_end = parts.digits.data() + parts.digits.size();
+
+		const auto [end, ec] = std::from_chars(parts.digits.data(), digits_end, value);
+		if (ec == std::errc::result_out_of_range)
+		{
+			throw exception(node->range.start, "number '" + node->val.value + "' is out of range for type '" + type_name + "'");
+		}
+
+		if (ec != std::errc{} || end != digits_end)
+		{
+			throw exception(node->range.start, "malformed number '" + node->val.value + "'");
+		}
+
+		return std::make_unique<ir::ast::expression::literal<T>>(node->range, parts.negative ? -value : value);
+	}
+
+	std::unique_ptr<ir::ast::expression::expression> type_number(const ir::ast::expression::literal<ir::ast::number>* node, ir::types::type_descriptor* expected)
+	{
+		const auto parts = split_number(node);
+
+		expected = ir::types::unwrap_alias(expected);
+		if (!expected)
+		{
+			if (parts.is_float)
+			{
+				return make_float<double>(node, parts, "f64");
+			}
+
+			const auto magnitude = parse_magnitude(node, parts);
+			if (fits<std::int32_t>(parts.negative, magnitude))
+			{
+				return make_integer<std::int32_t>(node, parts, "i32");
+			}
+
+			if (fits<std::int64_t>(parts.negative, magnitude))
+			{
+				return make_integer<std::int64_t>(node, parts, "i64");
+			}
+
+			return make_integer<std::uint64_t>(node, parts, "u64");
+		}
+
+		const auto& name = expected->name;
+
+		if (ir::types::is_built_in<std::int8_t>(expected)) return make_integer<std::int8_t>(node, parts, name);
+		if (ir::types::is_built_in<std::int16_t>(expected)) return make_integer<std::int16_t>(node, parts, name);
+		if (ir::types::is_built_in<std::int32_t>(expected)) return make_integer<std::int32_t>(node, parts, name);
+		if (ir::types::is_built_in<std::int64_t>(expected)) return make_integer<std::int64_t>(node, parts, name);
+		if (ir::types::is_built_in<std::uint8_t>(expected)) return make_integer<std::uint8_t>(node, parts, name);
+		if (ir::types::is_built_in<std::uint16_t>(expected)) return make_integer<std::uint16_t>(node, parts, name);
+		if (ir::types::is_built_in<std::uint32_t>(expected)) return make_integer<std::uint32_t>(node, parts, name);
+		if (ir::types::is_built_in<std::uint64_t>(expected)) return make_integer<std::uint64_t>(node, parts, name);
+		if (ir::types::is_built_in<float>(expected)) return make_float<float>(node, parts, name);
+		if (ir::types::is_built_in<double>(expected)) return make_float<double>(node, parts, name);
+
+		std::stringstream error_message;
+		error_message << "can not use number '" << node->val.value << "' as type '" << name << '\'';
+		throw exception(node->range.start, error_message.str());
+	}
+
+	std::shared_ptr<ir::types::type_descriptor> resolved_type(ir::ast::type_reference& type_ref)
+	{
+		if (auto type = std::get_if<ir::types::type_reference>(&type_ref))
+		{
+			return type->type;
+		}
+		return nullptr;
+	}
+
+	template <typename T>
+	std::shared_ptr<ir::types::type_descriptor> built_in_type(const char* name)
+	{
+		static const auto type = std::make_shared<ir::types::built_in_type_descriptor<T>>(name);
+		return type;
+	}
+
+	ir::ast::statement::function_declaration* get_callee(ir::ast::expression::call* node)
+	{
+		if (auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get()))
+		{
+			if (auto func_var = dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()))
+			{
+				return func_var->def_stat;
+			}
+		}
+		return nullptr;
+	}
+
+	ir::ast::expression::builtin_function* get_builtin(ir::ast::expression::call* node)
+	{
+		auto callee_var = dynamic_cast<ir::ast::expression::variable*>(node->func.get());
+		return callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr;
+	}
+
+	std::optional<std::int64_t> integer_constant(ir::ast::expression::expression* expr)
+	{
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::int8_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::int16_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::int32_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::int64_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::uint8_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::uint16_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::uint32_t>*>(expr)) return literal->val;
+		if (auto literal = dynamic_cast<ir::ast::expression::literal<std::uint64_t>*>(expr))
+		{
+			return literal->val <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) ? std::optional<std::int64_t>{ literal->val } : std::nullopt;
+		}
+		return std::nullopt;
+	}
+
+	// wraps the expression in a call to the vector's constructor, which puts it in every lane
+	void splat(std::unique_ptr<ir::ast::expression::expression>& expr, const ir::types::vector_type_descriptor* vector)
+	{
+		const auto range = expr->range;
+
+		std::vector<std::unique_ptr<ir::ast::expression::expression>> arguments;
+		arguments.push_back(std::move(expr));
+
+		auto constructor = std::make_unique<ir::ast::expression::variable>(range,
+			std::make_unique<ir::ast::expression::builtin_function>(range, vector->name, ir::ast::builtin::make_vector));
+		expr = std::make_unique<ir::ast::expression::call>(range, std::move(constructor), std::move(arguments));
+	}
+
+	std::shared_ptr<ir::types::type_descriptor> natural_type(ir::ast::expression::expression* expr);
+
+	// result of a builtin call from the types of its arguments, nullptr while they are untyped
+	std::shared_ptr<ir::types::type_descriptor> builtin_type(ir::ast::expression::call* node, ir::ast::expression::builtin_function* builtin)
+	{
+		if (builtin->type)
+		{
+			return builtin->type;
+		}
+
+		if (builtin->kind == ir::ast::builtin::make_vector)
+		{
+			return ir::types::make_vector_type(builtin->name);
+		}
+
+		auto operand = node->arguments.empty() ? nullptr : natural_type(node->arguments.front().get());
+		switch (builtin->kind)
+		{
+			case ir::ast::builtin::assume:
+			case ir::ast::builtin::prefetch:
+			case ir::ast::builtin::store:
+			{
+				return built_in_type<void>("void");
+			}
+			case ir::ast::builtin::load:
+			{
+				// only known from where the result goes, like a number
+				return nullptr;
+			}
+			case ir::ast::builtin::len:
+			{
+				return built_in_type<std::uint64_t>("u64");
+			}
+			case ir::ast::builtin::popcount:
+			case ir::ast::builtin::ctz:
+			case ir::ast::builtin::clz:
+			case ir::ast::builtin::bswap:
+			case ir::ast::builtin::fshl:
+			case ir::ast::builtin::fshr:
+			case ir::ast::builtin::checked_add:
+			case ir::ast::builtin::checked_sub:
+			case ir::ast::builtin::checked_mul:
+			case ir::ast::builtin::expect:
+			{
+				return operand;
+			}
+			default:
+			{
+				break;
+			}
+		}
+
+		auto vector = ir::types::as_vector(operand.get());
+		if (!vector)
+		{
+			return nullptr;
+		}
+
+		switch (builtin->kind)
+		{
+			case ir::ast::builtin::with_lane:
+			{
+				return operand;
+			}
+			case ir::ast::builtin::shuffle:
+			{
+				return node->arguments.size() > 2 ? ir::types::make_vector_type(vector->element->name + 'x' + std::to_string(node->arguments.size() - 2)) : nullptr;
+			}
+			default:
+			{
+				return vector->element;
+			}
+		}
+	}
+
+	// the field a member access refers to, nullptr if the object isn't a class or has no such field
+	const ir::types::field_descriptor* find_field(ir::ast::expression::member_access* node)
+	{
+		auto object_type = natural_type(node->object.get());
+		auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(object_type.get()));
+		if (!class_type)
+		{
+			return nullptr;
+		}
+
+		auto index = class_type->find_field(node->name);
+		return index ? &class_type->fields[*index] : nullptr;
+	}
+
+	// type of an expression without any context, nullptr if it's made up of untyped number literals only
+	std::shared_ptr<ir::types::type_descriptor> natural_type(ir::ast::expression::expression* expr)
+	{
+		if (dynamic_cast<ir::ast::expression::literal<std::string>*>(expr)) return built_in_type<std::string>("string");
+		if (dynamic_cast<ir::ast::expression::literal<bool>*>(expr)) return built_in_type<bool>("bool");
+		if (dynamic_cast<ir::ast::expression::literal<std::int8_t>*>(expr)) return built_in_type<std::int8_t>("i8");
+		if (dynamic_cast<ir::ast::expression::literal<std::int16_t>*>(expr)) return built_in_type<std::int16_t>("i16");
+		if (dynamic_cast<ir::ast::expression::literal<std::int32_t>*>(expr)) return built_in_type<std::int32_t>("i32");
+		if (dynamic_cast<ir::ast::expression::literal<std::int64_t>*>(expr)) return built_in_type<std::int64_t>("i64");
+		if (dynamic_cast<ir::ast::expression::literal<std::uint8_t>*>(expr)) return built_in_type<std::uint8_t>("u8");
+		if (dynamic_cast<ir::ast::expression::literal<std::uint16_t>*>(expr)) return built_in_type<std::uint16_t>("u16");
+		if (dynamic_cast<ir::ast::expression::literal<std::uint32_t>*>(expr)) return built_in_type<std::uint32_t>("u32");
+		if (dynamic_cast<ir::ast::expression::literal<std::uint64_t>*>(expr)) return built_in_type<std::uint64_t>("u64");
+		if (dynamic_cast<ir::ast::expression::literal<float>*>(expr)) return built_in_type<float>("f32");
+		if (dynamic_cast<ir::ast::expression::literal<double>*>(expr)) return built_in_type<double>("f64");
+
+		if (auto variable = dynamic_cast<ir::ast::expression::variable*>(expr))
+		{
+			if (auto local = dynamic_cast<ir::ast::expression::local_variable*>(variable->var.get()))
+			{
+				return resolved_type(local->def->type_);
+			}
+			return nullptr;
+		}
+
+		if (auto call = dynamic_cast<ir::ast::expression::call*>(expr))
+		{
+			if (auto builtin = get_builtin(call))
+			{
+				return builtin_type(call, builtin);
+			}
+
+			auto callee = get_callee(call);
+			return callee ? resolved_type(callee->return_type) : nullptr;
+		}
+
+		if (auto binary = dynamic_cast<ir::ast::expression::binary*>(expr))
+		{
+			if (ir::ast::is_comparison(binary->op))
+			{
+				return built_in_type<bool>("bool");
+			}
+
+			if (binary->type)
+			{
+				return binary->type;
+			}
+
+			auto type = natural_type(binary->left.get());
+			return type ? type : natural_type(binary->right.get());
+		}
+
+		if (auto unary = dynamic_cast<ir::ast::expression::unary*>(expr))
+		{
+			return unary->type ? unary->type : natural_type(unary->operand.get());
+		}
+
+		if (auto member = dynamic_cast<ir::ast::expression::member_access*>(expr))
+		{
+			auto field = find_field(member);
+			return field ? field->type.type : nullptr;
+		}
+
+		if (auto access = dynamic_cast<ir::ast::expression::index_access*>(expr))
+		{
+			auto object_type = natural_type(access->object.get());
+			auto element = ir::types::element_type(object_type.get());
+			return element ? *element : nullptr;
+		}
+
+		if (auto slice = dynamic_cast<ir::ast::expression::slice_access*>(expr))
+		{
+			if (slice->type)
+			{
+				return slice->type;
+			}
+
+			auto object_type = natural_type(slice->object.get());
+			auto element = ir::types::element_type(object_type.get());
+			return element ? ir::types::make_slice_type(*element) : nullptr;
+		}
+
+		if (auto array = dynamic_cast<ir::ast::expression::array_literal*>(expr))
+		{
+			if (array->type)
+			{
+				return array->type;
+			}
+
+			for (const auto& element : array->elements)
+			{
+				if (auto element_type = natural_type(element.get()))
+				{
+					return ir::types::make_array_type(std::move(element_type), array->elements.size());
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	void check_expected(const ir::ast::expression::expression* expr, const std::shared_ptr<ir::types::type_descriptor>& type, const std::shared_ptr<ir::types::type_descriptor>& expected)
+	{
+		if (expected && !ir::types::is_same(type.get(), expected.get()))
+		{
+			throw exception(expr->range.start, "expected expression of type '" + expected->name + "', got '" + type->name + "'");
+		}
+	}
+
+	std::string type_name(const std::shared_ptr<ir::types::type_descriptor>& type)
+	{
+		return type ? type->name : "number";
+	}
+
+	// an optional array is a value with a flag next to it, not something that can be indexed in place
+	void check_not_optional(const ir::ast::expression::expression* object)
+	{
+		auto variable = dynamic_cast<const ir::ast::expression::variable*>(object);
+		auto local = variable ? dynamic_cast<const ir::ast::expression::local_variable*>(variable->var.get()) : nullptr;
+		auto type_ref = local ? std::get_if<ir::types::type_reference>(&local->def->type_) : nullptr;
+		if (type_ref && type_ref->is_optional)
+		{
+			throw exception(object->range.start, "optional '" + local->name + "' can not be indexed or sliced");
+		}
+	}
+
+	bool is_local(const ir::ast::expression::expression* expr)
+	{
+		auto variable = dynamic_cast<const ir::ast::expression::variable*>(expr);
+		return variable && dynamic_cast<const ir::ast::expression::local_variable*>(variable->var.get());
+	}
+
+	// a[i], s[i] and a[i].x are in memory a store can go to, as long as there's a local array or a slice behind them
+	bool is_element(const ir::ast::expression::expression* expr)
+	{
+		if (auto access = dynamic_cast<const ir::ast::expression::index_access*>(expr))
+		{
+			return ir::types::as_slice(access->object_type.get()) || is_local(access->object.get()) || is_element(access->object.get());
+		}
+
+		if (auto member = dynamic_cast<const ir::ast::expression::member_access*>(expr))
+		{
+			return is_element(member->object.get());
+		}
+		return false;
+	}
+
+	void check_assignable(const ir::ast::expression::expression* target)
+	{
+		if (!is_local(target) && !is_element(target))
+		{
+			throw exception(target->range.start, "can only assign to local variables and elements of arrays and slices");
+		}
+	}
+}
+
+void parser::literal_typer::resolve(std::unique_ptr<ir::ast::expression::expression>& expr, std::shared_ptr<ir::types::type_descriptor> expected)
+{
+	if (auto number = dynamic_cast<ir::ast::expression::literal<ir::ast::number>*>(expr.get()))
+	{
+		auto vector = ir::types::as_vector(expected.get());
+		if (!vector)
+		{
+			expr = type_number(number, expected.get());
+			return;
+		}
+
+		// a number where a vector is expected goes into every lane, `v * 2.0`
+		expr = type_number(number, vector->element.get());
+		splat(expr, vector);
+		resolve(expr, expected);
+	}
+	else if (auto call = dynamic_cast<ir::ast::expression::call*>(expr.get()))
+	{
+		if (auto builtin = get_builtin(call))
+		{
+			resolve_builtin(call, builtin, std::move(expected));
+		}
+	}
+	else if (auto binary = dynamic_cast<ir::ast::expression::binary*>(expr.get()))
+	{
+		auto type = natural_type(binary->left.get());
+		auto right_type = natural_type(binary->right.get());
+
+		// a vector and a value of its element type, the value goes into every lane
+		if (type && right_type && !ir::ast::is_comparison(binary->op))
+		{
+			if (auto vector = ir::types::as_vector(type.get()); vector && ir::types::is_same(vector->element.get(), right_type.get()))
+			{
+				splat(binary->right, vector);
+				right_type = type;
+			}
+			else if (auto vector = ir::types::as_vector(right_type.get()); vector && ir::types::is_same(vector->element.get(), type.get()))
+			{
+				splat(binary->left, vector);
+				type = right_type;
+			}
+		}
+
+		if (right_type)
+		{
+			if (type && !ir::types::is_same(type.get(), right_type.get()))
+			{
+				throw exception(binary->range.start, "mismatched operand types '" + type->name + "' and '" + right_type->name + "' for operator '" + to_string(binary->op) + '\'');
+			}
+			type = right_type;
+		}
+
+		const auto is_comparison = ir::ast::is_comparison(binary->op);
+
+		// all literals, the context decides or the left side picks a default the right side has to match.
+		// the context of a comparison is about its bool result, not the operands
+		resolve(binary->left, type ? type : is_comparison ? nullptr : expected);
+		if (!type)
+		{
+			type = natural_type(binary->left.get());
+		}
+		resolve(binary->right, type);
+
+		// vectors only get the arithmetic operators, a comparison would have to produce a mask instead of a bool
+		const auto is_equality = binary->op == ir::ast::binary_operator::equal || binary->op == ir::ast::binary_operator::not_equal;
+		const auto scalar = ir::types::scalar_type(type.get());
+		if ((!ir::types::is_integer(scalar) && !ir::types::is_floating_point(scalar) && !(is_equality && ir::types::is_built_in<bool>(type.get())))
+			|| (is_comparison && ir::types::as_vector(type.get())))
+		{
+			throw exception(binary->range.start, std::string{ "operator '" } + to_string(binary->op) + "' can not be applied to type '" + type->name + '\'');
+		}
+
+		check_expected(binary, is_comparison ? built_in_type<bool>("bool") : type, expected);
+		binary->type = std::move(type);
+	}
+	else if (auto unary = dynamic_cast<ir::ast::expression::unary*>(expr.get()))
+	{
+		auto type = natural_type(unary->operand.get());
+
+		resolve(unary->operand, type ? type : expected);
+		if (!type)
+		{
+			type = natural_type(unary->operand.get());
+		}
+
+		const auto scalar = ir::types::scalar_type(type.get());
+		if (!ir::types::is_signed_integer(scalar) && !ir::types::is_floating_point(scalar))
+		{
+			throw exception(unary->range.start, std::string{ "operator '" } + to_string(unary->op) + "' can not be applied to type '" + type->name + '\'');
+		}
+
+		check_expected(unary, type, expected);
+		unary->type = std::move(type);
+	}
+	else if (auto member = dynamic_cast<ir::ast::expression::member_access*>(expr.get()))
+	{
+		resolve(member->object, nullptr);
+
+		auto object_type = natural_type(member->object.get());
+		auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(object_type.get()));
+		if (!class_type)
+		{
+			throw exception(member->range.start, "type '" + (object_type ? object_type->name : std::string{ "number" }) + "' has no fields");
+		}
+
+		auto index = class_type->find_field(member->name);
+		if (!index)
+		{
+			throw exception(member->range.start, "type '" + class_type->name + "' has no field '" + member->name + "'");
+		}
+
+		member->object_type = class_type;
+		member->field_index = *index;
+		check_expected(member, class_type->fields[*index].type.type, expected);
+	}
+	else if (auto access = dynamic_cast<ir::ast::expression::index_access*>(expr.get()))
+	{
+		resolve(access->object, nullptr);
+		check_not_optional(access->object.get());
+
+		auto object_type = natural_type(access->object.get());
+		auto element = ir::types::element_type(object_type.get());
+		if (!element)
+		{
+			throw exception(access->range.start, "type '" + type_name(object_type) + "' can not be indexed");
+		}
+
+		auto index_type = resolve_bound(access->index, "index");
+
+		// out of range constant indices are caught here, any other one is checked at runtime
+		auto array = ir::types::as_array(object_type.get());
+		if (auto index = integer_constant(access->index.get()); index && (*index < 0 || (array && static_cast<std::uint64_t>(*index) >= array->length)))
+		{
+			throw exception(access->index->range.start, "index " + std::to_string(*index) + " is out of bounds for '" + object_type->name + "'");
+		}
+
+		access->object_type = std::move(object_type);
+		access->index_type = std::move(index_type);
+		check_expected(access, *element, expected);
+	}
+	else if (auto slice = dynamic_cast<ir::ast::expression::slice_access*>(expr.get()))
+	{
+		resolve(slice->object, nullptr);
+		check_not_optional(slice->object.get());
+
+		auto object_type = natural_type(slice->object.get());
+		auto element = ir::types::element_type(object_type.get());
+		if (!element)
+		{
+			throw exception(slice->range.start, "type '" + type_name(object_type) + "' can not be sliced");
+		}
+
+		auto class_type = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(element->get()));
+		if (class_type && class_type->soa)
+		{
+			throw exception(slice->range.start, "an array of '@soa' class '" + class_type->name + "' can not be sliced, its fields are stored apart");
+		}
+
+		std::optional<std::int64_t> from, to;
+		if (slice->from)
+		{
+			slice->from_type = resolve_bound(slice->from, "slice start");
+			from = integer_constant(slice->from.get());
+		}
+		if (slice->to)
+		{
+			slice->to_type = resolve_bound(slice->to, "slice end");
+			to = integer_constant(slice->to.get());
+		}
+
+		auto array = ir::types::as_array(object_type.get());
+		for (const auto& bound : { from, to })
+		{
+			if (bound && (*bound < 0 || (array && static_cast<std::uint64_t>(*bound) > array->length)))
+			{
+				throw exception(slice->range.start, "slice bound " + std::to_string(*bound) + " is out of bounds for '" + object_type->name + "'");
+			}
+		}
+		if (from && to && *from > *to)
+		{
+			throw exception(slice->range.start, "slice start " + std::to_string(*from) + " is past its end " + std::to_string(*to));
+		}
+
+		slice->type = ir::types::as_slice(object_type.get()) ? object_type : ir::types::make_slice_type(*element);
+		slice->object_type = std::move(object_type);
+		check_expected(slice, slice->type, expected);
+	}
+	else if (auto array = dynamic_cast<ir::ast::expression::array_literal*>(expr.get()))
+	{
+		auto& elements = array->elements;
+
+		std::shared_ptr<ir::types::type_descriptor> type;
+		if (expected)
+		{
+			auto array_type = ir::types::as_array(expected.get());
+			if (!array_type)
+			{
+				throw exception(array->range.start, "expected expression of type '" + expected->name + "', got an array");
+			}
+
+			if (elements.size() != 1 && elements.size() != array_type->length)
+			{
+				std::stringstream error_message;
+				error_message << '\'' << expected->name << "' takes 1 or " << array_type->length << " values, got " << elements.size();
+				throw exception(array->range.start, error_message.str());
+			}
+			type = expected;
+		}
+		else
+		{
+			// the first element with a type decides, or the first one on its own if they're all numbers
+			type = natural_type(array);
+			if (!type)
+			{
+				resolve(elements.front(), nullptr);
+				type = ir::types::make_array_type(natural_type(elements.front().get()), elements.size());
+			}
+		}
+
+		const auto& element_type = ir::types::as_array(type.get())->element;
+		for (auto& element : elements)
+		{
+			resolve(element, element_type);
+			if (auto actual = natural_type(element.get()); !actual || !ir::types::is_same(actual.get(), element_type.get()))
+			{
+				throw exception(element->range.start, "expected array element of type '" + element_type->name + "', got '" + type_name(actual) + "'");
+			}
+		}
+
+		array->type = std::move(type);
+	}
+}
+
+std::shared_ptr<ir::types::type_descriptor> parser::literal_typer::resolve_bound(std::unique_ptr<ir::ast::expression::expression>& bound, const char* what)
+{
+	resolve(bound, nullptr);
+
+	auto type = natural_type(bound.get());
+	if (!ir::types::is_integer(type.get()))
+	{
+		throw exception(bound->range.start, std::string{ what } + " has to be an integer, got '" + type_name(type) + "'");
+	}
+	return type;
+}
+
+void parser::literal_typer::resolve_builtin(ir::ast::expression::call* call, ir::ast::expression::builtin_function* builtin, std::shared_ptr<ir::types::type_descriptor> expected)
+{
+	auto& arguments = call->arguments;
+
+	auto check_argument_count = [&](std::size_t min, std::size_t max)
+	{
+		if (arguments.size() < min || arguments.size() > max)
+		{
+			std::stringstream error_message;
+			error_message << "builtin '" << builtin->name << "' takes " << min;
+			if (max != min)
+			{
+				error_message << (max == SIZE_MAX ? " or more" : " to " + std::to_string(max));
+			}
+			error_message << " arguments, got " << arguments.size();
+			throw exception(call->range.start, error_message.str());
+		}
+	};
+
+	auto resolve_as = [&](std::unique_ptr<ir::ast::expression::expression>& arg, const std::shared_ptr<ir::types::type_descriptor>& type)
+	{
+		resolve(arg, type);
+		if (auto arg_type = natural_type(arg.get()); !arg_type || !ir::types::is_same(arg_type.get(), type.get()))
+		{
+			throw exception(arg->range.start, "expected expression of type '" + type->name + "', got '" + (arg_type ? arg_type->name : std::string{ "number" }) + "'");
+		}
+	};
+
+	// out of range constant lanes are caught here, a lane index only known at runtime wraps around
+	auto resolve_lane = [&](std::unique_ptr<ir::ast::expression::expression>& arg, unsigned lanes)
+	{
+		resolve(arg, nullptr);
+		if (auto arg_type = natural_type(arg.get()); !arg_type || !ir::types::is_integer(arg_type.get()))
+		{
+			throw exception(arg->range.start, "lane index has to be an integer");
+		}
+
+		if (auto index = integer_constant(arg.get()); index && (*index < 0 || *index >= lanes))
+		{
+			throw exception(arg->range.start, "lane " + std::to_string(*index) + " is out of range for " + std::to_string(lanes) + " lanes");
+		}
+	};
+
+	// checks a constant argument of a hint, `what` is named in the error
+	auto resolve_constant = [&](std::unique_ptr<ir::ast::expression::expression>& arg, std::int64_t min, std::int64_t max, const std::string& what)
+	{
+		resolve(arg, built_in_type<std::int32_t>("i32"));
+		if (auto value = integer_constant(arg.get()); !value || *value < min || *value > max)
+		{
+			throw exception(arg->range.start, what + " has to be a constant from " + std::to_string(min) + " to " + std::to_string(max));
+		}
+	};
+
+	std::shared_ptr<ir::types::type_descriptor> operand;
+	switch (builtin->kind)
+	{
+		case ir::ast::builtin::popcount:
+		case ir::ast::builtin::ctz:
+		case ir::ast::builtin::clz:
+		case ir::ast::builtin::bswap:
+		case ir::ast::builtin::fshl:
+		case ir::ast::builtin::fshr:
+		case ir::ast::builtin::checked_add:
+		case ir::ast::builtin::checked_sub:
+		case ir::ast::builtin::checked_mul:
+		{
+			const auto is_funnel_shift = builtin->kind == ir::ast::builtin::fshl || builtin->kind == ir::ast::builtin::fshr;
+			const auto is_checked = builtin->kind == ir::ast::builtin::checked_add || builtin->kind == ir::ast::builtin::checked_sub
+				|| builtin->kind == ir::ast::builtin::checked_mul;
+
+			const std::size_t count = is_funnel_shift ? 3 : is_checked ? 2 : 1;
+			check_argument_count(count, count);
+
+			// numbers take the type of the other arguments or of where the result goes, `checked_add(x, 1)`
+			auto type = expected;
+			for (auto& arg : arguments)
+			{
+				if (auto arg_type = natural_type(arg.get()))
+				{
+					type = std::move(arg_type);
+					break;
+				}
+			}
+			resolve(arguments.front(), type);
+
+			// the overflow flag of a vector would be one per lane, only scalars can be checked
+			operand = natural_type(arguments.front().get());
+			if (!ir::types::is_integer(is_checked ? operand.get() : ir::types::scalar_type(operand.get())))
+			{
+				throw exception(arguments.front()->range.start, "builtin '" + builtin->name + "' expects an integer, got '" + (operand ? operand->name : std::string{ "number" }) + "'");
+			}
+
+			for (auto it = arguments.begin() + 1; it != arguments.end(); ++it)
+			{
+				resolve_as(*it, operand);
+			}
+			break;
+		}
+		case ir::ast::builtin::expect:
+		{
+			check_argument_count(2, 2);
+			resolve(arguments.front(), expected);
+
+			operand = natural_type(arguments.front().get());
+			if (!ir::types::is_integer(operand.get()) && !ir::types::is_built_in<bool>(operand.get()))
+			{
+				throw exception(arguments.front()->range.start, "builtin 'expect' expects an integer or a bool, got '" + (operand ? operand->name : std::string{ "number" }) + "'");
+			}
+
+			resolve_as(arguments[1], operand);
+			if (!integer_constant(arguments[1].get()) && !dynamic_cast<ir::ast::expression::literal<bool>*>(arguments[1].get()))
+			{
+				throw exception(arguments[1]->range.start, "the expected value has to be a constant");
+			}
+			break;
+		}
+		case ir::ast::builtin::assume:
+		{
+			check_argument_count(1, 1);
+			resolve_condition(arguments.front());
+			operand = natural_type(arguments.front().get());
+			break;
+		}
+		case ir::ast::builtin::prefetch:
+		{
+			check_argument_count(1, 3);
+			resolve(arguments.front(), nullptr);
+
+			operand = natural_type(arguments.front().get());
+			if (!ir::types::is_built_in<std::string>(operand.get()))
+			{
+				throw exception(arguments.front()->range.start, "builtin 'prefetch' expects a string, got '" + (operand ? operand->name : std::string{ "number" }) + "'");
+			}
+
+			// like __builtin_prefetch, 0 reads and 1 writes, locality goes from 0 (used once) to 3 (keep in every cache level)
+			if (arguments.size() > 1)
+			{
+				resolve_constant(arguments[1], 0, 1, "prefetch rw");
+			}
+			if (arguments.size() > 2)
+			{
+				resolve_constant(arguments[2], 0, 3, "prefetch locality");
+			}
+			break;
+		}
+		case ir::ast::builtin::len:
+		{
+			check_argument_count(1, 1);
+			resolve(arguments.front(), nullptr);
+			check_not_optional(arguments.front().get());
+
+			operand = natural_type(arguments.front().get());
+			if (!ir::types::element_type(operand.get()) && !ir::types::is_built_in<std::string>(operand.get()))
+			{
+				throw exception(arguments.front()->range.start, "builtin 'len' expects an array, a slice or a string, got '" + type_name(operand) + "'");
+			}
+			break;
+		}
+		case ir::ast::builtin::load:
+		case ir::ast::builtin::store:
+		{
+			const auto is_store = builtin->kind == ir::ast::builtin::store;
+			check_argument_count(is_store ? 3 : 2, is_store ? 3 : 2);
+			resolve(arguments.front(), nullptr);
+			check_not_optional(arguments.front().get());
+
+			operand = natural_type(arguments.front().get());
+			auto element = ir::types::element_type(operand.get());
+			if (!element)
+			{
+				throw exception(arguments.front()->range.start, "builtin '" + builtin->name + "' expects an array or a slice, got '" + type_name(operand) + "'");
+			}
+
+			if (is_store && !ir::types::as_slice(operand.get()) && !is_local(arguments.front().get()) && !is_element(arguments.front().get()))
+			{
+				throw exception(arguments.front()->range.start, "builtin 'store' can only store to local arrays, their elements and slices");
+			}
+
+			// a vector of the elements, the one stored or the one where the result goes
+			auto type = expected;
+			if (is_store)
+			{
+				resolve(arguments[2], nullptr);
+				type = natural_type(arguments[2].get());
+			}
+
+			auto vector = ir::types::as_vector(type.get());
+			if (!vector || !ir::types::is_same(vector->element.get(), element->get()))
+			{
+				if (!is_store && !type)
+				{
+					throw exception(call->range.start, "builtin 'load' takes its vector type from where the result goes, like `v: " + (*element)->name + "x4 := load(a, i)`");
+				}
+				throw exception(is_store ? arguments[2]->range.start : call->range.start, "builtin '" + builtin->name + "' expects a vector of '" + (*element)->name + "', got '" + type_name(type) + "'");
+			}
+
+			builtin->index_type = resolve_bound(arguments[1], "index");
+			builtin->lanes = vector->lanes;
+
+			// like a[i], a constant index is checked here, any other one at runtime
+			auto array = ir::types::as_array(operand.get());
+			if (auto index = integer_constant(arguments[1].get()); index && (*index < 0 || (array && static_cast<std::uint64_t>(*index) + vector->lanes > array->length)))
+			{
+				throw exception(arguments[1]->range.start, std::to_string(vector->lanes) + " elements from index " + std::to_string(*index) + " are out of bounds for '" + operand->name + "'");
+			}
+
+			if (!is_store)
+			{
+				builtin->type = std::move(type);
+			}
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	if (operand)
+	{
+		builtin->type = builtin_type(call, builtin);
+		builtin->operand_type = std::move(operand);
+		check_expected(call, builtin->type, expected);
+		return;
+	}
+
+	if (builtin->kind == ir::ast::builtin::make_vector)
+	{
+		operand = ir::types::make_vector_type(builtin->name);
+	}
+	else
+	{
+		check_argument_count(1, SIZE_MAX);
+		resolve(arguments.front(), nullptr);
+
+		operand = natural_type(arguments.front().get());
+		if (!ir::types::as_vector(operand.get()))
+		{
+			throw exception(arguments.front()->range.start, "builtin '" + builtin->name + "' expects a vector, got '" + (operand ? operand->name : std::string{ "number" }) + "'");
+		}
+	}
+
+	const auto vector = ir::types::as_vector(operand.get());
+	switch (builtin->kind)
+	{
+		case ir::ast::builtin::make_vector:
+		{
+			if (arguments.size() != 1 && arguments.size() != vector->lanes)
+			{
+				std::stringstream error_message;
+				error_message << '\'' << vector->name << "' takes 1 or " << vector->lanes << " values, got " << arguments.size();
+				throw exception(call->range.start, error_message.str());
+			}
+
+			for (auto& arg : arguments)
+			{
+				resolve_as(arg, vector->element);
+			}
+			break;
+		}
+		case ir::ast::builtin::lane:
+		{
+			check_argument_count(2, 2);
+			resolve_lane(arguments[1], vector->lanes);
+			break;
+		}
+		case ir::ast::builtin::with_lane:
+		{
+			check_argument_count(3, 3);
+			resolve_lane(arguments[1], vector->lanes);
+			resolve_as(arguments[2], vector->element);
+			break;
+		}
+		case ir::ast::builtin::shuffle:
+		{
+			check_argument_count(3, SIZE_MAX);
+			resolve_as(arguments[1], operand);
+
+			for (std::size_t i = 2; i < arguments.size(); ++i)
+			{
+				resolve(arguments[i], nullptr);
+
+				auto index = integer_constant(arguments[i].get());
+				if (!index || *index < 0 || *index >= 2 * vector->lanes)
+				{
+					throw exception(arguments[i]->range.start, "shuffle index has to be a constant below " + std::to_string(2 * vector->lanes));
+				}
+			}
+
+			if (!builtin_type(call, builtin))
+			{
+				throw exception(call->range.start, "shuffle can not produce " + std::to_string(arguments.size() - 2) + " lanes of '" + vector->element->name + "'");
+			}
+			break;
+		}
+		default: // reductions
+		{
+			check_argument_count(1, 1);
+			break;
+		}
+	}
+
+	builtin->type = builtin_type(call, builtin);
+	builtin->operand_type = std::move(operand);
+	check_expected(call, builtin->type, expected);
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::function_definition* node)
+{
+	current_function = node;
+	node->visit_children(this);
+	current_function = nullptr;
+	return false;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::variable_declaration* node)
+{
+	resolve(node->value, resolved_type(node->variable.type_));
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::variable_assignment* node)
+{
+	resolve(node->target, nullptr);
+	check_assignable(node->target.get());
+
+	resolve(node->value, natural_type(node->target.get()));
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::compound_assignment* node)
+{
+	resolve(node->target, nullptr);
+	check_assignable(node->target.get());
+
+	auto type = natural_type(node->target.get());
+	const auto scalar = ir::types::scalar_type(type.get());
+	if (!ir::types::is_integer(scalar) && !ir::types::is_floating_point(scalar))
+	{
+		throw exception(node->range.start, std::string{ "operator '" } + to_string(node->op) + "=' can not be applied to type '" + type_name(type) + '\'');
+	}
+
+	node->type = type;
+	resolve(node->value, std::move(type));
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::expression_statement* node)
+{
+	resolve(node->expr, nullptr);
+	return true;
+}
+
+void parser::literal_typer::resolve_condition(std::unique_ptr<ir::ast::expression::expression>& condition)
+{
+	const auto bool_type = built_in_type<bool>("bool");
+	resolve(condition, bool_type);
+
+	if (auto type = natural_type(condition.get()); type && !ir::types::is_same(type.get(), bool_type.get()))
+	{
+		throw exception(condition->range.start, "expected condition of type 'bool', got '" + type->name + "'");
+	}
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::if_statement* node)
+{
+	resolve_condition(node->condition);
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::while_statement* node)
+{
+	resolve_condition(node->condition);
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::switch_statement* node)
+{
+	resolve(node->value, nullptr);
+
+	auto type = natural_type(node->value.get());
+	if (!type || (!ir::types::is_integer(type.get()) && !ir::types::is_built_in<bool>(type.get()) && !ir::types::is_built_in<std::string>(type.get())))
+	{
+		throw exception(node->value->range.start, "can only switch over integers, bools and strings");
+	}
+
+	for (auto& switch_case : node->cases)
+	{
+		for (auto& label : switch_case.labels)
+		{
+			resolve(label, type);
+
+			if (auto label_type = natural_type(label.get()); label_type && !ir::types::is_same(label_type.get(), type.get()))
+			{
+				throw exception(label->range.start, "case label of type '" + label_type->name + "' does not match switch type '" + type->name + "'");
+			}
+		}
+	}
+
+	node->type = std::move(type);
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::throw_statement* node)
+{
+	resolve(node->value, nullptr);
+
+	if (auto type = natural_type(node->value.get()); !type || !ir::types::is_built_in<std::string>(type.get()))
+	{
+		throw exception(node->value->range.start, "can only throw strings");
+	}
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::statement::ret* node)
+{
+	if (node->value)
+	{
+		resolve(node->value, current_function ? resolved_type(current_function->return_type) : nullptr);
+	}
+	return true;
+}
+
+bool parser::literal_typer::visit(ir::ast::expression::call* node)
+{
+	// typed along with the expression they are part of
+	if (get_builtin(node))
+	{
+		return true;
+	}
+
+	resolve(node->func, nullptr);
+
+	auto callee = get_callee(node);
+	for (std::size_t i = 0; i < node->arguments.size(); ++i)
+	{
+		std::shared_ptr<ir::types::type_descriptor> expected;
+		if (callee && i < callee->arguments.size())
+		{
+			expected = resolved_type(callee->arguments[i].type_);
+		}
+
+		resolve(node->arguments[i], expected);
+	}
+	return true;
+}
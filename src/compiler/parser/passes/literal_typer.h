@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../../ir/ast/ast.h"
+
+namespace seam::compiler::parser
+{
+	// replaces every number literal with a typed literal and types operator expressions, needs to run after variable_resolver.
+	// the type comes from the other operand or where the expression is used (declaration, parameter or return type),
+	// otherwise the narrowest of i32, i64 and u64 that fits (f64 for decimals) is picked
+	class literal_typer : public ir::ast::visitor
+	{
+		ir::ast::statement::function_definition* current_function = nullptr;
+
+		void resolve(std::unique_ptr<ir::ast::expression::expression>& expr, std::shared_ptr<ir::types::type_descriptor> expected);
+		void resolve_condition(std::unique_ptr<ir::ast::expression::expression>& condition);
+		// an index or slice bound, `what` is named in the error
+		std::shared_ptr<ir::types::type_descriptor> resolve_bound(std::unique_ptr<ir::ast::expression::expression>& bound, const char* what);
+		void resolve_builtin(ir::ast::expression::call* call, ir::ast::expression::builtin_function* builtin, std::shared_ptr<ir::types::type_descriptor> expected);
+	public:
+		bool visit(ir::ast::statement::function_definition* node) override;
+		bool visit(ir::ast::statement::variable_declaration* node) override;
+		bool visit(ir::ast::statement::variable_assignment* node) override;
+		bool visit(ir::ast::statement::compound_assignment* node) override;
+		bool visit(ir::ast::statement::expression_statement* node) override;
+		bool visit(ir::ast::statement::if_statement* node) override;
+		bool visit(ir::ast::statement::while_statement* node) override;
+		bool visit(ir::ast::statement::switch_statement* node) override;
+		bool visit(ir::ast::statement::throw_statement* node) override;
+		bool visit(ir::ast::statement::ret* node) override;
+		bool visit(ir::ast::expression::call* node) override;
+	};
+}
@@ -0,0 +1,1025 @@
+#include "range_analysis.h"
+
+#include "../../comptime/interpreter.h"
+#include "../../utils/exception.h"
+
+#include <sstream>
+
+using namespace seam::compiler;
+
+namespace
+{
+	// optional integers aren't tracked, nullptr for anything else
+	ir::types::type_descriptor* integer_type(const ir::types::type_reference* type_ref)
+	{
+		return type_ref && !type_ref->is_optional && ir::types::is_integer(type_ref->type.get()) ? type_ref->type.get() : nullptr;
+	}
+
+	ir::types::type_descriptor* integer_type(const ir::ast::type_reference& type_ref)
+	{
+		return integer_type(std::get_if<ir::types::type_reference>(&type_ref));
+	}
+
+	std::optional<llvm::ConstantRange> full_range(ir::types::type_descriptor* type)
+	{
+		if (!type || !ir::types::is_integer(type))
+		{
+			return std::nullopt;
+		}
+		return llvm::ConstantRange::getFull(ir::types::bit_width(type));
+	}
+
+	llvm::ConstantRange::PreferredRangeType preferred(ir::types::type_descriptor* type)
+	{
+		return ir::types::is_signed_integer(type) ? llvm::ConstantRange::Signed : llvm::ConstantRange::Unsigned;
+	}
+
+	const ir::ast::var* get_local(ir::ast::expression::expression* expr)
+	{
+		auto variable = dynamic_cast<ir::ast::expression::variable*>(expr);
+		auto local = variable ? dynamic_cast<ir::ast::expression::local_variable*>(variable->var.get()) : nullptr;
+		return local && integer_type(local->def->type_) ? local->def : nullptr;
+	}
+
+	// any local, not only the integers get_local is about
+	const ir::ast::var* get_variable(ir::ast::expression::expression* expr)
+	{
+		auto variable = dynamic_cast<ir::ast::expression::variable*>(expr);
+		auto local = variable ? dynamic_cast<ir::ast::expression::local_variable*>(variable->var.get()) : nullptr;
+		return local ? local->def : nullptr;
+	}
+
+	bool is_sequence(const ir::ast::var* var)
+	{
+		auto type_ref = std::get_if<ir::types::type_reference>(&var->type_);
+		return type_ref && ir::types::element_type(type_ref->type.get());
+	}
+
+	ir::ast::expression::builtin_function* get_builtin(ir::ast::expression::expression* expr)
+	{
+		auto call = dynamic_cast<ir::ast::expression::call*>(expr);
+		auto callee_var = call ? dynamic_cast<ir::ast::expression::variable*>(call->func.get()) : nullptr;
+		return callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr;
+	}
+
+	// s in len(s), for a local array or slice
+	const ir::ast::var* get_length_of(ir::ast::expression::expression* expr)
+	{
+		auto builtin = get_builtin(expr);
+		if (!builtin || builtin->kind != ir::ast::builtin::len)
+		{
+			return nullptr;
+		}
+
+		auto sequence = get_variable(static_cast<ir::ast::expression::call*>(expr)->arguments.front().get());
+		return sequence && is_sequence(sequence) ? sequence : nullptr;
+	}
+
+	// a bounds check belongs to an index_access or to the call of a load or store, which keep the outcome the same way
+	void set_checked(ir::ast::expression::expression* node, bool checked)
+	{
+		if (auto access = dynamic_cast<ir::ast::expression::index_access*>(node))
+		{
+			access->checked = checked;
+		}
+		else
+		{
+			get_builtin(node)->checked = checked;
+		}
+	}
+
+	void set_hoisted(ir::ast::expression::expression* node, const ir::ast::hoisted_check* hoisted)
+	{
+		if (auto access = dynamic_cast<ir::ast::expression::index_access*>(node))
+		{
+			access->hoisted = hoisted;
+		}
+		else
+		{
+			get_builtin(node)->hoisted = hoisted;
+		}
+	}
+
+	void set_division_checked(ir::ast::node* node, bool checked)
+	{
+		if (auto binary = dynamic_cast<ir::ast::expression::binary*>(node))
+		{
+			binary->checked = checked;
+		}
+		else
+		{
+			static_cast<ir::ast::statement::compound_assignment*>(node)->checked = checked;
+		}
+	}
+
+	ir::ast::expression::expression* get_object(ir::ast::expression::expression* node)
+	{
+		auto access = dynamic_cast<ir::ast::expression::index_access*>(node);
+		return access ? access->object.get() : static_cast<ir::ast::expression::call*>(node)->arguments.front().get();
+	}
+
+	std::string to_string(const llvm::ConstantRange& range, bool is_signed)
+	{
+		std::stringstream stream;
+		if (is_signed)
+		{
+			stream << '[' << range.getSignedMin().getSExtValue() << ", " << range.getSignedMax().getSExtValue() << ']';
+		}
+		else
+		{
+			stream << '[' << range.getUnsignedMin().getZExtValue() << ", " << range.getUnsignedMax().getZExtValue() << ']';
+		}
+		return stream.str();
+	}
+
+	// the locals a statement assigns to or declares anywhere inside of it
+	class assignment_finder : public ir::ast::visitor
+	{
+	public:
+		std::vector<const ir::ast::var*> assigned;
+
+		bool visit(ir::ast::statement::variable_declaration* node) override
+		{
+			assigned.push_back(&node->variable);
+			return true;
+		}
+
+		bool visit(ir::ast::statement::variable_assignment* node) override
+		{
+			if (auto local = get_variable(node->target.get()))
+			{
+				assigned.push_back(local);
+			}
+			return true;
+		}
+
+		bool visit(ir::ast::statement::compound_assignment* node) override
+		{
+			if (auto local = get_variable(node->target.get()))
+			{
+				assigned.push_back(local);
+			}
+			return true;
+		}
+	};
+}
+
+std::optional<llvm::ConstantRange> parser::range_analysis::get_range(ir::ast::expression::expression* expr)
+{
+	if (auto value = comptime::literal_value(expr))
+	{
+		return std::visit([](const auto& v) -> std::optional<llvm::ConstantRange>
+		{
+			using T = std::decay_t<decltype(v)>;
+			if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+			{
+				return llvm::ConstantRange{ llvm::APInt(sizeof(T) * 8, static_cast<std::uint64_t>(v), std::is_signed_v<T>) };
+			}
+			return std::nullopt;
+		}, *value);
+	}
+
+	if (auto variable = dynamic_cast<ir::ast::expression::variable*>(expr))
+	{
+		auto local = dynamic_cast<ir::ast::expression::local_variable*>(variable->var.get());
+		if (!local)
+		{
+			return std::nullopt;
+		}
+
+		if (auto it = current.ranges.find(local->def); it != current.ranges.cend())
+		{
+			return it->second;
+		}
+		return full_range(integer_type(local->def->type_));
+	}
+
+	if (auto binary = dynamic_cast<ir::ast::expression::binary*>(expr))
+	{
+		auto left = get_range(binary->left.get());
+		auto right = get_range(binary->right.get());
+		if (binary->op == ir::ast::binary_operator::divide)
+		{
+			check_division(binary, binary->type.get(), left, right);
+		}
+
+		if (!left || !right || ir::ast::is_comparison(binary->op))
+		{
+			return std::nullopt;
+		}
+		return apply(binary->op, binary->type.get(), *left, *right);
+	}
+
+	if (auto unary = dynamic_cast<ir::ast::expression::unary*>(expr))
+	{
+		auto operand = get_range(unary->operand.get());
+		if (!operand)
+		{
+			return std::nullopt;
+		}
+		return llvm::ConstantRange{ llvm::APInt::getZero(operand->getBitWidth()) }.sub(*operand);
+	}
+
+	if (auto member = dynamic_cast<ir::ast::expression::member_access*>(expr))
+	{
+		get_range(member->object.get());
+		return member->object_type ? full_range(integer_type(&member->object_type->fields[member->field_index].type)) : std::nullopt;
+	}
+
+	if (auto access = dynamic_cast<ir::ast::expression::index_access*>(expr))
+	{
+		get_range(access->object.get());
+		check_bounds(access, { access->object.get(), access->index.get(), access->object_type.get(), access->index_type.get(), 1 }, get_range(access->index.get()));
+
+		auto element = ir::types::element_type(access->object_type.get());
+		return element ? full_range(element->get()) : std::nullopt;
+	}
+
+	if (auto slice = dynamic_cast<ir::ast::expression::slice_access*>(expr))
+	{
+		get_range(slice->object.get());
+		for (auto bound : { slice->from.get(), slice->to.get() })
+		{
+			if (bound)
+			{
+				get_range(bound);
+			}
+		}
+
+		slice->checked &= !unchecked;
+		return std::nullopt;
+	}
+
+	if (auto array = dynamic_cast<ir::ast::expression::array_literal*>(expr))
+	{
+		for (auto& element : array->elements)
+		{
+			get_range(element.get());
+		}
+		return std::nullopt;
+	}
+
+	auto call = dynamic_cast<ir::ast::expression::call*>(expr);
+	if (!call)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<std::optional<llvm::ConstantRange>> arguments;
+	for (auto& arg : call->arguments)
+	{
+		arguments.push_back(get_range(arg.get()));
+	}
+
+	auto callee_var = dynamic_cast<ir::ast::expression::variable*>(call->func.get());
+	if (auto builtin = callee_var ? dynamic_cast<ir::ast::expression::builtin_function*>(callee_var->var.get()) : nullptr)
+	{
+		switch (builtin->kind)
+		{
+			case ir::ast::builtin::checked_add:
+			case ir::ast::builtin::checked_sub:
+			case ir::ast::builtin::checked_mul:
+			{
+				return arguments[0] && arguments[1] ? std::optional{ get_checked_range(call, builtin, *arguments[0], *arguments[1]) } : std::nullopt;
+			}
+			case ir::ast::builtin::popcount:
+			case ir::ast::builtin::ctz:
+			case ir::ast::builtin::clz:
+			{
+				if (!ir::types::is_integer(builtin->type.get()))
+				{
+					return std::nullopt;
+				}
+
+				const auto width = ir::types::bit_width(builtin->type.get());
+				return llvm::ConstantRange::getNonEmpty(llvm::APInt(width, 0), llvm::APInt(width, width + 1));
+			}
+			case ir::ast::builtin::expect:
+			{
+				return arguments.front();
+			}
+			case ir::ast::builtin::len:
+			{
+				if (auto array = ir::types::as_array(builtin->operand_type.get()))
+				{
+					return llvm::ConstantRange{ llvm::APInt(64, array->length) };
+				}
+				return full_range(builtin->type.get());
+			}
+			case ir::ast::builtin::load:
+			case ir::ast::builtin::store:
+			{
+				check_bounds(call, { call->arguments[0].get(), call->arguments[1].get(), builtin->operand_type.get(), builtin->index_type.get(), builtin->lanes }, arguments[1]);
+				return std::nullopt;
+			}
+			default:
+			{
+				return full_range(builtin->type.get());
+			}
+		}
+	}
+
+	auto callee = callee_var ? dynamic_cast<ir::ast::expression::function_variable*>(callee_var->var.get()) : nullptr;
+	return callee ? full_range(integer_type(callee->def_stat->return_type)) : std::nullopt;
+}
+
+llvm::ConstantRange parser::range_analysis::apply(ir::ast::binary_operator op, ir::types::type_descriptor* type, const llvm::ConstantRange& left, const llvm::ConstantRange& right)
+{
+	// the generated code wraps around, so does the range
+	switch (op)
+	{
+		case ir::ast::binary_operator::add: return left.add(right);
+		case ir::ast::binary_operator::subtract: return left.sub(right);
+		case ir::ast::binary_operator::multiply: return left.multiply(right);
+		case ir::ast::binary_operator::divide: return ir::types::is_signed_integer(type) ? left.sdiv(right) : left.udiv(right);
+		default: return llvm::ConstantRange::getFull(left.getBitWidth());
+	}
+}
+
+llvm::ConstantRange parser::range_analysis::get_checked_range(ir::ast::expression::call* call, ir::ast::expression::builtin_function* builtin,
+	const llvm::ConstantRange& left, const llvm::ConstantRange& right)
+{
+	// worked out at twice the width where nothing can overflow, the check can fail if some of it is outside the type
+	const auto type = builtin->operand_type.get();
+	const auto is_signed = ir::types::is_signed_integer(type);
+	const auto width = left.getBitWidth();
+	auto extend = [&](const llvm::ConstantRange& range) { return is_signed ? range.signExtend(2 * width) : range.zeroExtend(2 * width); };
+
+	const auto op = builtin->kind == ir::ast::builtin::checked_add ? ir::ast::binary_operator::add
+		: builtin->kind == ir::ast::builtin::checked_sub ? ir::ast::binary_operator::subtract : ir::ast::binary_operator::multiply;
+	const auto exact = apply(op, type, extend(left), extend(right));
+	const auto representable = extend(llvm::ConstantRange::getFull(width));
+
+	// when it fails nothing after it runs, so the result is always one that fits
+	const auto fits = exact.intersectWith(representable, preferred(type));
+	auto result = fits.isEmptySet() ? llvm::ConstantRange::getEmpty(width) : fits.truncate(width);
+
+	if (recording)
+	{
+		auto& info = checks[call];
+		info.builtin = builtin;
+		info.may_fail |= !representable.contains(exact);
+		info.result = info.result ? info.result->unionWith(result, preferred(type)) : result;
+	}
+	return result.isEmptySet() ? llvm::ConstantRange::getFull(width) : result;
+}
+
+void parser::range_analysis::check_division(ir::ast::node* node, ir::types::type_descriptor* type, const std::optional<llvm::ConstantRange>& left,
+	const std::optional<llvm::ConstantRange>& right)
+{
+	if (!type)
+	{
+		return;
+	}
+
+	// floats divide by 0 just fine
+	if (unchecked || !ir::types::is_integer(ir::types::scalar_type(type)))
+	{
+		set_division_checked(node, false);
+		return;
+	}
+
+	if (!recording)
+	{
+		return;
+	}
+
+	auto& info = divisions[node];
+	info.is_signed = ir::types::is_signed_integer(ir::types::scalar_type(type));
+
+	// vectors aren't tracked
+	if (!right)
+	{
+		info.may_fail = true;
+		info.reason = "the divisor isn't known";
+		return;
+	}
+
+	// llvm leaves both undefined, the smallest signed value divided by -1 doesn't fit
+	const auto width = right->getBitWidth();
+	if (right->contains(llvm::APInt::getZero(width)))
+	{
+		info.may_fail = true;
+		info.reason = "the divisor can be 0";
+	}
+	else if (info.is_signed && right->contains(llvm::APInt::getAllOnes(width)) && (!left || left->contains(llvm::APInt::getSignedMinValue(width))))
+	{
+		info.may_fail = true;
+		info.reason = "it can overflow";
+	}
+	info.divisor = info.divisor ? info.divisor->unionWith(*right, preferred(type)) : *right;
+}
+
+void parser::range_analysis::check_bounds(ir::ast::expression::expression* node, const bounds_site& site, const std::optional<llvm::ConstantRange>& index)
+{
+	const auto array = ir::types::as_array(site.object_type);
+	const auto sequence = get_variable(site.object);
+	const auto local = get_local(site.index);
+
+	// the indices that are in bounds, from 0 up to the length of an array less the other lanes or to the end of the type.
+	// none when the array is shorter than the lanes
+	const auto type = site.index_type;
+	const auto is_signed = ir::types::is_signed_integer(type);
+	const auto width = ir::types::bit_width(type);
+	auto max = is_signed ? llvm::APInt::getSignedMaxValue(width) : llvm::APInt::getMaxValue(width);
+	if (array && array->length >= site.lanes && array->length - site.lanes < max.getZExtValue())
+	{
+		max = llvm::APInt(width, array->length - site.lanes);
+	}
+	const auto in_bounds = array && array->length < site.lanes ? llvm::ConstantRange::getEmpty(width) : llvm::ConstantRange::getNonEmpty(llvm::APInt(width, 0), max + 1);
+	const auto non_negative = index && !(is_signed && index->getSignedMin().isNegative());
+
+	if (unchecked)
+	{
+		set_checked(node, false);
+	}
+	else if (recording && index)
+	{
+		bounds_check check;
+		if (array && in_bounds.contains(*index))
+		{
+			check.result = bounds_check::outcome::removed;
+			check.reason = "the index is in " + to_string(*index, is_signed);
+		}
+		else if (non_negative && local && sequence && site.lanes == 1 && current.is_below(local, sequence))
+		{
+			check.result = bounds_check::outcome::removed;
+			check.reason = "the index is below len(" + sequence->name + ")";
+		}
+		else if (non_negative)
+		{
+			check = hoist(site, *index);
+		}
+		else
+		{
+			check.reason = "the index can be negative";
+		}
+
+		// gone over again when a condition is refined, with what the first time found out about the index already known
+		auto [it, inserted] = bounds_checks.insert({ node, check });
+		auto& recorded = it->second;
+		if (!inserted && check.result > recorded.result)
+		{
+			recorded = std::move(check);
+		}
+		else if (!inserted && check.result == bounds_check::outcome::hoisted && (check.loop != recorded.loop
+			|| check.hoisted.limit != recorded.hoisted.limit || check.hoisted.constant_limit != recorded.hoisted.constant_limit))
+		{
+			recorded = bounds_check{ bounds_check::outcome::kept, "the index can be out of bounds" };
+		}
+	}
+
+	// nothing after the check runs with an index out of bounds
+	if (local && index)
+	{
+		auto narrowed = index->intersectWith(in_bounds, preferred(type));
+		if (narrowed.isEmptySet())
+		{
+			current.reachable = false;
+		}
+		else
+		{
+			current.ranges.insert_or_assign(local, narrowed);
+		}
+	}
+
+	if (local && sequence)
+	{
+		current.add_below(local, sequence);
+	}
+}
+
+parser::range_analysis::bounds_check parser::range_analysis::hoist(const bounds_site& site, const llvm::ConstantRange& index)
+{
+	bounds_check check{ bounds_check::outcome::kept, "the index can be out of bounds" };
+
+	// the length of a slice is only known where it's a local
+	const auto array = ir::types::as_array(site.object_type);
+	const auto sequence = get_variable(site.object);
+	if (!array && !sequence)
+	{
+		return check;
+	}
+
+	// the outermost loop that changes neither the limit nor the slice, the check runs once on the way into it
+	auto find_loop = [&](const ir::ast::var* limit) -> ir::ast::statement::while_statement*
+	{
+		for (const auto& enclosing : loops)
+		{
+			auto changes = [&](const ir::ast::var* var) { return var && std::find(enclosing.changed.cbegin(), enclosing.changed.cend(), var) != enclosing.changed.cend(); };
+			if (!changes(limit) && (array || !changes(sequence)))
+			{
+				return enclosing.stat;
+			}
+		}
+		return nullptr;
+	};
+
+	check.hoisted.sequence = array ? nullptr : sequence;
+	check.hoisted.array_length = array ? array->length : 0;
+	const auto length = sequence ? "len(" + sequence->name + ")" : std::to_string(array->length);
+
+	// i < n, the check can't fail when n is at most the length. a load or store goes past i, which n says nothing about
+	if (auto local = get_local(site.index); local && site.lanes == 1)
+	{
+		for (const auto& [lower, upper] : current.below)
+		{
+			if (lower != local || is_sequence(upper))
+			{
+				continue;
+			}
+
+			if (auto loop = find_loop(upper))
+			{
+				check.result = bounds_check::outcome::hoisted;
+				check.reason = "it only runs when '" + upper->name + "' is more than " + length;
+				check.loop = loop;
+				check.hoisted.limit = upper;
+				return check;
+			}
+		}
+	}
+
+	// the largest index the range allows, along with the other lanes, has to be below the length of the slice
+	const auto is_signed = ir::types::is_signed_integer(site.index_type);
+	const auto max = is_signed ? index.getSignedMax() : index.getUnsignedMax();
+	if (array || (is_signed ? max.isMaxSignedValue() : max.isMaxValue()))
+	{
+		return check;
+	}
+
+	if (auto loop = find_loop(nullptr))
+	{
+		check.result = bounds_check::outcome::hoisted;
+		check.hoisted.constant_limit = max.getZExtValue() + site.lanes;
+		check.reason = "it only runs when " + length + " is below " + std::to_string(check.hoisted.constant_limit);
+		check.loop = loop;
+	}
+	return check;
+}
+
+void parser::range_analysis::assign(ir::ast::expression::expression* target, const std::optional<llvm::ConstantRange>& range)
+{
+	auto variable = get_variable(target);
+	if (!variable)
+	{
+		return;
+	}
+
+	forget(variable);
+	if (auto local = get_local(target); local && range)
+	{
+		current.ranges.insert_or_assign(local, *range);
+	}
+}
+
+void parser::range_analysis::forget(const ir::ast::var* var)
+{
+	current.ranges.erase(var);
+
+	auto& below = current.below;
+	below.erase(std::remove_if(below.begin(), below.end(), [&](const auto& fact) { return fact.first == var || fact.second == var; }), below.end());
+}
+
+parser::range_analysis::state parser::range_analysis::refine(const state& before, ir::ast::expression::expression* condition, bool taken)
+{
+	auto result = before;
+	if (auto value = comptime::literal_value(condition); value && std::holds_alternative<bool>(*value))
+	{
+		result.reachable &= std::get<bool>(*value) == taken;
+		return result;
+	}
+
+	auto binary = dynamic_cast<ir::ast::expression::binary*>(condition);
+	if (!binary || !ir::ast::is_comparison(binary->op) || !ir::types::is_integer(binary->type.get()))
+	{
+		return result;
+	}
+
+	const auto is_signed = ir::types::is_signed_integer(binary->type.get());
+	llvm::CmpInst::Predicate predicate;
+	switch (binary->op)
+	{
+		case ir::ast::binary_operator::equal: predicate = llvm::CmpInst::ICMP_EQ; break;
+		case ir::ast::binary_operator::not_equal: predicate = llvm::CmpInst::ICMP_NE; break;
+		case ir::ast::binary_operator::less: predicate = is_signed ? llvm::CmpInst::ICMP_SLT : llvm::CmpInst::ICMP_ULT; break;
+		case ir::ast::binary_operator::less_equal: predicate = is_signed ? llvm::CmpInst::ICMP_SLE : llvm::CmpInst::ICMP_ULE; break;
+		case ir::ast::binary_operator::greater: predicate = is_signed ? llvm::CmpInst::ICMP_SGT : llvm::CmpInst::ICMP_UGT; break;
+		default: predicate = is_signed ? llvm::CmpInst::ICMP_SGE : llvm::CmpInst::ICMP_UGE; break;
+	}
+
+	if (!taken)
+	{
+		predicate = llvm::CmpInst::getInversePredicate(predicate);
+	}
+
+	auto saved = std::move(current);
+	current = before;
+	const auto left = get_range(binary->left.get());
+	const auto right = get_range(binary->right.get());
+	current = std::move(saved);
+	if (!left || !right)
+	{
+		return result;
+	}
+
+	// both sides narrow each other, `i < n` says something about i and about n
+	auto narrow = [&](ir::ast::expression::expression* side, const llvm::ConstantRange& range, llvm::CmpInst::Predicate pred, const llvm::ConstantRange& other)
+	{
+		auto narrowed = range.intersectWith(llvm::ConstantRange::makeAllowedICmpRegion(pred, other), preferred(binary->type.get()));
+		if (narrowed.isEmptySet())
+		{
+			result.reachable = false;
+		}
+		else if (auto local = get_local(side))
+		{
+			result.ranges.insert_or_assign(local, narrowed);
+		}
+	};
+
+	narrow(binary->left.get(), *left, predicate, *right);
+	narrow(binary->right.get(), *right, llvm::CmpInst::getSwappedPredicate(predicate), *left);
+
+	// i < n and i < len(s) are kept as they are too, they hold for as long as neither side is assigned
+	auto add_below = [&](ir::ast::expression::expression* lower, ir::ast::expression::expression* upper)
+	{
+		auto lower_local = get_local(lower);
+		auto upper_local = get_local(upper);
+		if (!upper_local)
+		{
+			upper_local = get_length_of(upper);
+		}
+
+		if (lower_local && upper_local && lower_local != upper_local)
+		{
+			result.add_below(lower_local, upper_local);
+		}
+	};
+
+	if (predicate == llvm::CmpInst::ICMP_SLT || predicate == llvm::CmpInst::ICMP_ULT)
+	{
+		add_below(binary->left.get(), binary->right.get());
+	}
+	else if (predicate == llvm::CmpInst::ICMP_SGT || predicate == llvm::CmpInst::ICMP_UGT)
+	{
+		add_below(binary->right.get(), binary->left.get());
+	}
+	return result;
+}
+
+parser::range_analysis::state parser::range_analysis::join(const state& a, const state& b)
+{
+	if (!a.reachable)
+	{
+		return b;
+	}
+
+	if (!b.reachable)
+	{
+		return a;
+	}
+
+	// missing on either side is the full range, so only what both know survives
+	state result;
+	for (const auto& [local, range] : a.ranges)
+	{
+		if (auto it = b.ranges.find(local); it != b.ranges.cend())
+		{
+			result.ranges.insert_or_assign(local, range.unionWith(it->second, preferred(integer_type(local->type_))));
+		}
+	}
+
+	for (const auto& [lower, upper] : a.below)
+	{
+		if (b.is_below(lower, upper))
+		{
+			result.below.emplace_back(lower, upper);
+		}
+	}
+	return result;
+}
+
+parser::range_analysis::state parser::range_analysis::widen(const state& before, const state& after)
+{
+	if (!before.reachable || !after.reachable)
+	{
+		return after;
+	}
+
+	// a bound that moved goes all the way to the end of the type, so a loop is only gone over a few times
+	state result = after;
+	for (auto& [local, range] : result.ranges)
+	{
+		auto it = before.ranges.find(local);
+		if (it == before.ranges.cend() || it->second.contains(range))
+		{
+			continue;
+		}
+
+		const auto is_signed = ir::types::is_signed_integer(integer_type(local->type_));
+		const auto width = range.getBitWidth();
+		const auto& old = it->second;
+
+		auto lower = is_signed ? range.getSignedMin() : range.getUnsignedMin();
+		auto upper = is_signed ? range.getSignedMax() : range.getUnsignedMax();
+		if (is_signed ? lower.slt(old.getSignedMin()) : lower.ult(old.getUnsignedMin()))
+		{
+			lower = is_signed ? llvm::APInt::getSignedMinValue(width) : llvm::APInt::getMinValue(width);
+		}
+		if (is_signed ? upper.sgt(old.getSignedMax()) : upper.ugt(old.getUnsignedMax()))
+		{
+			upper = is_signed ? llvm::APInt::getSignedMaxValue(width) : llvm::APInt::getMaxValue(width);
+		}
+		range = llvm::ConstantRange::getNonEmpty(lower, upper + 1);
+	}
+	return result;
+}
+
+void parser::range_analysis::analyze(ir::ast::statement::statement* stat)
+{
+	if (stat && current.reachable)
+	{
+		stat->visit(this);
+	}
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::function_definition* node)
+{
+	current = {};
+	recording = true;
+	unchecked = node->attributes.find("unchecked") != node->attributes.cend();
+	checks.clear();
+	divisions.clear();
+	bounds_checks.clear();
+
+	const auto first_remark = remarks.size();
+	analyze(node->body_stat.get());
+
+	for (auto& [call, info] : checks)
+	{
+		info.builtin->checked = info.may_fail;
+		if (info.may_fail)
+		{
+			remarks.push_back({ call->range.start, "overflow check of '" + info.builtin->name + "' kept, it can overflow" });
+		}
+		else
+		{
+			const auto is_signed = ir::types::is_signed_integer(info.builtin->operand_type.get());
+			remarks.push_back({ call->range.start, "overflow check of '" + info.builtin->name + "' removed, the result is in " + to_string(*info.result, is_signed) });
+		}
+	}
+
+	for (auto& [division, info] : divisions)
+	{
+		set_division_checked(division, info.may_fail);
+		if (!info.may_fail)
+		{
+			remarks.push_back({ division->range.start, "division check removed, the divisor is in " + to_string(*info.divisor, info.is_signed) });
+			continue;
+		}
+
+		// a failed check throws, which a @pure function can't. with @unchecked there is none
+		if (node->attributes.find("pure") != node->attributes.cend())
+		{
+			throw exception(division->range.start, "@pure function '" + node->name + "' has to be @unchecked to divide here, " + info.reason);
+		}
+		remarks.push_back({ division->range.start, "division check kept, " + info.reason });
+	}
+
+	for (auto& [node, check] : bounds_checks)
+	{
+		set_checked(node, check.result != bounds_check::outcome::removed);
+
+		auto sequence = get_variable(get_object(node));
+		auto message = sequence ? "bounds check of '" + sequence->name + "'" : std::string{ "bounds check" };
+		switch (check.result)
+		{
+			case bounds_check::outcome::removed:
+			{
+				message += " removed, ";
+				break;
+			}
+			case bounds_check::outcome::hoisted:
+			{
+				// indices below the same limit share the comparison
+				auto& hoisted = check.loop->hoisted_checks;
+				auto it = std::find_if(hoisted.cbegin(), hoisted.cend(), [&](const auto& other)
+				{
+					return other->sequence == check.hoisted.sequence && other->array_length == check.hoisted.array_length
+						&& other->limit == check.hoisted.limit && other->constant_limit == check.hoisted.constant_limit;
+				});
+				if (it == hoisted.cend())
+				{
+					hoisted.push_back(std::make_unique<ir::ast::hoisted_check>(check.hoisted));
+					it = std::prev(hoisted.cend());
+				}
+
+				set_hoisted(node, it->get());
+				message += " hoisted out of the loop, ";
+				break;
+			}
+			case bounds_check::outcome::kept:
+			{
+				message += " kept, ";
+				break;
+			}
+		}
+		remarks.push_back({ node->range.start, message + check.reason });
+	}
+
+	std::stable_sort(remarks.begin() + first_remark, remarks.end(), [](const remark& a, const remark& b)
+	{
+		return a.pos.line != b.pos.line ? a.pos.line < b.pos.line : a.pos.col < b.pos.col;
+	});
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::block* node)
+{
+	for (auto& stat : node->body)
+	{
+		analyze(stat.get());
+	}
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::variable_declaration* node)
+{
+	// a declaration in a loop body starts over every time around
+	auto range = get_range(node->value.get());
+	forget(&node->variable);
+	if (integer_type(node->variable.type_) && range)
+	{
+		current.ranges.insert_or_assign(&node->variable, *range);
+	}
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::variable_assignment* node)
+{
+	auto value = get_range(node->value.get());
+
+	// a[i] = x, the index is checked after the value is worked out
+	if (!get_variable(node->target.get()))
+	{
+		get_range(node->target.get());
+	}
+	assign(node->target.get(), value);
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::compound_assignment* node)
+{
+	auto target = get_range(node->target.get());
+	auto value = get_range(node->value.get());
+	if (node->op == ir::ast::binary_operator::divide)
+	{
+		check_division(node, node->type.get(), target, value);
+	}
+
+	auto local = get_local(node->target.get());
+	assign(node->target.get(), target && value && local ? std::optional{ apply(node->op, integer_type(local->type_), *target, *value) } : std::nullopt);
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::expression_statement* node)
+{
+	get_range(node->expr.get());
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::if_statement* node)
+{
+	get_range(node->condition.get());
+	const auto before = current;
+
+	current = refine(before, node->condition.get(), true);
+	analyze(node->then_body.get());
+	auto after_then = std::move(current);
+
+	current = refine(before, node->condition.get(), false);
+	analyze(node->else_body.get());
+
+	current = join(after_then, current);
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::while_statement* node)
+{
+	const auto entry = current;
+
+	// around the loop until the ranges at its start stop growing, then once more to narrow them back down
+	// to what the condition allows. the body is only recorded the last time, with the final ranges
+	const auto was_recording = recording;
+	recording = false;
+
+	assignment_finder finder;
+	node->body->visit(&finder);
+	loops.push_back({ node, std::move(finder.assigned) });
+
+	auto go_around = [&](const state& head)
+	{
+		current = head;
+		get_range(node->condition.get());
+		current = refine(head, node->condition.get(), true);
+		analyze(node->body.get());
+		return join(entry, current);
+	};
+
+	auto head = entry;
+	while (true)
+	{
+		auto next = widen(head, join(head, go_around(head)));
+		if (next.reachable == head.reachable && next.ranges == head.ranges && next.same_facts(head))
+		{
+			break;
+		}
+		head = std::move(next);
+	}
+	head = go_around(head);
+
+	recording = was_recording;
+	current = head;
+	get_range(node->condition.get());
+	current = refine(head, node->condition.get(), true);
+	analyze(node->body.get());
+
+	current = refine(head, node->condition.get(), false);
+	loops.pop_back();
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::switch_statement* node)
+{
+	auto value = get_range(node->value.get());
+	const auto before = current;
+	const auto local = get_local(node->value.get());
+
+	// in a case the value is one of its labels
+	state after;
+	after.reachable = false;
+	for (auto& switch_case : node->cases)
+	{
+		current = before;
+
+		std::optional<llvm::ConstantRange> labels;
+		for (auto& label : switch_case.labels)
+		{
+			if (auto label_range = get_range(label.get()))
+			{
+				labels = labels ? labels->unionWith(*label_range, preferred(node->type.get())) : *label_range;
+			}
+		}
+
+		if (local && labels)
+		{
+			current.ranges.insert_or_assign(local, *labels);
+		}
+
+		analyze(switch_case.body.get());
+		after = join(after, current);
+	}
+
+	current = before;
+	analyze(node->default_body.get());
+	current = join(after, current);
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::try_statement* node)
+{
+	const auto before = current;
+	analyze(node->body.get());
+	auto after_body = std::move(current);
+
+	// the body can be left from anywhere in it, what it assigns might have any of its values by then
+	assignment_finder finder;
+	node->body->visit(&finder);
+
+	current = before;
+	for (auto local : finder.assigned)
+	{
+		forget(local);
+	}
+
+	analyze(node->catch_body.get());
+	current = join(after_body, current);
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::throw_statement* node)
+{
+	get_range(node->value.get());
+	current.reachable = false;
+	return false;
+}
+
+bool parser::range_analysis::visit(ir::ast::statement::ret* node)
+{
+	if (node->value)
+	{
+		get_range(node->value.get());
+	}
+	current.reachable = false;
+	return false;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "../../ir/ast/ast.h"
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/IR/ConstantRange.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace seam::compiler::parser
+{
+	// the values every integer local can have at each point of a function, walking the body in order.
+	// ranges start out from literals and declared types, comparisons narrow them down in the branches they guard,
+	// loops go around until nothing changes, widening whatever keeps growing to the end of its type.
+	// checked arithmetic that can never overflow loses its check, so does an integer division by something that is never 0
+	// (or -1 with the smallest value on the left). needs to run after literal_typer and constant_folder.
+	// next to the ranges go facts like `i < n` and `i < len(s)`, which remove the bounds check of s[i] or move it
+	// in front of the loop when both sides stay the same while it runs
+	class range_analysis : public ir::ast::visitor
+	{
+	public:
+		// what happened to a check, in source order
+		struct remark
+		{
+			position pos;
+			std::string message;
+		};
+	private:
+		// nothing in the map means the full range of the type
+		struct state
+		{
+			std::unordered_map<const ir::ast::var*, llvm::ConstantRange> ranges;
+			// {i, n} for i < n when n is an integer, i < len(n) when it's an array or a slice, until either is assigned.
+			// in the order they were found, so picking one is the same every time
+			std::vector<std::pair<const ir::ast::var*, const ir::ast::var*>> below;
+			bool reachable = true;
+
+			bool is_below(const ir::ast::var* lower, const ir::ast::var* upper) const
+			{
+				return std::find(below.cbegin(), below.cend(), std::pair{ lower, upper }) != below.cend();
+			}
+
+			void add_below(const ir::ast::var* lower, const ir::ast::var* upper)
+			{
+				if (!is_below(lower, upper))
+				{
+					below.emplace_back(lower, upper);
+				}
+			}
+
+			bool same_facts(const state& other) const
+			{
+				return below.size() == other.below.size()
+					&& std::all_of(below.cbegin(), below.cend(), [&](const auto& fact) { return other.is_below(fact.first, fact.second); });
+			}
+		};
+
+		struct check
+		{
+			ir::ast::expression::builtin_function* builtin;
+			bool may_fail = false;
+			std::optional<llvm::ConstantRange> result; // every value it was seen to produce
+		};
+
+		struct division_check
+		{
+			bool may_fail = false;
+			std::string reason; // the end of the remark
+			std::optional<llvm::ConstantRange> divisor; // every value it was seen to divide by
+			bool is_signed = false;
+		};
+
+		// what a bounds check is about, a[i] or the elements a vector load or store goes over
+		struct bounds_site
+		{
+			ir::ast::expression::expression* object;
+			ir::ast::expression::expression* index;
+			ir::types::type_descriptor* object_type;
+			ir::types::type_descriptor* index_type;
+			std::uint64_t lanes; // elements from the index on, 1 for a[i]
+		};
+
+		struct bounds_check
+		{
+			enum class outcome
+			{
+				removed,
+				hoisted,
+				kept,
+			};
+
+			outcome result = outcome::kept;
+			std::string reason; // the end of the remark
+			ir::ast::statement::while_statement* loop = nullptr; // the one it's hoisted out of
+			ir::ast::hoisted_check hoisted{};
+		};
+
+		// the enclosing loops, outermost first, along with the locals that can change while they run
+		struct loop
+		{
+			ir::ast::statement::while_statement* stat;
+			std::vector<const ir::ast::var*> changed;
+		};
+
+		state current;
+		// off while a loop body is gone over to find its ranges, only the last time around counts
+		bool recording = true;
+		bool unchecked = false; // in an @unchecked function, which has no bounds checks at all
+		llvm::MapVector<ir::ast::expression::call*, check> checks;
+		// by the binary or the compound assignment of /=
+		llvm::MapVector<ir::ast::node*, division_check> divisions;
+		// by the index_access or the call of the load or store
+		llvm::MapVector<ir::ast::expression::expression*, bounds_check> bounds_checks;
+		std::vector<loop> loops;
+
+		std::vector<remark> remarks;
+
+		std::optional<llvm::ConstantRange> get_range(ir::ast::expression::expression* expr);
+		llvm::ConstantRange apply(ir::ast::binary_operator op, ir::types::type_descriptor* type, const llvm::ConstantRange& left, const llvm::ConstantRange& right);
+		llvm::ConstantRange get_checked_range(ir::ast::expression::call* call, ir::ast::expression::builtin_function* builtin,
+			const llvm::ConstantRange& left, const llvm::ConstantRange& right);
+
+		void check_division(ir::ast::node* node, ir::types::type_descriptor* type, const std::optional<llvm::ConstantRange>& left,
+			const std::optional<llvm::ConstantRange>& right);
+		void check_bounds(ir::ast::expression::expression* node, const bounds_site& site, const std::optional<llvm::ConstantRange>& index);
+		bounds_check hoist(const bounds_site& site, const llvm::ConstantRange& index);
+
+		void assign(ir::ast::expression::expression* target, const std::optional<llvm::ConstantRange>& range);
+		void forget(const ir::ast::var* var);
+		// what is known in the branch taken when the condition is `taken`
+		state refine(const state& before, ir::ast::expression::expression* condition, bool taken);
+		static state join(const state& a, const state& b);
+		static state widen(const state& before, const state& after);
+
+		void analyze(ir::ast::statement::statement* stat);
+	public:
+		bool visit(ir::ast::statement::function_definition* node) override;
+		bool visit(ir::ast::statement::block* node) override;
+		bool visit(ir::ast::statement::variable_declaration* node) override;
+		bool visit(ir::ast::statement::variable_assignment* node) override;
+		bool visit(ir::ast::statement::compound_assignment* node) override;
+		bool visit(ir::ast::statement::expression_statement* node) override;
+		bool visit(ir::ast::statement::if_statement* node) override;
+		bool visit(ir::ast::statement::while_statement* node) override;
+		bool visit(ir::ast::statement::switch_statement* node) override;
+		bool visit(ir::ast::statement::try_statement* node) override;
+		bool visit(ir::ast::statement::throw_statement* node) override;
+		bool visit(ir::ast::statement::ret* node) override;
+
+		const std::vector<remark>& get_remarks() const { return remarks; }
+	};
+}
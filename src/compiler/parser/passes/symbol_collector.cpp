@@ -19,7 +19,7 @@ bool parser::symbol_collector::visit(ir::ast::statement::extern_definition* node
 
 	const auto& func_symbol = node->name;
 
-	if (collected.find(func_symbol) != collected.cend())
+	if (collected.find(func_symbol) != collected.end())
 	{
 		// TODO: use error
 		std::stringstream error_message;
@@ -56,7 +56,7 @@ bool parser::symbol_collector::visit(ir::ast::statement::function_definition* no
 
 	auto func_symbol = func_symbol_ss.str();
 
-	if (collected.find(func_symbol) != collected.cend())
+	if (collected.find(func_symbol) != collected.end())
 	{
 		// TODO: use error
 		std::stringstream error_message;
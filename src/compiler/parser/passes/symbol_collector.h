@@ -2,16 +2,24 @@
 
 #include "../../ir/ast/ast.h"
 
+#include <llvm/ADT/MapVector.h>
+
+#include <string>
+#include <unordered_map>
+
 namespace seam::compiler::parser
 {
+	// keeps symbols in source order so everything iterating it (code generation) is deterministic
+	using symbol_map = llvm::MapVector<std::string, ir::ast::statement::function_declaration*, std::unordered_map<std::string, unsigned>>;
+
 	struct symbol_collector : ir::ast::visitor
 	{
 		std::vector<std::string> symbol_stack;
 
-		std::unordered_map<std::string, ir::ast::statement::function_declaration*> collected;
+		symbol_map collected;
 
 		bool visit(ir::ast::statement::extern_definition* node) override;
 		bool visit(ir::ast::statement::function_definition* node) override;
 		bool visit(ir::ast::statement::class_type_definition* node) override;
 	};
-}
\ No newline at end of file
+}
@@ -1,5 +1,9 @@
 #include "type_analyzer.h"
 
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/MathExtras.h>
+
+#include <algorithm>
 #include <unordered_map>
 #include <sstream>
 
@@ -7,10 +11,110 @@
 
 namespace seam::compiler::parser
 {
+	namespace
+	{
+		using type_map_t = std::unordered_map<std::string, std::shared_ptr<ir::types::type_descriptor>>;
+
+		// T[N] and T[] are made out of T the first time they're used, nullptr if T doesn't exist
+		std::shared_ptr<ir::types::type_descriptor> find_type(type_map_t& type_map, const std::string& name, position pos)
+		{
+			if (auto it = type_map.find(name); it != type_map.cend())
+			{
+				return it->second;
+			}
+
+			if (name.empty() || name.back() != ']')
+			{
+				return nullptr;
+			}
+
+			const auto open = name.rfind('[');
+			auto element = find_type(type_map, name.substr(0, open), pos);
+			if (!element)
+			{
+				return nullptr;
+			}
+			if (ir::types::is_built_in<void>(element.get()))
+			{
+				throw exception(pos, "there are no arrays or slices of 'void'");
+			}
+
+			std::shared_ptr<ir::types::type_descriptor> type_desc;
+			const auto length = llvm::StringRef{ name }.slice(open + 1, name.size() - 1);
+			if (length.empty())
+			{
+				// the elements of a @soa class aren't next to each other, there's nothing to point at
+				auto class_desc = dynamic_cast<ir::types::class_type_descriptor*>(ir::types::unwrap_alias(element.get()));
+				if (class_desc && class_desc->soa)
+				{
+					throw exception(pos, "there are no slices of '@soa' class '" + class_desc->name + "', its fields are stored apart");
+				}
+				type_desc = std::make_shared<ir::types::slice_type_descriptor>(name, std::move(element));
+			}
+			else
+			{
+				std::uint64_t value = 0;
+				if (length.getAsInteger(10, value) || value == 0)
+				{
+					throw exception(pos, "the length of an array has to be a positive integer, got '" + length.str() + "'");
+				}
+				type_desc = std::make_shared<ir::types::array_type_descriptor>(name, std::move(element), value);
+			}
+
+			type_map[name] = type_desc;
+			return type_desc;
+		}
+	}
+
 	class type_collector : public ir::ast::visitor
 	{
 		std::unordered_map<std::string, std::shared_ptr<ir::types::type_descriptor>>& type_map;
 
+		// the alignments the backend can still express on loads, stores and globals
+		constexpr static std::uint64_t max_alignment = 1ull << 29;
+		constexpr static std::uint64_t cache_line_size = 64;
+
+		static ir::types::layout_attributes collect_layout_attributes(const ir::ast::attribute_map& attributes, position pos)
+		{
+			ir::types::layout_attributes layout;
+
+			if (auto align = attributes.find("align"); align != attributes.cend())
+			{
+				std::uint64_t value = 0;
+				if (align->second.size() != 1 || !llvm::to_integer(align->second.front(), value, 10) ||
+					!llvm::isPowerOf2_64(value) || value > max_alignment)
+				{
+					throw exception(pos, "expected '@align(N)' with a power of two N");
+				}
+				layout.align = value;
+			}
+
+			if (auto packed = attributes.find("packed"); packed != attributes.cend())
+			{
+				if (!packed->second.empty())
+				{
+					throw exception(pos, "'@packed' does not take arguments");
+				}
+				layout.packed = true;
+			}
+
+			if (auto cacheline = attributes.find("cacheline"); cacheline != attributes.cend())
+			{
+				if (!cacheline->second.empty())
+				{
+					throw exception(pos, "'@cacheline' does not take arguments");
+				}
+				layout.cacheline = true;
+				layout.align = std::max(layout.align, cache_line_size);
+			}
+
+			if (layout.packed && layout.align != 0)
+			{
+				throw exception(pos, "'@packed' can not be combined with '@align' or '@cacheline'");
+			}
+			return layout;
+		}
+
 	public:
 		type_collector(std::unordered_map<std::string, std::shared_ptr<ir::types::type_descriptor>>& type_map) :
 			type_map(type_map) {}
@@ -30,14 +134,14 @@ namespace seam::compiler::parser
 			if (type_map.find(node->alias_name) == type_map.cend())
 			{
 				const auto& target_type = std::get<ir::ast::type>(node->target_type);
-				const auto aliased_it = type_map.find(target_type.name);
-				if (aliased_it == type_map.cend())
+				auto aliased_type = find_type(type_map, target_type.name, node->range.start);
+				if (!aliased_type)
 				{
 					std::stringstream error_message;
 					error_message << "attempt to alias invalid type '" << target_type.name << "' as '" << node->alias_name << "'";
 					throw exception(node->range.start, error_message.str());
 				}
-				type_map[node->alias_name] = std::make_shared<ir::types::alias_type_descriptor>(node->alias_name, aliased_it->second);
+				type_map[node->alias_name] = std::make_shared<ir::types::alias_type_descriptor>(node->alias_name, std::move(aliased_type));
 			}
 			else
 			{
@@ -54,18 +158,55 @@ namespace seam::compiler::parser
 			{
 				auto class_desc = std::make_shared<ir::types::class_type_descriptor>(node->name);
 
+				if (auto repr = node->attributes.find("repr"); repr != node->attributes.cend())
+				{
+					if (repr->second != std::vector<std::string>{ "C" })
+					{
+						throw exception(node->range.start, "expected '@repr(C)'");
+					}
+					class_desc->repr_c = true;
+				}
+
+				if (auto soa = node->attributes.find("soa"); soa != node->attributes.cend())
+				{
+					if (!soa->second.empty())
+					{
+						throw exception(node->range.start, "'@soa' does not take arguments");
+					}
+					class_desc->soa = true;
+				}
+
+				class_desc->layout = collect_layout_attributes(node->attributes, node->range.start);
+
 				for (const auto& field : node->fields)
 				{
+					if (class_desc->find_field(field.name))
+					{
+						std::stringstream error_message;
+						error_message << "field '" << field.name << "' is declared more than once in '" << node->name << "'";
+						throw exception(node->range.start, error_message.str());
+					}
+
 					const auto& field_type = std::get<ir::ast::type>(field.type_);
-					auto field_type_desc_it = type_map.find(field_type.name);
-					if (field_type_desc_it == type_map.cend())
+					auto field_type_desc = find_type(type_map, field_type.name, node->range.start);
+					if (!field_type_desc)
 					{
 						std::stringstream error_message;
 						error_message << "attempt to declare field '" << field.name << "' with invalid type '" << field_type.name << "'";
 						throw exception(node->range.start, error_message.str());
 					}
-					class_desc->fields[field.name] = { field.name, { field_type_desc_it->second, field_type.is_optional } };
+					class_desc->fields.push_back({ field.name, { std::move(field_type_desc), field_type.is_optional },
+						collect_layout_attributes(field.attributes, node->range.start) });
+				}
+
+				// a collection of a @soa class has no elements to align or pack
+				if (class_desc->soa && (class_desc->layout.any() ||
+					std::any_of(class_desc->fields.cbegin(), class_desc->fields.cend(), [](const auto& field) { return field.layout.any(); })))
+				{
+					throw exception(node->range.start, "'@soa' classes can not have layout attributes");
 				}
+
+				node->descriptor = class_desc;
 				type_map[node->name] = class_desc;
 			}
 			else
@@ -86,15 +227,15 @@ namespace seam::compiler::parser
 		{
 			auto& type = std::get<ir::ast::type>(type_ref);
 
-			auto type_desc_it = type_map.find(type.name);
-			if (type_desc_it == type_map.cend())
+			auto type_desc = find_type(type_map, type.name, pos);
+			if (!type_desc)
 			{
 				std::stringstream error_message;
 				error_message << "attempt to use invalid type '" << type.name << '\'';
 				throw exception(pos, error_message.str());
 			}
 
-			type_ref = ir::types::type_reference{ type_desc_it->second, type.is_optional };
+			type_ref = ir::types::type_reference{ std::move(type_desc), type.is_optional };
 		}
 	public:
 		bool visit(ir::ast::statement::extern_definition* node)
@@ -125,6 +266,21 @@ namespace seam::compiler::parser
 			return true;
 		}
 
+		bool visit(ir::ast::statement::variable_declaration* node)
+		{
+			resolve_type(node->range.start, node->variable.type_);
+			return true;
+		}
+
+		bool visit(ir::ast::statement::try_statement* node)
+		{
+			if (node->catch_variable)
+			{
+				resolve_type(node->range.start, node->catch_variable->type_);
+			}
+			return true;
+		}
+
 		bool visit(ir::ast::statement::class_type_definition* node)
 		{
 			for (auto& field : node->fields)
@@ -158,6 +314,14 @@ namespace seam::compiler::parser
 			{ "f64", std::make_unique<ir::types::built_in_type_descriptor<double>>("f64") }
 		};
 
+		for (const auto element : { "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64", "f32", "f64" })
+		{
+			for (unsigned lanes = 2; auto vector = ir::types::make_vector_type(element + ("x" + std::to_string(lanes))); lanes *= 2)
+			{
+				type_map[vector->name] = std::move(vector);
+			}
+		}
+
 		type_collector collector{ type_map };
 		root->visit(&collector);
 
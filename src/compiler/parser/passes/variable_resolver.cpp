@@ -3,6 +3,87 @@
 
 using namespace seam::compiler;
 
+void parser::variable_resolver::declare(ir::ast::var* var, position pos)
+{
+	if (!scopes.back().emplace(var->name, var).second)
+	{
+		throw exception(pos, "variable '" + var->name + "' is already declared in this scope");
+	}
+}
+
+void parser::variable_resolver::check_assignable(ir::ast::expression::expression* target)
+{
+	// a[i] and a[i].x, literal_typer checks there is an array or slice behind them once types are known
+	if (dynamic_cast<ir::ast::expression::index_access*>(target) || dynamic_cast<ir::ast::expression::member_access*>(target))
+	{
+		return;
+	}
+
+	auto target_var = dynamic_cast<ir::ast::expression::variable*>(target);
+	if (!target_var || !dynamic_cast<ir::ast::expression::local_variable*>(target_var->var.get()))
+	{
+		throw exception(target->range.start, "can only assign to local variables");
+	}
+}
+
+bool parser::variable_resolver::visit(ir::ast::statement::function_definition* node)
+{
+	scopes.emplace_back();
+	for (auto& arg : node->arguments)
+	{
+		declare(&arg, node->range.start);
+	}
+
+	node->visit_children(this);
+	scopes.pop_back();
+	return false;
+}
+
+bool parser::variable_resolver::visit(ir::ast::statement::block* node)
+{
+	scopes.emplace_back();
+	node->visit_children(this);
+	scopes.pop_back();
+	return false;
+}
+
+bool parser::variable_resolver::visit(ir::ast::statement::try_statement* node)
+{
+	node->body->visit(this);
+
+	// the catch variable lives in its own scope around the catch body
+	scopes.emplace_back();
+	if (node->catch_variable)
+	{
+		declare(&*node->catch_variable, node->catch_body->range.start);
+	}
+	node->catch_body->visit(this);
+	scopes.pop_back();
+	return false;
+}
+
+bool parser::variable_resolver::visit(ir::ast::statement::variable_declaration* node)
+{
+	// the value can still refer to a shadowed variable, `a: i32 := a + 1`
+	node->value->visit(this);
+	declare(&node->variable, node->range.start);
+	return false;
+}
+
+bool parser::variable_resolver::visit(ir::ast::statement::variable_assignment* node)
+{
+	node->visit_children(this);
+	check_assignable(node->target.get());
+	return false;
+}
+
+bool parser::variable_resolver::visit(ir::ast::statement::compound_assignment* node)
+{
+	node->visit_children(this);
+	check_assignable(node->target.get());
+	return false;
+}
+
 bool parser::variable_resolver::visit(ir::ast::expression::variable* node)
 {
 	auto unresolved_var = dynamic_cast<ir::ast::expression::unresolved_variable*>(node->var.get());
@@ -11,17 +92,32 @@ bool parser::variable_resolver::visit(ir::ast::expression::variable* node)
 		throw exception(node->range.start, "variable already resolved");
 	}
 
-	auto var = std::move(unresolved_var);
-
-	// first check if its a local variable (not implemented yet) 
+	// first check if its a local variable
 	// then if its a module function
 	// then if its a imported module function
+	// then if its a builtin
+
+	for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+	{
+		auto it = scope->find(unresolved_var->name);
+		if (it != scope->end())
+		{
+			node->var = std::make_unique<ir::ast::expression::local_variable>(unresolved_var->range, it->first, it->second);
+			return false;
+		}
+	}
 
-	auto it = symbol_map.find(unresolved_var->name);
-	if (it != symbol_map.cend())
+	auto it = symbols.find(unresolved_var->name);
+	if (it != symbols.end())
 	{
 		node->var = std::make_unique<ir::ast::expression::function_variable>(unresolved_var->range, it->first, it->second);
 		return false;
 	}
+
+	if (auto kind = ir::ast::find_builtin(unresolved_var->name))
+	{
+		node->var = std::make_unique<ir::ast::expression::builtin_function>(unresolved_var->range, unresolved_var->name, *kind);
+		return false;
+	}
 	throw exception(node->range.start, "could not find variable '" + unresolved_var->name + "', did you forget to declare it?");
-}
\ No newline at end of file
+}
@@ -1,15 +1,32 @@
 #pragma once
 #include "../../ir/ast/ast.h"
+#include "symbol_collector.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace seam::compiler::parser
 {
 	class variable_resolver : public ir::ast::visitor
 	{
-		const std::unordered_map<std::string, ir::ast::statement::function_declaration*>& symbol_map;
+		const symbol_map& symbols;
+
+		// innermost scope last, the first scope of a function holds its parameters
+		std::vector<std::unordered_map<std::string, ir::ast::var*>> scopes;
+
+		void declare(ir::ast::var* var, position pos);
+		void check_assignable(ir::ast::expression::expression* target);
 	public:
+		bool visit(ir::ast::statement::function_definition* node);
+		bool visit(ir::ast::statement::block* node);
+		bool visit(ir::ast::statement::try_statement* node);
+		bool visit(ir::ast::statement::variable_declaration* node);
+		bool visit(ir::ast::statement::variable_assignment* node);
+		bool visit(ir::ast::statement::compound_assignment* node);
 		bool visit(ir::ast::expression::variable* node);
 
-		variable_resolver(const std::unordered_map<std::string, ir::ast::statement::function_declaration*>& symbol_map) :
-			symbol_map(symbol_map) {}
+		variable_resolver(const symbol_map& symbols) :
+			symbols(symbols) {}
 	};
 }
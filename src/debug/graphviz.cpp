@@ -129,6 +129,30 @@ bool graphvizitor::visit(ir::ast::expression::call* call_expr)
 	return false;
 }
 
+bool graphvizitor::visit(ir::ast::expression::binary* binary_expr)
+{
+	write_node(binary_expr, std::string{ "binary\\n" } + ir::ast::to_string(binary_expr->op));
+	auto o_parent_id = parent_id;
+	parent_id = binary_expr;
+
+	binary_expr->visit_children(this);
+
+	parent_id = o_parent_id;
+	return false;
+}
+
+bool graphvizitor::visit(ir::ast::expression::unary* unary_expr)
+{
+	write_node(unary_expr, std::string{ "unary\\n" } + ir::ast::to_string(unary_expr->op));
+	auto o_parent_id = parent_id;
+	parent_id = unary_expr;
+
+	unary_expr->visit_children(this);
+
+	parent_id = o_parent_id;
+	return false;
+}
+
 bool graphvizitor::visit(ir::ast::expression::unresolved_variable* unresolved_var_expr)
 {
 	write_node(unresolved_var_expr, "unresolved variable\\n" + unresolved_var_expr->name);
@@ -152,9 +176,13 @@ bool graphvizitor::visit(seam::compiler::ir::ast::statement::function_definition
 	}
 	label_ss << ") -> " << format_type(func_def_stat->return_type);
 
-	for (auto attribute : func_def_stat->attributes)
+	for (const auto& [attribute, arguments] : func_def_stat->attributes)
 	{
 		label_ss << " @" << attribute;
+		for (std::size_t i = 0; i < arguments.size(); ++i)
+		{
+			label_ss << (i == 0 ? "(" : ", ") << arguments[i] << (i + 1 == arguments.size() ? ")" : "");
+		}
 	}
 
 	write_node(func_def_stat, label_ss.str());
@@ -28,6 +28,8 @@ public:
 	bool visit(seam::compiler::ir::ast::expression::literal<bool>* literal_bool_expr) override;
 	
 	bool visit(seam::compiler::ir::ast::expression::call* call_expr) override;
+	bool visit(seam::compiler::ir::ast::expression::binary* binary_expr) override;
+	bool visit(seam::compiler::ir::ast::expression::unary* unary_expr) override;
 	bool visit(seam::compiler::ir::ast::expression::unresolved_variable* unresolved_var_expr) override;
 
 	bool visit(seam::compiler::ir::ast::statement::function_definition* func_def_stat) override;
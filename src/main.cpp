@@ -17,6 +17,18 @@ llvm::cl::OptionCategory compiler_category{ "Compiler Options" };
 llvm::cl::opt<bool> no_link{ llvm::cl::cat(compiler_category), "c", llvm::cl::desc("Run all stages except linking"),
 	llvm::cl::ValueDisallowed };
 
+llvm::cl::opt<bool> verify_determinism{ llvm::cl::cat(compiler_category), "verify-determinism", llvm::cl::desc("Compile twice and fail if the generated bitcode differs"),
+	llvm::cl::ValueDisallowed };
+
+llvm::cl::opt<bool> print_layout{ llvm::cl::cat(compiler_category), "print-layout", llvm::cl::desc("Print the memory layout of every class"),
+	llvm::cl::ValueDisallowed };
+
+llvm::cl::opt<bool> print_range_remarks{ llvm::cl::cat(compiler_category), "print-range-remarks", llvm::cl::desc("Print which overflow and bounds checks range analysis removed, hoisted out of loops or kept"),
+	llvm::cl::ValueDisallowed };
+
+llvm::cl::opt<bool> fast_math{ llvm::cl::cat(compiler_category), "fast-math", llvm::cl::desc("Allow every floating point optimization in every function, as if all of them were @fast_math"),
+	llvm::cl::ValueDisallowed };
+
 llvm::cl::opt<std::string> output_directory{ llvm::cl::cat(compiler_category), "o", llvm::cl::desc("Override output directory"),
 	llvm::cl::ValueRequired, llvm::cl::init("./out") };
 
@@ -35,6 +47,10 @@ int main(int argc, char* argv[])
 
 		compiler_options opt;
 		opt.no_link = no_link.getValue();
+		opt.verify_determinism = verify_determinism.getValue();
+		opt.print_layout = print_layout.getValue();
+		opt.fast_math = fast_math.getValue();
+		opt.print_range_remarks = print_range_remarks.getValue();
 		opt.output_directory_path = output_directory.getValue();
 		opt.input_file_path = input_filename.getValue();
 